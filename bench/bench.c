@@ -0,0 +1,301 @@
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+
+#include "bench.h"
+#include "client.h"
+#include "handler.h"
+#include "helper.h"
+#include "howm.h"
+#include "layout.h"
+#include "monitor.h"
+#include "restart.h"
+#include "scratchpad.h"
+#include "stats.h"
+#include "types.h"
+#include "workspace.h"
+#include "xcb_help.h"
+#include "xshim.h"
+
+/**
+ * @file bench.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Benchmarks for howm's layouts, client lists, adopting windows,
+ * restarting and IPC.
+ *
+ * howm is linked against the xcb shim, so everything runs without an X server
+ * and the requests that howm would have sent are counted instead.
+ */
+
+static const unsigned int sizes[] = BENCH_SIZES;
+static xcb_window_t next_win = 0x200000;
+
+static void bench_setup(void);
+static void bench_layouts(void);
+static void bench_lists(void);
+static void bench_adopt(void);
+static void bench_restart(void);
+
+int main(int argc, char *argv[])
+{
+	int ch;
+
+	bench_setup();
+	while ((ch = getopt(argc, argv, "r:")) != -1) {
+		switch (ch) {
+		case 'r':
+			bench_replay(optarg);
+			return EXIT_SUCCESS;
+		default:
+			fprintf(stderr, "%s: [-r JOURNAL_PATH]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	bench_layouts();
+	bench_lists();
+	bench_adopt();
+	bench_restart();
+	bench_ipc();
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Set howm up as its setup() would, which gives a single monitor with a
+ * single workspace as the shim doesn't have RandR.
+ */
+static void bench_setup(void)
+{
+	dpy = xcb_connect(NULL, NULL);
+	screen = xcb_setup_roots_iterator(xcb_get_setup(dpy)).data;
+	screen_height = screen->height_in_pixels;
+	screen_width = screen->width_in_pixels;
+
+	get_atoms(WM_ATOM_NAMES, wm_atoms);
+	setup_ewmh();
+	scan_monitors();
+	setup_ewmh_geom();
+	stack_init(&del_reg);
+}
+
+/**
+ * @brief Create or remove clients until the focused workspace has the given
+ * number of them.
+ *
+ * @param n The number of clients.
+ */
+void bench_populate(unsigned int n)
+{
+	workspace_t *ws = mon->ws;
+
+	while (ws->client_cnt < n)
+		create_client(next_win++);
+	while (ws->client_cnt > n)
+		remove_client(mon, ws, ws->tail);
+	if (!ws->c)
+		ws->c = ws->head;
+}
+
+/**
+ * @brief Choose how many times to repeat a measurement.
+ *
+ * @param n The number of clients that each repetition works on.
+ *
+ * @return The number of repetitions.
+ */
+unsigned int bench_iters(unsigned int n)
+{
+	unsigned int iters = BENCH_WORK / (n ? n : 1);
+
+	return iters < 20 ? 20 : iters;
+}
+
+/**
+ * @brief Time each layout, both when every client has to be reconfigured and
+ * when nothing has changed since the last arrangement.
+ */
+static void bench_layouts(void)
+{
+	unsigned int l, i, j, iters;
+	uint64_t start, full_ns, same_ns, full_reqs, same_reqs;
+	client_t *c;
+
+	printf("%-8s %8s %12s %12s %12s %12s\n", "layout", "clients",
+			"ns/arrange", "reqs/arrange", "ns/same", "reqs/same");
+	for (l = 0; l < END_LAYOUT; l++) {
+		for (i = 0; i < LENGTH(sizes); i++) {
+			bench_populate(sizes[i]);
+			mon->ws->layout = l;
+			iters = bench_iters(sizes[i]);
+
+			/* Forget what was last sent, so that every client is
+			 * configured again. */
+			xshim_reset();
+			full_ns = 0;
+			for (j = 0; j < iters; j++) {
+				for (c = mon->ws->head; c; c = c->next)
+					c->is_drawn = false;
+				arrange_windows(mon);
+				start = stats_now();
+				arrange_dirty();
+				full_ns += stats_now() - start;
+			}
+			full_reqs = xshim_seq;
+
+			xshim_reset();
+			start = stats_now();
+			for (j = 0; j < iters; j++) {
+				arrange_windows(mon);
+				arrange_dirty();
+			}
+			same_ns = stats_now() - start;
+			same_reqs = xshim_seq;
+
+			printf("%-8s %8u %12.0f %12.1f %12.0f %12.1f\n",
+					layout_names[l], sizes[i],
+					(double)full_ns / iters, (double)full_reqs / iters,
+					(double)same_ns / iters, (double)same_reqs / iters);
+		}
+	}
+	printf("\n");
+}
+
+/**
+ * @brief Time creating and removing clients, and moving the last client of
+ * a workspace to the master position. The arrangement that follows each of
+ * these is deferred, so it isn't included.
+ */
+static void bench_lists(void)
+{
+	unsigned int i, j, iters;
+	uint64_t start, create_ns, remove_ns, master_ns;
+
+	printf("%8s %12s %12s %12s\n", "clients", "ns/create", "ns/remove",
+			"ns/master");
+	mon->ws->layout = HSTACK;
+	for (i = 0; i < LENGTH(sizes); i++) {
+		iters = bench_iters(sizes[i]) / 10 + 1;
+
+		create_ns = remove_ns = 0;
+		for (j = 0; j < iters; j++) {
+			bench_populate(0);
+			start = stats_now();
+			bench_populate(sizes[i]);
+			create_ns += stats_now() - start;
+			start = stats_now();
+			bench_populate(0);
+			remove_ns += stats_now() - start;
+		}
+
+		bench_populate(sizes[i]);
+		master_ns = 0;
+		for (j = 0; j < iters; j++) {
+			mon->ws->c = mon->ws->tail;
+			start = stats_now();
+			make_master();
+			master_ns += stats_now() - start;
+		}
+		arrange_dirty();
+
+		printf("%8u %12.0f %12.0f %12.0f\n", sizes[i],
+				(double)create_ns / iters / sizes[i],
+				(double)remove_ns / iters / sizes[i],
+				(double)master_ns / iters);
+	}
+	printf("\n");
+}
+
+/**
+ * @brief Time adopting the windows that exist when howm starts, including
+ * the arrangement that follows, and count the requests and round trips that
+ * it takes.
+ */
+static void bench_adopt(void)
+{
+	unsigned int i, j, iters;
+	uint64_t start, ns = 0, reqs = 0, replies = 0;
+	uint16_t level = log_level;
+
+	printf("%8s %12s %12s %14s\n", "windows", "ns/adopt", "reqs/adopt",
+			"replies/adopt");
+	log_level = LOG_NONE;
+	for (i = 0; i < LENGTH(sizes); i++) {
+		iters = bench_iters(sizes[i]) / 10 + 1;
+		xshim_tree_len = sizes[i];
+
+		ns = reqs = replies = 0;
+		for (j = 0; j < iters; j++) {
+			bench_populate(0);
+			xshim_reset();
+			start = stats_now();
+			adopt_windows();
+			arrange_dirty();
+			ns += stats_now() - start;
+			reqs += xshim_seq;
+			replies += xshim_replies;
+		}
+
+		printf("%8u %12.0f %12.1f %14.1f\n", sizes[i], (double)ns / iters,
+				(double)reqs / iters, (double)replies / iters);
+	}
+	log_level = level;
+	xshim_tree_len = 0;
+	bench_populate(0);
+	printf("\n");
+}
+
+/**
+ * @brief Time handing howm's state off for a restart and restoring it,
+ * including the arrangement that follows, and count the requests and replies
+ * that restoring it takes.
+ */
+static void bench_restart(void)
+{
+	unsigned int i, j, iters;
+	uint64_t start, save_ns, load_ns, reqs, replies;
+	uint16_t level = log_level;
+	int fd;
+
+	printf("%8s %12s %12s %12s %14s\n", "clients", "ns/save", "ns/restore",
+			"reqs/restore", "replies/restore");
+	log_level = LOG_NONE;
+	for (i = 0; i < LENGTH(sizes); i++) {
+		iters = bench_iters(sizes[i]) / 10 + 1;
+
+		save_ns = load_ns = reqs = replies = 0;
+		for (j = 0; j < iters; j++) {
+			bench_populate(sizes[i]);
+			arrange_dirty();
+			start = stats_now();
+			fd = restart_save();
+			save_ns += stats_now() - start;
+			if (fd == -1)
+				exit(EXIT_FAILURE);
+
+			bench_populate(0);
+			xshim_reset();
+			start = stats_now();
+			restart_load(fd);
+			arrange_dirty();
+			load_ns += stats_now() - start;
+			reqs += xshim_seq;
+			replies += xshim_replies;
+			close(fd);
+		}
+
+		printf("%8u %12.0f %12.0f %12.1f %14.1f\n", sizes[i],
+				(double)save_ns / iters, (double)load_ns / iters,
+				(double)reqs / iters, (double)replies / iters);
+	}
+	log_level = level;
+	bench_populate(0);
+	printf("\n");
+}
@@ -0,0 +1,27 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+/**
+ * @file bench.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** The numbers of clients that each benchmark is run with. */
+#define BENCH_SIZES { 1, 10, 100, 1000, 5000, 10000 }
+/** Roughly how many clients are arranged, moved or parsed per measurement,
+ * so that small sizes are repeated enough to be timed accurately. */
+#define BENCH_WORK 2000000
+
+void bench_populate(unsigned int n);
+unsigned int bench_iters(unsigned int n);
+void bench_ipc(void);
+void bench_replay(const char *path);
+
+#endif
@@ -0,0 +1,448 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "helper.h"
+#include "howm.h"
+#include "ipc.h"
+#include "layout.h"
+#include "reactor.h"
+#include "snapshot.h"
+#include "stats.h"
+
+/**
+ * @file bench_ipc.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Benchmarks and a fuzzer for howm's IPC.
+ *
+ * Messages are parsed directly with ipc_process, then sent over a real socket
+ * to measure the whole path through the reactor. The fuzzer sends mutated and
+ * random messages in every format, and checks that howm still answers a valid
+ * message afterwards. Building with -fsanitize=address makes it far more
+ * likely to catch memory errors.
+ */
+
+/** How many messages are sent over the socket. */
+#define BENCH_IPC_MSGS 200000
+/** How many messages are written before waiting for their replies. */
+#define BENCH_IPC_BATCH 64
+/** The size of a reply to a message: its length and then an error code. */
+#define BENCH_IPC_REPLY 8
+#define BENCH_FUZZ_PARSES 1000000
+#define BENCH_FUZZ_CONNS 20000
+/** The largest message, mutated or random, that the fuzzer sends. */
+#define BENCH_FUZZ_MAX 256
+
+/**
+ * @brief A text message that the benchmarks parse and the fuzzer mutates.
+ */
+struct bench_msg {
+	const char *name;
+	const char *buf;
+	int len;
+};
+
+#define MSG(n, s) { n, s, sizeof(s) - 1 }
+
+/* Commands that could stop the benchmark, such as quit and spawn, are left
+ * out so that mutating them is unlikely to produce them. */
+static const struct bench_msg msgs[] = {
+	MSG("function", "\x01\0focus_next_client\0"),
+	MSG("int arg", "\x01\0resize_master\0" "5\0"),
+	MSG("config", "\x02\0border_px\0" "2\0"),
+	MSG("bool config", "\x02\0zoom_gap\0true\0"),
+	MSG("unknown", "\x01\0no_such_function\0"),
+	MSG("bad arg", "\x01\0change_ws\0" "9999\0"),
+	MSG("query", "\x06\0workspaces\0"),
+	MSG("subscribe", "\x04\0" "63\0"),
+};
+
+static uint32_t rng_state = 0x686f776d;
+static char sock_path[108];
+
+static uint32_t rng(void);
+static void bench_ipc_parse(void);
+static void bench_ipc_socket(void);
+static void bench_ipc_fuzz(void);
+static int bench_connect(const char *hello, size_t len);
+static size_t bench_pump(int fd, unsigned int rounds, bool *closed);
+static size_t bench_mutate(char *buf, const struct bench_msg *m);
+static size_t bench_binary(char *buf);
+static bool bench_alive(void);
+
+/**
+ * @brief Run every IPC benchmark and then the fuzzer.
+ */
+void bench_ipc(void)
+{
+	snprintf(sock_path, sizeof(sock_path), "/tmp/howm-bench-%d", getpid());
+	setenv(ENV_SOCK_VAR, sock_path, 1);
+	reactor_init();
+	ipc_init();
+
+	bench_ipc_parse();
+	bench_ipc_socket();
+	bench_ipc_fuzz();
+
+	ipc_cleanup();
+	reactor_cleanup();
+}
+
+/**
+ * @brief A xorshift generator, so that every run fuzzes the same inputs.
+ *
+ * @return The next pseudo-random number.
+ */
+static uint32_t rng(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+/**
+ * @brief Time parsing and acting on each kind of text message, without a
+ * socket in the way.
+ */
+static void bench_ipc_parse(void)
+{
+	char buf[BENCH_FUZZ_MAX];
+	unsigned int i, j, iters = BENCH_WORK / 10;
+	uint64_t start, ns;
+
+	bench_populate(10);
+	printf("%-12s %12s\n", "message", "ns/parse");
+	for (i = 0; i < LENGTH(msgs); i++) {
+		start = stats_now();
+		for (j = 0; j < iters; j++) {
+			memcpy(buf, msgs[i].buf, msgs[i].len);
+			ipc_process(buf, msgs[i].len);
+		}
+		ns = stats_now() - start;
+		arrange_dirty();
+		printf("%-12s %12.0f\n", msgs[i].name, (double)ns / iters);
+	}
+	printf("\n");
+}
+
+/**
+ * @brief Time framed messages sent over the socket in batches, including
+ * the reactor and the replies.
+ */
+static void bench_ipc_socket(void)
+{
+	char batch[BENCH_IPC_BATCH * 64], reply[BENCH_IPC_BATCH * BENCH_IPC_REPLY];
+	const struct bench_msg *m = &msgs[0];
+	uint32_t len = m->len;
+	size_t frame = sizeof(len) + len, got;
+	unsigned int i, sent;
+	uint64_t start, ns;
+	ssize_t n;
+	int fd = bench_connect("howm\x02\x00", 6);
+
+	for (i = 0; i < BENCH_IPC_BATCH; i++) {
+		memcpy(batch + i * frame, &len, sizeof(len));
+		memcpy(batch + i * frame + sizeof(len), m->buf, len);
+	}
+
+	start = stats_now();
+	for (sent = 0; sent < BENCH_IPC_MSGS; sent += BENCH_IPC_BATCH) {
+		if (write(fd, batch, BENCH_IPC_BATCH * frame) == -1) {
+			log_err("Failed to write to the socket: %s", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		for (got = 0; got < sizeof(reply); got += n > 0 ? n : 0) {
+			reactor_poll(0);
+			n = recv(fd, reply + got, sizeof(reply) - got, 0);
+			if (n == 0) {
+				log_err("howm closed the connection");
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+	ns = stats_now() - start;
+	close(fd);
+	arrange_dirty();
+
+	printf("%-12s %12.0f\n\n", "ns/socket", (double)ns / sent);
+}
+
+/**
+ * @brief Feed howm mutated and random messages, first directly and then over
+ * the socket in each format, making sure that it keeps working.
+ */
+static void bench_ipc_fuzz(void)
+{
+	static const struct bench_msg hellos[] = { MSG("none", ""),
+		MSG("text", "howm\x02\x00"), MSG("binary", "howm\x02\x01"),
+		MSG("version 1", "howm\x01"), MSG("version 7", "howm\x07\x00"),
+		MSG("garbage", "hoxm") };
+	char buf[BENCH_FUZZ_MAX], out[8 * (BENCH_FUZZ_MAX + 8)];
+	unsigned int i, j, frames, closed_cnt = 0;
+	const struct bench_msg *hello;
+	uint32_t seed = rng_state, len;
+	size_t off;
+	uint16_t level = log_level;
+	bool closed;
+	int fd;
+
+	/* Every bad message is logged, which would bury the results. */
+	log_level = LOG_NONE;
+	for (i = 0; i < BENCH_FUZZ_PARSES; i++) {
+		len = bench_mutate(buf, &msgs[rng() % LENGTH(msgs)]);
+		ipc_process(buf, len);
+		if (i % 1024 == 0)
+			arrange_dirty();
+	}
+
+	for (i = 0; i < BENCH_FUZZ_CONNS; i++) {
+		/* Fuzzed binary messages can set log_level too. */
+		log_level = LOG_NONE;
+		hello = &hellos[rng() % LENGTH(hellos)];
+		fd = bench_connect(hello->buf, hello->len);
+		frames = rng() % 8 + 1;
+		memset(out, 0, sizeof(out));
+		for (j = 0, off = 0; j < frames; j++) {
+			if (hello->len == 0 || rng() % 4 == 0) {
+				/* Unframed, so a legacy message or garbage. */
+				off += bench_mutate(out + off, &msgs[rng() % LENGTH(msgs)]);
+				continue;
+			}
+			if (hello->len == 6 && hello->buf[5] == IPC_FORMAT_BINARY
+					&& rng() % 2)
+				len = bench_binary(out + off + sizeof(len));
+			else
+				len = bench_mutate(out + off + sizeof(len),
+						&msgs[rng() % LENGTH(msgs)]);
+			/* Sometimes lie about the length of the frame. */
+			if (rng() % 16 == 0)
+				len = rng() % 16 ? len + rng() % 8 - 4 : rng();
+			memcpy(out + off, &len, sizeof(len));
+			off += sizeof(len) + (len < BENCH_FUZZ_MAX ? len : 0);
+		}
+		if (send(fd, out, off, MSG_NOSIGNAL) == -1 && errno != EPIPE
+				&& errno != ECONNRESET) {
+			log_err("Failed to write to the socket: %s", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		bench_pump(fd, 4, &closed);
+		closed_cnt += closed;
+		close(fd);
+		bench_pump(-1, 1, NULL);
+		arrange_dirty();
+		ipc_send_events();
+		snapshot_update();
+
+		if (i % 1000 == 999 && !bench_alive()) {
+			log_err("howm stopped answering after %u fuzzed connections "
+					"(seed %#x)", i + 1, seed);
+			exit(EXIT_FAILURE);
+		}
+	}
+	running = true;
+	log_level = level;
+
+	printf("fuzzed %u messages and %u connections (seed %#x), %u closed by "
+			"howm: ok\n", BENCH_FUZZ_PARSES, BENCH_FUZZ_CONNS, seed,
+			closed_cnt);
+}
+
+/**
+ * @brief Connect to howm's socket and send a greeting, waiting for howm to
+ * echo it if it is a valid one.
+ *
+ * @param hello The greeting, which may be empty or invalid.
+ * @param len The length of hello.
+ *
+ * @return The connected socket, which is non-blocking.
+ */
+static int bench_connect(const char *hello, size_t len)
+{
+	struct sockaddr_un addr;
+	char echo[8];
+	size_t got = 0;
+	ssize_t n;
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", sock_path);
+	if (fd == -1 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		log_err("Failed to connect to howm: %s", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	reactor_poll(0);
+	if (len == 0 || send(fd, hello, len, MSG_NOSIGNAL) == -1)
+		return fd;
+
+	/* Only the framed greetings that howm accepts are echoed. */
+	if (len != 6 || hello[5] > IPC_FORMAT_BINARY || hello[4] != IPC_VERSION)
+		return fd;
+	while (got < len) {
+		reactor_poll(0);
+		n = recv(fd, echo + got, len - got, 0);
+		if (n == 0) {
+			log_err("howm closed the connection during the greeting");
+			exit(EXIT_FAILURE);
+		}
+		if (n > 0)
+			got += n;
+	}
+	return fd;
+}
+
+/**
+ * @brief Let howm handle whatever is waiting on its sockets, and read and
+ * throw away whatever it sent back.
+ *
+ * @param fd The client's socket, or -1 to only run the reactor.
+ * @param rounds How many times to run the reactor.
+ * @param closed Set to whether howm closed the connection, if not NULL.
+ *
+ * @return The number of bytes that were read.
+ */
+static size_t bench_pump(int fd, unsigned int rounds, bool *closed)
+{
+	char buf[4096];
+	size_t total = 0;
+	ssize_t n = -1;
+
+	if (closed)
+		*closed = false;
+	while (rounds--) {
+		reactor_poll(0);
+		if (fd == -1)
+			continue;
+		while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+			total += n;
+		if (n == 0) {
+			if (closed)
+				*closed = true;
+			break;
+		}
+	}
+	return total;
+}
+
+/**
+ * @brief Copy a message and damage it: flip, insert or remove a few bytes,
+ * truncate it, or replace it with random bytes.
+ *
+ * @param buf Where the message is written. Must hold BENCH_FUZZ_MAX bytes.
+ * @param m The message to start from.
+ *
+ * @return The length of the damaged message.
+ */
+static size_t bench_mutate(char *buf, const struct bench_msg *m)
+{
+	size_t len = m->len, i, pos;
+	unsigned int n = rng() % 4;
+
+	memcpy(buf, m->buf, len);
+	if (rng() % 8 == 0) {
+		len = rng() % BENCH_FUZZ_MAX;
+		for (i = 0; i < len; i++)
+			buf[i] = rng();
+		return len;
+	}
+	while (n--) {
+		pos = rng() % len;
+		switch (rng() % 4) {
+		case 0:
+			buf[pos] ^= 1 << (rng() % 8);
+			break;
+		case 1:
+			buf[pos] = rng() % 4 ? '\0' : rng();
+			break;
+		case 2:
+			if (len < BENCH_FUZZ_MAX - 1) {
+				memmove(buf + pos + 1, buf + pos, len - pos);
+				buf[pos] = rng();
+				len++;
+			}
+			break;
+		case 3:
+			if (len > 1) {
+				memmove(buf + pos, buf + pos + 1, len - pos - 1);
+				len--;
+			}
+			break;
+		}
+	}
+	if (rng() % 8 == 0)
+		len = rng() % len;
+	return len;
+}
+
+/**
+ * @brief Make a binary message for a random command, with a few small args.
+ *
+ * @param buf Where the message is written. Must hold BENCH_FUZZ_MAX bytes.
+ *
+ * @return The length of the message.
+ */
+static size_t bench_binary(char *buf)
+{
+	struct ipc_bin_msg hdr;
+	int32_t arg;
+	uint16_t i;
+
+	hdr.cmd = rng() % 4 ? rng() % 96 : UINT16_MAX - rng() % 4;
+	hdr.argc = rng() % 3;
+	memcpy(buf, &hdr, sizeof(hdr));
+	for (i = 0; i < hdr.argc; i++) {
+		arg = (int32_t)(rng() % 12) - 2;
+		memcpy(buf + sizeof(hdr) + i * sizeof(arg), &arg, sizeof(arg));
+	}
+	return sizeof(hdr) + hdr.argc * sizeof(arg);
+}
+
+/**
+ * @brief Check that howm still answers a valid framed message correctly.
+ *
+ * @return True if it does.
+ */
+static bool bench_alive(void)
+{
+	const struct bench_msg *m = &msgs[0];
+	char frame[64], reply[BENCH_IPC_REPLY];
+	uint32_t len = m->len;
+	int32_t err = -1;
+	size_t got = 0;
+	ssize_t n;
+	int fd = bench_connect("howm\x02\x00", 6);
+
+	memcpy(frame, &len, sizeof(len));
+	memcpy(frame + sizeof(len), m->buf, len);
+	if (send(fd, frame, sizeof(len) + len, MSG_NOSIGNAL) == -1) {
+		close(fd);
+		return false;
+	}
+	while (got < sizeof(reply)) {
+		reactor_poll(0);
+		n = recv(fd, reply + got, sizeof(reply) - got, 0);
+		if (n == 0)
+			break;
+		if (n > 0)
+			got += n;
+	}
+	close(fd);
+	memcpy(&len, reply, sizeof(len));
+	memcpy(&err, reply + sizeof(len), sizeof(err));
+	return got == sizeof(reply) && len == sizeof(err) && err == IPC_ERR_NONE;
+}
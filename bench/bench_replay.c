@@ -0,0 +1,171 @@
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+
+#include "bench.h"
+#include "handler.h"
+#include "helper.h"
+#include "howm.h"
+#include "ipc.h"
+#include "journal.h"
+#include "layout.h"
+#include "reactor.h"
+#include "stats.h"
+#include "xshim.h"
+
+/**
+ * @file bench_replay.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Replay a journal that was recorded with howm -j against the xcb
+ * shim, and report what it cost.
+ *
+ * Each event is passed to handle_event and each IPC message is processed as
+ * it was when it was received. At each point that the main loop did its
+ * deferred work, the replay does the same. Every replay of a journal sends
+ * the same requests, so the numbers can be compared before and after a
+ * change.
+ */
+
+/**
+ * @brief What has been replayed so far.
+ */
+struct replay_totals {
+	unsigned long events;
+	unsigned long msgs;
+	unsigned long failed; /**< Messages that didn't succeed when replayed. */
+	unsigned long loops;
+};
+
+static void replay_record(const struct journal_rec *rec, char *buf, void *data);
+static void replay_hist(const struct stats_hist *h);
+
+/**
+ * @brief Replay a journal and print the X requests that it sent, the round
+ * trips that it waited on and the time spent on each type of event and
+ * command.
+ *
+ * @param path The journal.
+ */
+void bench_replay(const char *path)
+{
+	struct replay_totals t = {0};
+	uint64_t start, ns;
+	uint16_t level = log_level;
+	char sock_path[108];
+	unsigned int i;
+	long cnt;
+
+	/* Text messages are looked up in the hash that ipc_init builds. */
+	snprintf(sock_path, sizeof(sock_path), "/tmp/howm-replay-%d", getpid());
+	setenv(ENV_SOCK_VAR, sock_path, 1);
+	reactor_init();
+	ipc_init();
+	bench_populate(0);
+	stats_reset();
+	xshim_reset();
+
+	/* Handling events and messages logs a lot, which would dominate the
+	 * times. */
+	log_level = LOG_NONE;
+	start = stats_now();
+	cnt = journal_replay(path, replay_record, &t);
+	ns = stats_now() - start;
+	log_level = level;
+	running = true;
+	ipc_cleanup();
+	reactor_cleanup();
+	if (cnt == -1) {
+		log_err("Couldn't replay the journal %s", path);
+		exit(EXIT_FAILURE);
+	}
+
+	printf("replayed %ld records in %.3f ms: %lu events, %lu messages "
+			"(%lu failed), %lu loops\n\n", cnt, ns / 1e6, t.events,
+			t.msgs, t.failed, t.loops);
+
+	printf("%-12s %12s\n", "requests", "count");
+	for (i = 0; i < END_XREQ; i++)
+		printf("%-12s %12lu\n", stats_xreq_names[i], stats_xreqs[i]);
+	printf("%-12s %12lu\n", "total", (unsigned long)xshim_seq);
+	printf("%-12s %12lu\n\n", "round trips", (unsigned long)xshim_replies);
+
+	printf("%-20s %8s %10s %10s %10s %10s\n", "handler", "count", "mean ns",
+			"p50 ns", "p99 ns", "max ns");
+	for (i = 0; i < STATS_MAX_EVENTS; i++)
+		if (stats_events[i])
+			replay_hist(stats_events[i]);
+	for (i = 0; i < STATS_MAX_CMDS; i++)
+		if (stats_cmds[i])
+			replay_hist(stats_cmds[i]);
+	printf("\n");
+}
+
+/**
+ * @brief Replay a single record of a journal.
+ *
+ * @param rec The record's header.
+ * @param buf The record's data.
+ * @param data The totals, which are updated.
+ */
+static void replay_record(const struct journal_rec *rec, char *buf, void *data)
+{
+	struct replay_totals *t = data;
+	struct journal_screen js;
+	xcb_generic_event_t ev;
+
+	switch (rec->type) {
+	case JOURNAL_SCREEN:
+		/* Events that were sent to the root window should still be
+		 * recognised as such. */
+		if (rec->len < sizeof(js))
+			break;
+		memcpy(&js, buf, sizeof(js));
+		screen->root = js.root;
+		break;
+	case JOURNAL_EVENT:
+		if (rec->len > sizeof(ev))
+			break;
+		memset(&ev, 0, sizeof(ev));
+		memcpy(&ev, buf, rec->len);
+		handle_event(&ev);
+		t->events++;
+		break;
+	case JOURNAL_TEXT:
+	case JOURNAL_BINARY:
+		if (ipc_replay(buf, rec->len, rec->type == JOURNAL_BINARY)
+				!= IPC_ERR_NONE)
+			t->failed++;
+		t->msgs++;
+		break;
+	case JOURNAL_LOOP:
+		handle_pending_replies();
+		arrange_dirty();
+		ipc_send_events();
+		t->loops++;
+		break;
+	}
+}
+
+/**
+ * @brief Print a summary of a histogram.
+ *
+ * @param h The histogram.
+ */
+static void replay_hist(const struct stats_hist *h)
+{
+	printf("%-20s %8lu %10.0f %10lu %10lu %10lu\n", h->name ? h->name : "unknown",
+			(unsigned long)h->count, (double)h->sum / h->count,
+			(unsigned long)stats_percentile(h, 50),
+			(unsigned long)stats_percentile(h, 99),
+			(unsigned long)h->max);
+}
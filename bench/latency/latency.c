@@ -0,0 +1,698 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+
+/**
+ * @file latency.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Measure howm's end-to-end latencies on a real X server.
+ *
+ * Xvfb and howm are started, then windows are created by separate X
+ * connections that stand in for clients. Commands are sent over howm's IPC
+ * socket and the clients wait for the events that show the command has taken
+ * effect:
+ *
+ * - change_ws: from sending the command until the last window of the new
+ *   workspace is mapped.
+ * - focus_next: from sending focus_next_client until another window gets
+ *   input focus.
+ * - map: from a client mapping a new window until it has been configured,
+ *   mapped and focused.
+ *
+ * Each latency is taken with the monotonic clock and with the X server's
+ * timestamps, which come from a property change on a probe window before and
+ * after each sample. Server timestamps are in milliseconds, but show the
+ * latency as the X server saw it.
+ */
+
+#define LAT_MAX_CLIENTS 512
+/** How long to wait for howm or the X server before giving up. */
+#define LAT_TIMEOUT_MS 5000
+#define LAT_WIDTH 1920
+#define LAT_HEIGHT 1080
+
+#define MSG(s) s, sizeof(s) - 1
+
+/**
+ * @brief A window, created by its own X connection.
+ */
+struct lat_client {
+	xcb_connection_t *c;
+	xcb_window_t win;
+	bool mapped; /**< Has the window been mapped since it was last
+		       unmapped? */
+	bool focused; /**< Does the window have input focus? */
+	bool focus_in; /**< Has the window received a FocusIn since this was
+			 last cleared? */
+	bool configured; /**< Has the window received a ConfigureNotify since
+			   this was last cleared? */
+};
+
+/**
+ * @brief The latencies that were measured for a scenario.
+ */
+struct lat_samples {
+	const char *name;
+	uint64_t *ns; /**< From the monotonic clock. */
+	uint64_t *server_ms; /**< From the X server's timestamps. */
+	unsigned int cnt;
+};
+
+static const char *display = ":99";
+static const char *howm_path = "./howm";
+static unsigned int client_cnt = 10;
+static unsigned int iters = 100;
+
+static pid_t xvfb_pid = -1;
+static pid_t howm_pid = -1;
+static int ipc_fd = -1;
+static char sock_path[108];
+
+static struct lat_client clients[LAT_MAX_CLIENTS];
+static unsigned int clients_len;
+
+static xcb_connection_t *probe;
+static xcb_window_t probe_win;
+
+static void lat_start_xvfb(void);
+static void lat_start_howm(void);
+static void lat_stop(void);
+static void lat_fail(const char *msg);
+static uint64_t lat_now(void);
+static void lat_cmd(const char *msg, size_t len);
+static bool lat_read(void *buf, size_t len);
+static struct lat_client *lat_client_new(void);
+static void lat_client_free(struct lat_client *cl);
+static bool lat_drain(void);
+static void lat_pump(uint64_t deadline);
+static void lat_handle(struct lat_client *cl, xcb_generic_event_t *ev);
+static bool lat_all_mapped(unsigned int first, unsigned int n, bool mapped);
+static bool lat_focus_moved(unsigned int prev);
+static unsigned int lat_wait_focused(unsigned int first, unsigned int n);
+static uint64_t lat_server_time(void);
+static void lat_wait_mapped(unsigned int first, unsigned int n, bool mapped);
+static void lat_samples_init(struct lat_samples *s, const char *name);
+static void lat_sample(struct lat_samples *s, uint64_t start, uint64_t server_start);
+static void lat_report(struct lat_samples *s);
+static int cmp_u64(const void *a, const void *b);
+static uint64_t lat_percentile(const uint64_t *sorted, unsigned int cnt,
+		unsigned int pct);
+
+int main(int argc, char *argv[])
+{
+	struct lat_samples ws_s, focus_s, map_s;
+	struct lat_client *cl;
+	uint64_t start, server_start;
+	unsigned int i, j, target = 0, prev;
+	char msg[32];
+	int ch, len;
+
+	while ((ch = getopt(argc, argv, "d:b:n:i:")) != -1) {
+		switch (ch) {
+		case 'd':
+			display = optarg;
+			break;
+		case 'b':
+			howm_path = optarg;
+			break;
+		case 'n':
+			client_cnt = strtoul(optarg, NULL, 10);
+			break;
+		case 'i':
+			iters = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "%s: [-d DISPLAY] [-b HOWM_PATH] [-n CLIENTS] "
+					"[-i ITERATIONS]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (client_cnt < 2 || client_cnt * 2 + 1 > LAT_MAX_CLIENTS || iters == 0) {
+		fprintf(stderr, "Need between 2 and %d clients and at least one "
+				"iteration.\n", (LAT_MAX_CLIENTS - 1) / 2);
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	lat_start_xvfb();
+	lat_start_howm();
+
+	/* Give workspace 0 and then workspace 1 their clients. */
+	lat_cmd(MSG("\x01\0add_ws\0"));
+	for (i = 0; i < 2; i++) {
+		len = snprintf(msg, sizeof(msg), "%c%cchange_ws%c%u", 1, 0, 0, i) + 1;
+		lat_cmd(msg, len);
+		if (i == 1)
+			lat_wait_mapped(0, client_cnt, false);
+		for (j = 0; j < client_cnt; j++) {
+			cl = lat_client_new();
+			xcb_map_window(cl->c, cl->win);
+			xcb_flush(cl->c);
+		}
+		lat_wait_mapped(i * client_cnt, client_cnt, true);
+	}
+
+	lat_samples_init(&ws_s, "change_ws");
+	for (i = 0; i < iters; i++) {
+		target = i % 2 == 0 ? 0 : 1;
+		len = snprintf(msg, sizeof(msg), "%c%cchange_ws%c%u", 1, 0, 0, target) + 1;
+		server_start = lat_server_time();
+		start = lat_now();
+		lat_cmd(msg, len);
+		lat_wait_mapped(target * client_cnt, client_cnt, true);
+		lat_sample(&ws_s, start, server_start);
+		lat_wait_mapped((1 - target) * client_cnt, client_cnt, false);
+	}
+
+	lat_samples_init(&focus_s, "focus_next");
+	for (i = 0; i < iters; i++) {
+		/* Wait for the focus to settle, so that a late FocusIn isn't
+		 * mistaken for the one that the command causes. */
+		prev = lat_wait_focused(target * client_cnt, client_cnt);
+		for (j = 0; j < clients_len; j++)
+			clients[j].focus_in = false;
+		server_start = lat_server_time();
+		start = lat_now();
+		lat_cmd(MSG("\x01\0focus_next_client\0"));
+		while (!lat_focus_moved(prev))
+			lat_pump(start + LAT_TIMEOUT_MS * 1000000ull);
+		lat_sample(&focus_s, start, server_start);
+	}
+
+	lat_samples_init(&map_s, "map");
+	for (i = 0; i < iters; i++) {
+		cl = lat_client_new();
+		server_start = lat_server_time();
+		start = lat_now();
+		xcb_map_window(cl->c, cl->win);
+		xcb_flush(cl->c);
+		while (!cl->mapped || !cl->focused || !cl->configured)
+			lat_pump(start + LAT_TIMEOUT_MS * 1000000ull);
+		lat_sample(&map_s, start, server_start);
+		lat_client_free(cl);
+	}
+
+	printf("%u clients per workspace, %u iterations\n\n", client_cnt, iters);
+	printf("%-12s %10s %10s %10s %10s %10s %10s\n", "scenario", "p50 us",
+			"p90 us", "p99 us", "max us", "x p50 ms", "x p99 ms");
+	lat_report(&ws_s);
+	lat_report(&focus_s);
+	lat_report(&map_s);
+
+	lat_stop();
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Start Xvfb and connect the probe to it, which is used to read the X
+ * server's time.
+ */
+static void lat_start_xvfb(void)
+{
+	xcb_screen_t *scr;
+	uint32_t mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+	uint64_t deadline = lat_now() + LAT_TIMEOUT_MS * 1000000ull;
+	char geom[32];
+
+	snprintf(geom, sizeof(geom), "%dx%dx24", LAT_WIDTH, LAT_HEIGHT);
+	xvfb_pid = fork();
+	if (xvfb_pid == 0) {
+		execlp("Xvfb", "Xvfb", display, "-screen", "0", geom, "-nolisten",
+				"tcp", (char *)NULL);
+		perror("Couldn't start Xvfb");
+		_exit(EXIT_FAILURE);
+	}
+
+	for (;;) {
+		probe = xcb_connect(display, NULL);
+		if (!xcb_connection_has_error(probe))
+			break;
+		xcb_disconnect(probe);
+		if (lat_now() > deadline || waitpid(xvfb_pid, NULL, WNOHANG) != 0) {
+			xvfb_pid = -1;
+			lat_fail("Xvfb didn't start");
+		}
+		usleep(10000);
+	}
+
+	scr = xcb_setup_roots_iterator(xcb_get_setup(probe)).data;
+	probe_win = xcb_generate_id(probe);
+	xcb_create_window(probe, XCB_COPY_FROM_PARENT, probe_win, scr->root,
+			-1, -1, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_ONLY,
+			XCB_COPY_FROM_PARENT, XCB_CW_EVENT_MASK, &mask);
+	xcb_flush(probe);
+}
+
+/**
+ * @brief Start howm on Xvfb and connect to its IPC socket.
+ *
+ * The config is /bin/true, so that howm starts with its defaults.
+ */
+static void lat_start_howm(void)
+{
+	struct sockaddr_un addr;
+	uint64_t deadline = lat_now() + LAT_TIMEOUT_MS * 1000000ull;
+	char echo[6];
+
+	snprintf(sock_path, sizeof(sock_path), "/tmp/howm-latency-%d", getpid());
+	howm_pid = fork();
+	if (howm_pid == 0) {
+		setenv("DISPLAY", display, 1);
+		setenv("HOWM_SOCK", sock_path, 1);
+		execl(howm_path, howm_path, "-c", "/bin/true", (char *)NULL);
+		perror("Couldn't start howm");
+		_exit(EXIT_FAILURE);
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", sock_path);
+	for (;;) {
+		ipc_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (ipc_fd == -1)
+			lat_fail("Couldn't create a socket");
+		if (connect(ipc_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+			break;
+		close(ipc_fd);
+		ipc_fd = -1;
+		if (lat_now() > deadline || waitpid(howm_pid, NULL, WNOHANG) != 0) {
+			howm_pid = -1;
+			lat_fail("howm didn't start");
+		}
+		usleep(10000);
+	}
+
+	/* A framed text connection. howm only replies to the first command
+	 * once it is managing windows. */
+	if (write(ipc_fd, "howm\x02\x00", sizeof(echo)) != sizeof(echo)
+			|| !lat_read(echo, sizeof(echo)))
+		lat_fail("howm didn't accept the handshake");
+}
+
+/**
+ * @brief Stop howm and Xvfb.
+ */
+static void lat_stop(void)
+{
+	while (clients_len)
+		lat_client_free(&clients[clients_len - 1]);
+	if (ipc_fd != -1)
+		close(ipc_fd);
+	if (probe)
+		xcb_disconnect(probe);
+	if (howm_pid > 0) {
+		kill(howm_pid, SIGTERM);
+		waitpid(howm_pid, NULL, 0);
+	}
+	if (xvfb_pid > 0) {
+		kill(xvfb_pid, SIGTERM);
+		waitpid(xvfb_pid, NULL, 0);
+	}
+}
+
+/**
+ * @brief Stop everything and exit, after something went wrong.
+ *
+ * @param msg What went wrong.
+ */
+static void lat_fail(const char *msg)
+{
+	fprintf(stderr, "%s.\n", msg);
+	lat_stop();
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Read the monotonic clock.
+ *
+ * @return The current time, in nanoseconds.
+ */
+static uint64_t lat_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Send a text command to howm and wait for it to succeed.
+ *
+ * @param msg The command, which includes its message type.
+ * @param len The length of msg.
+ */
+static void lat_cmd(const char *msg, size_t len)
+{
+	char frame[64];
+	uint32_t n = len;
+	int32_t err;
+
+	memcpy(frame, &n, sizeof(n));
+	memcpy(frame + sizeof(n), msg, len);
+	if (write(ipc_fd, frame, sizeof(n) + len) != (ssize_t)(sizeof(n) + len)
+			|| !lat_read(&n, sizeof(n)) || n != sizeof(err)
+			|| !lat_read(&err, sizeof(err)))
+		lat_fail("Lost the connection to howm");
+	if (err != 0) {
+		fprintf(stderr, "howm rejected %s with error %d.\n", msg + 2, err);
+		lat_fail("A command failed");
+	}
+}
+
+/**
+ * @brief Read exactly len bytes from howm's socket.
+ *
+ * @param buf Where the bytes are stored.
+ * @param len How many bytes to read.
+ *
+ * @return False if the connection was closed.
+ */
+static bool lat_read(void *buf, size_t len)
+{
+	char *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = read(ipc_fd, p, len);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+/**
+ * @brief Connect a new client to the X server and create its window, which
+ * isn't mapped.
+ *
+ * @return The client.
+ */
+static struct lat_client *lat_client_new(void)
+{
+	struct lat_client *cl = &clients[clients_len];
+	xcb_screen_t *scr;
+	uint32_t mask = XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_FOCUS_CHANGE;
+
+	if (clients_len == LAT_MAX_CLIENTS)
+		lat_fail("Too many clients");
+	memset(cl, 0, sizeof(*cl));
+	cl->c = xcb_connect(display, NULL);
+	if (xcb_connection_has_error(cl->c))
+		lat_fail("Couldn't connect a client to the X server");
+	scr = xcb_setup_roots_iterator(xcb_get_setup(cl->c)).data;
+	cl->win = xcb_generate_id(cl->c);
+	xcb_create_window(cl->c, XCB_COPY_FROM_PARENT, cl->win, scr->root,
+			0, 0, 100, 100, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+			XCB_COPY_FROM_PARENT, XCB_CW_EVENT_MASK, &mask);
+	xcb_flush(cl->c);
+	clients_len++;
+	return cl;
+}
+
+/**
+ * @brief Disconnect the last client that was created, which destroys its
+ * window.
+ *
+ * @param cl The client.
+ */
+static void lat_client_free(struct lat_client *cl)
+{
+	xcb_disconnect(cl->c);
+	clients_len = cl - clients;
+}
+
+/**
+ * @brief Handle the events that have already arrived for any client.
+ *
+ * @return True if any events were handled.
+ */
+static bool lat_drain(void)
+{
+	xcb_generic_event_t *ev;
+	unsigned int i;
+	bool handled = false;
+
+	for (i = 0; i < clients_len; i++) {
+		while ((ev = xcb_poll_for_event(clients[i].c)) != NULL) {
+			lat_handle(&clients[i], ev);
+			free(ev);
+			handled = true;
+		}
+	}
+	return handled;
+}
+
+/**
+ * @brief Handle the events that arrive for any client, waiting for at least
+ * one of them.
+ *
+ * @param deadline When to give up, from lat_now().
+ */
+static void lat_pump(uint64_t deadline)
+{
+	struct pollfd fds[LAT_MAX_CLIENTS];
+	uint64_t now = lat_now();
+	unsigned int i;
+
+	if (lat_drain())
+		return;
+	if (now > deadline)
+		lat_fail("Timed out waiting for howm");
+	for (i = 0; i < clients_len; i++) {
+		fds[i].fd = xcb_get_file_descriptor(clients[i].c);
+		fds[i].events = POLLIN;
+	}
+	poll(fds, clients_len, (deadline - now) / 1000000 + 1);
+}
+
+/**
+ * @brief Update a client's state from one of its events.
+ *
+ * @param cl The client.
+ * @param ev The event.
+ */
+static void lat_handle(struct lat_client *cl, xcb_generic_event_t *ev)
+{
+	xcb_focus_in_event_t *fe = (xcb_focus_in_event_t *)ev;
+
+	switch (ev->response_type & ~0x80) {
+	case XCB_MAP_NOTIFY:
+		cl->mapped = true;
+		break;
+	case XCB_UNMAP_NOTIFY:
+		cl->mapped = false;
+		break;
+	case XCB_CONFIGURE_NOTIFY:
+		cl->configured = true;
+		break;
+	case XCB_FOCUS_IN:
+		if (fe->detail == XCB_NOTIFY_DETAIL_POINTER)
+			break;
+		cl->focused = true;
+		cl->focus_in = true;
+		break;
+	case XCB_FOCUS_OUT:
+		if (fe->detail != XCB_NOTIFY_DETAIL_POINTER)
+			cl->focused = false;
+		break;
+	}
+}
+
+/**
+ * @brief Check whether a range of clients are all mapped, or all unmapped.
+ *
+ * @param first The index of the first client.
+ * @param n How many clients to check.
+ * @param mapped Whether they should be mapped.
+ *
+ * @return True if they all are.
+ */
+static bool lat_all_mapped(unsigned int first, unsigned int n, bool mapped)
+{
+	unsigned int i;
+
+	for (i = first; i < first + n; i++)
+		if (clients[i].mapped != mapped)
+			return false;
+	return true;
+}
+
+/**
+ * @brief Check whether the focus has moved from a client to another one.
+ *
+ * @param prev The index of the client that had focus.
+ *
+ * @return True if another client has received a FocusIn since focus_in was
+ * cleared.
+ */
+static bool lat_focus_moved(unsigned int prev)
+{
+	unsigned int i;
+
+	for (i = 0; i < clients_len; i++)
+		if (i != prev && clients[i].focus_in)
+			return true;
+	return false;
+}
+
+/**
+ * @brief Wait until one of a range of clients has focus, and then handle any
+ * events that have already arrived.
+ *
+ * @param first The index of the first client.
+ * @param n How many clients to check.
+ *
+ * @return The index of the focused client.
+ */
+static unsigned int lat_wait_focused(unsigned int first, unsigned int n)
+{
+	uint64_t deadline = lat_now() + LAT_TIMEOUT_MS * 1000000ull;
+	unsigned int i;
+
+	for (;;) {
+		/* After a round trip, the focus events that the X server had
+		 * already sent have arrived. */
+		lat_server_time();
+		lat_drain();
+		for (i = first; i < first + n; i++)
+			if (clients[i].focused)
+				return i;
+		lat_pump(deadline);
+	}
+}
+
+/**
+ * @brief Wait until a range of clients are all mapped, or all unmapped.
+ *
+ * @param first The index of the first client.
+ * @param n How many clients to wait for.
+ * @param mapped Whether they should be mapped.
+ */
+static void lat_wait_mapped(unsigned int first, unsigned int n, bool mapped)
+{
+	uint64_t deadline = lat_now() + LAT_TIMEOUT_MS * 1000000ull;
+
+	while (!lat_all_mapped(first, n, mapped))
+		lat_pump(deadline);
+}
+
+/**
+ * @brief Read the X server's time, by changing a property on the probe window
+ * and waiting for the PropertyNotify.
+ *
+ * @return The X server's time, in milliseconds.
+ */
+static uint64_t lat_server_time(void)
+{
+	xcb_generic_event_t *ev;
+	xcb_timestamp_t t;
+
+	xcb_change_property(probe, XCB_PROP_MODE_APPEND, probe_win,
+			XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, 0, NULL);
+	xcb_flush(probe);
+	while ((ev = xcb_wait_for_event(probe)) != NULL) {
+		if ((ev->response_type & ~0x80) == XCB_PROPERTY_NOTIFY) {
+			t = ((xcb_property_notify_event_t *)ev)->time;
+			free(ev);
+			return t;
+		}
+		free(ev);
+	}
+	lat_fail("Lost the connection to the X server");
+	return 0;
+}
+
+/**
+ * @brief Allocate room for a sample from each iteration.
+ *
+ * @param s The samples.
+ * @param name The name of the scenario.
+ */
+static void lat_samples_init(struct lat_samples *s, const char *name)
+{
+	s->name = name;
+	s->cnt = 0;
+	s->ns = calloc(iters, sizeof(*s->ns));
+	s->server_ms = calloc(iters, sizeof(*s->server_ms));
+	if (!s->ns || !s->server_ms)
+		lat_fail("Out of memory");
+}
+
+/**
+ * @brief Record a latency that has just finished.
+ *
+ * @param s The samples.
+ * @param start When the latency started, from lat_now().
+ * @param server_start When the latency started, from lat_server_time().
+ */
+static void lat_sample(struct lat_samples *s, uint64_t start, uint64_t server_start)
+{
+	s->ns[s->cnt] = lat_now() - start;
+	s->server_ms[s->cnt++] = (uint32_t)(lat_server_time() - server_start);
+}
+
+/**
+ * @brief Print the percentiles of a scenario's latencies.
+ *
+ * @param s The samples, which are sorted.
+ */
+static void lat_report(struct lat_samples *s)
+{
+	qsort(s->ns, s->cnt, sizeof(*s->ns), cmp_u64);
+	qsort(s->server_ms, s->cnt, sizeof(*s->server_ms), cmp_u64);
+	printf("%-12s %10.1f %10.1f %10.1f %10.1f %10lu %10lu\n", s->name,
+			lat_percentile(s->ns, s->cnt, 50) / 1e3,
+			lat_percentile(s->ns, s->cnt, 90) / 1e3,
+			lat_percentile(s->ns, s->cnt, 99) / 1e3,
+			s->ns[s->cnt - 1] / 1e3,
+			(unsigned long)lat_percentile(s->server_ms, s->cnt, 50),
+			(unsigned long)lat_percentile(s->server_ms, s->cnt, 99));
+	free(s->ns);
+	free(s->server_ms);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Find a percentile of some sorted samples.
+ *
+ * @param sorted The samples, in ascending order.
+ * @param cnt How many samples there are. Must not be 0.
+ * @param pct The percentile, from 0 to 100.
+ *
+ * @return The smallest sample that at least pct percent of the samples are
+ * less than or equal to.
+ */
+static uint64_t lat_percentile(const uint64_t *sorted, unsigned int cnt,
+		unsigned int pct)
+{
+	uint64_t i = ((uint64_t)cnt * pct + 99) / 100;
+
+	return sorted[i ? i - 1 : 0];
+}
@@ -0,0 +1,794 @@
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/randr.h>
+#include <xcb/xcb.h>
+#include <xcb/xcb_ewmh.h>
+#include <xcb/xcb_icccm.h>
+#include <xcb/xcbext.h>
+
+#include "helper.h"
+#include "xshim.h"
+
+/**
+ * @file xshim.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief A stand in for the parts of xcb, xcb-ewmh, xcb-icccm and xcb-randr
+ * that howm uses, so that howm can be linked and run without an X server.
+ *
+ * Requests are recorded in an in-memory log instead of being sent. Requests
+ * that expect a reply are answered as if by a server with a single screen, no
+ * RandR and windows that have no properties set.
+ */
+
+/** The size of the screen that the shim pretends to have. */
+#define XSHIM_WIDTH 1920
+#define XSHIM_HEIGHT 1080
+#define XSHIM_ROOT 1
+
+struct xshim_req xshim_log[XSHIM_LOG_SIZE];
+/** The number of requests that have ever been sent. */
+uint64_t xshim_seq;
+/** The number of requests that have been sent with each major opcode. */
+uint64_t xshim_counts[256];
+/** The number of times that howm has waited for a reply. */
+uint64_t xshim_replies;
+/** The number of windows that the root window has, which are numbered from
+ * XSHIM_FIRST_CHILD. */
+unsigned int xshim_tree_len;
+
+xcb_extension_t xcb_randr_id = { "RANDR", 0 };
+
+static int conn_dummy;
+static xcb_screen_t shim_screen = {
+	.root = XSHIM_ROOT,
+	.width_in_pixels = XSHIM_WIDTH,
+	.height_in_pixels = XSHIM_HEIGHT,
+	.root_depth = 24,
+};
+static xcb_setup_t shim_setup = { .roots_len = 1 };
+static xcb_query_extension_reply_t no_extension = { .present = 0 };
+static xcb_atom_t next_atom = 1;
+
+static unsigned int xshim_record(uint8_t opcode, xcb_window_t win, uint16_t mask);
+static void *xshim_reply(size_t size);
+
+/**
+ * @brief Forget every request that has been recorded.
+ */
+void xshim_reset(void)
+{
+	xshim_seq = 0;
+	xshim_replies = 0;
+	memset(xshim_counts, 0, sizeof(xshim_counts));
+}
+
+/**
+ * @brief Record a request in the log.
+ *
+ * @param opcode The major opcode of the request.
+ * @param win The window that the request is for, or XCB_NONE.
+ * @param mask The request's value mask, or 0.
+ *
+ * @return The sequence number of the request.
+ */
+static unsigned int xshim_record(uint8_t opcode, xcb_window_t win, uint16_t mask)
+{
+	struct xshim_req *r = &xshim_log[xshim_seq & (XSHIM_LOG_SIZE - 1)];
+
+	r->opcode = opcode;
+	r->win = win;
+	r->mask = mask;
+	xshim_counts[opcode]++;
+	return ++xshim_seq;
+}
+
+/**
+ * @brief Allocate an empty reply, which the caller frees as it would one
+ * from xcb.
+ *
+ * @param size The size of the reply.
+ *
+ * @return The reply, or NULL.
+ */
+static void *xshim_reply(size_t size)
+{
+	xshim_replies++;
+	return calloc(1, size);
+}
+
+xcb_connection_t *xcb_connect(const char *displayname, int *screenp)
+{
+	UNUSED(displayname);
+	if (screenp)
+		*screenp = 0;
+	return (xcb_connection_t *)&conn_dummy;
+}
+
+void xcb_disconnect(xcb_connection_t *c)
+{
+	UNUSED(c);
+}
+
+int xcb_connection_has_error(xcb_connection_t *c)
+{
+	UNUSED(c);
+	return 0;
+}
+
+int xcb_flush(xcb_connection_t *c)
+{
+	UNUSED(c);
+	return 1;
+}
+
+int xcb_get_file_descriptor(xcb_connection_t *c)
+{
+	UNUSED(c);
+	return -1;
+}
+
+const struct xcb_setup_t *xcb_get_setup(xcb_connection_t *c)
+{
+	UNUSED(c);
+	return &shim_setup;
+}
+
+xcb_screen_iterator_t xcb_setup_roots_iterator(const xcb_setup_t *R)
+{
+	xcb_screen_iterator_t it = { &shim_screen, R->roots_len, 0 };
+
+	return it;
+}
+
+void xcb_prefetch_extension_data(xcb_connection_t *c, xcb_extension_t *ext)
+{
+	UNUSED(c);
+	UNUSED(ext);
+}
+
+const struct xcb_query_extension_reply_t *xcb_get_extension_data(
+		xcb_connection_t *c, xcb_extension_t *ext)
+{
+	UNUSED(c);
+	UNUSED(ext);
+	return &no_extension;
+}
+
+xcb_generic_event_t *xcb_poll_for_event(xcb_connection_t *c)
+{
+	UNUSED(c);
+	return NULL;
+}
+
+xcb_generic_event_t *xcb_poll_for_queued_event(xcb_connection_t *c)
+{
+	UNUSED(c);
+	return NULL;
+}
+
+xcb_generic_error_t *xcb_request_check(xcb_connection_t *c, xcb_void_cookie_t cookie)
+{
+	UNUSED(c);
+	UNUSED(cookie);
+	xshim_replies++;
+	return NULL;
+}
+
+void xcb_discard_reply(xcb_connection_t *c, unsigned int sequence)
+{
+	UNUSED(c);
+	UNUSED(sequence);
+}
+
+xcb_void_cookie_t xcb_configure_window(xcb_connection_t *c, xcb_window_t window,
+		uint16_t value_mask, const void *value_list)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_CONFIGURE_WINDOW, window, value_mask) };
+
+	UNUSED(c);
+	UNUSED(value_list);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_map_window(xcb_connection_t *c, xcb_window_t window)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_MAP_WINDOW, window, 0) };
+
+	UNUSED(c);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_unmap_window(xcb_connection_t *c, xcb_window_t window)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_UNMAP_WINDOW, window, 0) };
+
+	UNUSED(c);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_change_window_attributes(xcb_connection_t *c,
+		xcb_window_t window, uint32_t value_mask, const void *value_list)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_CHANGE_WINDOW_ATTRIBUTES,
+			window, value_mask) };
+
+	UNUSED(c);
+	UNUSED(value_list);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_change_window_attributes_checked(xcb_connection_t *c,
+		xcb_window_t window, uint32_t value_mask, const void *value_list)
+{
+	return xcb_change_window_attributes(c, window, value_mask, value_list);
+}
+
+xcb_void_cookie_t xcb_change_property(xcb_connection_t *c, uint8_t mode,
+		xcb_window_t window, xcb_atom_t property, xcb_atom_t type,
+		uint8_t format, uint32_t data_len, const void *data)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_CHANGE_PROPERTY, window, 0) };
+
+	UNUSED(c);
+	UNUSED(mode);
+	UNUSED(property);
+	UNUSED(type);
+	UNUSED(format);
+	UNUSED(data_len);
+	UNUSED(data);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_set_input_focus(xcb_connection_t *c, uint8_t revert_to,
+		xcb_window_t focus, xcb_timestamp_t time)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_SET_INPUT_FOCUS, focus, 0) };
+
+	UNUSED(c);
+	UNUSED(revert_to);
+	UNUSED(time);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_warp_pointer(xcb_connection_t *c, xcb_window_t src_window,
+		xcb_window_t dst_window, int16_t src_x, int16_t src_y,
+		uint16_t src_width, uint16_t src_height, int16_t dst_x, int16_t dst_y)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_WARP_POINTER, dst_window, 0) };
+
+	UNUSED(c);
+	UNUSED(src_window);
+	UNUSED(src_x);
+	UNUSED(src_y);
+	UNUSED(src_width);
+	UNUSED(src_height);
+	UNUSED(dst_x);
+	UNUSED(dst_y);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_grab_button(xcb_connection_t *c, uint8_t owner_events,
+		xcb_window_t grab_window, uint16_t event_mask, uint8_t pointer_mode,
+		uint8_t keyboard_mode, xcb_window_t confine_to, xcb_cursor_t cursor,
+		uint8_t button, uint16_t modifiers)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_GRAB_BUTTON, grab_window, 0) };
+
+	UNUSED(c);
+	UNUSED(owner_events);
+	UNUSED(event_mask);
+	UNUSED(pointer_mode);
+	UNUSED(keyboard_mode);
+	UNUSED(confine_to);
+	UNUSED(cursor);
+	UNUSED(button);
+	UNUSED(modifiers);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_ungrab_button(xcb_connection_t *c, uint8_t button,
+		xcb_window_t grab_window, uint16_t modifiers)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_UNGRAB_BUTTON, grab_window, 0) };
+
+	UNUSED(c);
+	UNUSED(button);
+	UNUSED(modifiers);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_allow_events(xcb_connection_t *c, uint8_t mode,
+		xcb_timestamp_t time)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_ALLOW_EVENTS, XCB_NONE, 0) };
+
+	UNUSED(c);
+	UNUSED(mode);
+	UNUSED(time);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_send_event(xcb_connection_t *c, uint8_t propagate,
+		xcb_window_t destination, uint32_t event_mask, const char *event)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_SEND_EVENT, destination, 0) };
+
+	UNUSED(c);
+	UNUSED(propagate);
+	UNUSED(event_mask);
+	UNUSED(event);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_kill_client(xcb_connection_t *c, uint32_t resource)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_KILL_CLIENT, resource, 0) };
+
+	UNUSED(c);
+	return ck;
+}
+
+xcb_intern_atom_cookie_t xcb_intern_atom(xcb_connection_t *c, uint8_t only_if_exists,
+		uint16_t name_len, const char *name)
+{
+	xcb_intern_atom_cookie_t ck = { xshim_record(XCB_INTERN_ATOM, XCB_NONE, 0) };
+
+	UNUSED(c);
+	UNUSED(only_if_exists);
+	UNUSED(name_len);
+	UNUSED(name);
+	return ck;
+}
+
+xcb_intern_atom_reply_t *xcb_intern_atom_reply(xcb_connection_t *c,
+		xcb_intern_atom_cookie_t cookie, xcb_generic_error_t **e)
+{
+	xcb_intern_atom_reply_t *r = xshim_reply(sizeof(*r));
+
+	UNUSED(c);
+	UNUSED(cookie);
+	if (e)
+		*e = NULL;
+	if (r)
+		r->atom = next_atom++;
+	return r;
+}
+
+xcb_get_window_attributes_cookie_t xcb_get_window_attributes(xcb_connection_t *c,
+		xcb_window_t window)
+{
+	xcb_get_window_attributes_cookie_t ck = {
+		xshim_record(XCB_GET_WINDOW_ATTRIBUTES, window, 0) };
+
+	UNUSED(c);
+	return ck;
+}
+
+xcb_get_window_attributes_reply_t *xcb_get_window_attributes_reply(
+		xcb_connection_t *c, xcb_get_window_attributes_cookie_t cookie,
+		xcb_generic_error_t **e)
+{
+	xcb_get_window_attributes_reply_t *r = xshim_reply(sizeof(*r));
+
+	UNUSED(c);
+	UNUSED(cookie);
+	if (e)
+		*e = NULL;
+	if (r)
+		r->map_state = XCB_MAP_STATE_VIEWABLE;
+	return r;
+}
+
+xcb_query_tree_cookie_t xcb_query_tree(xcb_connection_t *c, xcb_window_t window)
+{
+	xcb_query_tree_cookie_t ck = { xshim_record(XCB_QUERY_TREE, window, 0) };
+
+	UNUSED(c);
+	return ck;
+}
+
+xcb_query_tree_reply_t *xcb_query_tree_reply(xcb_connection_t *c,
+		xcb_query_tree_cookie_t cookie, xcb_generic_error_t **e)
+{
+	xcb_query_tree_reply_t *r;
+	xcb_window_t *children;
+	unsigned int i;
+
+	UNUSED(c);
+	UNUSED(cookie);
+	if (e)
+		*e = NULL;
+	r = xshim_reply(sizeof(*r) + xshim_tree_len * sizeof(xcb_window_t));
+	if (!r)
+		return NULL;
+	r->root = XSHIM_ROOT;
+	r->children_len = xshim_tree_len;
+	children = (xcb_window_t *)(r + 1);
+	for (i = 0; i < xshim_tree_len; i++)
+		children[i] = XSHIM_FIRST_CHILD + i;
+	return r;
+}
+
+int xcb_query_tree_children_length(const xcb_query_tree_reply_t *R)
+{
+	return R->children_len;
+}
+
+xcb_window_t *xcb_query_tree_children(const xcb_query_tree_reply_t *R)
+{
+	return (xcb_window_t *)(R + 1);
+}
+
+xcb_get_geometry_cookie_t xcb_get_geometry_unchecked(xcb_connection_t *c,
+		xcb_drawable_t drawable)
+{
+	xcb_get_geometry_cookie_t ck = { xshim_record(XCB_GET_GEOMETRY, drawable, 0) };
+
+	UNUSED(c);
+	return ck;
+}
+
+xcb_get_geometry_reply_t *xcb_get_geometry_reply(xcb_connection_t *c,
+		xcb_get_geometry_cookie_t cookie, xcb_generic_error_t **e)
+{
+	xcb_get_geometry_reply_t *r = xshim_reply(sizeof(*r));
+
+	UNUSED(c);
+	UNUSED(cookie);
+	if (e)
+		*e = NULL;
+	if (r) {
+		r->width = XSHIM_WIDTH / 2;
+		r->height = XSHIM_HEIGHT / 2;
+	}
+	return r;
+}
+
+xcb_alloc_color_cookie_t xcb_alloc_color(xcb_connection_t *c, xcb_colormap_t cmap,
+		uint16_t red, uint16_t green, uint16_t blue)
+{
+	xcb_alloc_color_cookie_t ck = { xshim_record(XCB_ALLOC_COLOR, XCB_NONE, 0) };
+
+	UNUSED(c);
+	UNUSED(cmap);
+	UNUSED(red);
+	UNUSED(green);
+	UNUSED(blue);
+	return ck;
+}
+
+xcb_alloc_color_reply_t *xcb_alloc_color_reply(xcb_connection_t *c,
+		xcb_alloc_color_cookie_t cookie, xcb_generic_error_t **e)
+{
+	UNUSED(c);
+	UNUSED(cookie);
+	if (e)
+		*e = NULL;
+	return xshim_reply(sizeof(xcb_alloc_color_reply_t));
+}
+
+/* ICCCM */
+
+xcb_get_property_cookie_t xcb_icccm_get_wm_protocols_unchecked(xcb_connection_t *c,
+		xcb_window_t window, xcb_atom_t wm_protocol_atom)
+{
+	xcb_get_property_cookie_t ck = { xshim_record(XCB_GET_PROPERTY, window, 0) };
+
+	UNUSED(c);
+	UNUSED(wm_protocol_atom);
+	return ck;
+}
+
+uint8_t xcb_icccm_get_wm_protocols_reply(xcb_connection_t *c,
+		xcb_get_property_cookie_t cookie,
+		xcb_icccm_get_wm_protocols_reply_t *protocols, xcb_generic_error_t **e)
+{
+	UNUSED(c);
+	UNUSED(cookie);
+	UNUSED(protocols);
+	if (e)
+		*e = NULL;
+	xshim_replies++;
+	return 0;
+}
+
+void xcb_icccm_get_wm_protocols_reply_wipe(xcb_icccm_get_wm_protocols_reply_t *protocols)
+{
+	UNUSED(protocols);
+}
+
+xcb_get_property_cookie_t xcb_icccm_get_wm_transient_for_unchecked(xcb_connection_t *c,
+		xcb_window_t window)
+{
+	xcb_get_property_cookie_t ck = { xshim_record(XCB_GET_PROPERTY, window, 0) };
+
+	UNUSED(c);
+	return ck;
+}
+
+uint8_t xcb_icccm_get_wm_transient_for_reply(xcb_connection_t *c,
+		xcb_get_property_cookie_t cookie, xcb_window_t *prop,
+		xcb_generic_error_t **e)
+{
+	UNUSED(c);
+	UNUSED(cookie);
+	UNUSED(prop);
+	if (e)
+		*e = NULL;
+	xshim_replies++;
+	return 0;
+}
+
+/* EWMH */
+
+xcb_intern_atom_cookie_t *xcb_ewmh_init_atoms(xcb_connection_t *c,
+		xcb_ewmh_connection_t *ewmh)
+{
+	ewmh->connection = c;
+	xshim_record(XCB_INTERN_ATOM, XCB_NONE, 0);
+	return calloc(1, sizeof(xcb_intern_atom_cookie_t));
+}
+
+uint8_t xcb_ewmh_init_atoms_replies(xcb_ewmh_connection_t *ewmh,
+		xcb_intern_atom_cookie_t *ewmh_cookies, xcb_generic_error_t **e)
+{
+	UNUSED(ewmh);
+	free(ewmh_cookies);
+	if (e)
+		*e = NULL;
+	xshim_replies++;
+	return 1;
+}
+
+xcb_get_property_cookie_t xcb_ewmh_get_wm_window_type(xcb_ewmh_connection_t *ewmh,
+		xcb_window_t window)
+{
+	xcb_get_property_cookie_t ck = { xshim_record(XCB_GET_PROPERTY, window, 0) };
+
+	UNUSED(ewmh);
+	return ck;
+}
+
+uint8_t xcb_ewmh_get_atoms_reply(xcb_ewmh_connection_t *ewmh,
+		xcb_get_property_cookie_t cookie, xcb_ewmh_get_atoms_reply_t *atoms,
+		xcb_generic_error_t **e)
+{
+	UNUSED(ewmh);
+	UNUSED(cookie);
+	UNUSED(atoms);
+	if (e)
+		*e = NULL;
+	xshim_replies++;
+	return 0;
+}
+
+void xcb_ewmh_get_atoms_reply_wipe(xcb_ewmh_get_atoms_reply_t *data)
+{
+	UNUSED(data);
+}
+
+xcb_void_cookie_t xcb_ewmh_set_supported(xcb_ewmh_connection_t *ewmh, int screen_nbr,
+		uint32_t list_len, xcb_atom_t *list)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_CHANGE_PROPERTY, XSHIM_ROOT, 0) };
+
+	UNUSED(ewmh);
+	UNUSED(screen_nbr);
+	UNUSED(list_len);
+	UNUSED(list);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_ewmh_set_supporting_wm_check(xcb_ewmh_connection_t *ewmh,
+		xcb_window_t parent_window, xcb_window_t child_window)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_CHANGE_PROPERTY, parent_window, 0) };
+
+	UNUSED(ewmh);
+	UNUSED(child_window);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_ewmh_set_wm_name(xcb_ewmh_connection_t *ewmh,
+		xcb_window_t window, uint32_t strings_len, const char *strings)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_CHANGE_PROPERTY, window, 0) };
+
+	UNUSED(ewmh);
+	UNUSED(strings_len);
+	UNUSED(strings);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_ewmh_set_desktop_viewport(xcb_ewmh_connection_t *ewmh,
+		int screen_nbr, uint32_t list_len, xcb_ewmh_coordinates_t *list)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_CHANGE_PROPERTY, XSHIM_ROOT, 0) };
+
+	UNUSED(ewmh);
+	UNUSED(screen_nbr);
+	UNUSED(list_len);
+	UNUSED(list);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_ewmh_set_desktop_geometry(xcb_ewmh_connection_t *ewmh,
+		int screen_nbr, uint32_t new_width, uint32_t new_height)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_CHANGE_PROPERTY, XSHIM_ROOT, 0) };
+
+	UNUSED(ewmh);
+	UNUSED(screen_nbr);
+	UNUSED(new_width);
+	UNUSED(new_height);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_ewmh_set_current_desktop(xcb_ewmh_connection_t *ewmh,
+		int screen_nbr, uint32_t new_current_desktop)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_CHANGE_PROPERTY, XSHIM_ROOT, 0) };
+
+	UNUSED(ewmh);
+	UNUSED(screen_nbr);
+	UNUSED(new_current_desktop);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_ewmh_set_number_of_desktops(xcb_ewmh_connection_t *ewmh,
+		int screen_nbr, uint32_t number_of_desktops)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_CHANGE_PROPERTY, XSHIM_ROOT, 0) };
+
+	UNUSED(ewmh);
+	UNUSED(screen_nbr);
+	UNUSED(number_of_desktops);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_ewmh_set_workarea(xcb_ewmh_connection_t *ewmh, int screen_nbr,
+		uint32_t list_len, xcb_ewmh_geometry_t *list)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_CHANGE_PROPERTY, XSHIM_ROOT, 0) };
+
+	UNUSED(ewmh);
+	UNUSED(screen_nbr);
+	UNUSED(list_len);
+	UNUSED(list);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_ewmh_set_active_window(xcb_ewmh_connection_t *ewmh,
+		int screen_nbr, xcb_window_t new_active_window)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_CHANGE_PROPERTY, XSHIM_ROOT, 0) };
+
+	UNUSED(ewmh);
+	UNUSED(screen_nbr);
+	UNUSED(new_active_window);
+	return ck;
+}
+
+xcb_void_cookie_t xcb_ewmh_set_frame_extents(xcb_ewmh_connection_t *ewmh,
+		xcb_window_t window, uint32_t left, uint32_t right, uint32_t top,
+		uint32_t bottom)
+{
+	xcb_void_cookie_t ck = { xshim_record(XCB_CHANGE_PROPERTY, window, 0) };
+
+	UNUSED(ewmh);
+	UNUSED(left);
+	UNUSED(right);
+	UNUSED(top);
+	UNUSED(bottom);
+	return ck;
+}
+
+/* RandR, which the shim reports as missing. */
+
+xcb_randr_get_screen_resources_cookie_t xcb_randr_get_screen_resources(
+		xcb_connection_t *c, xcb_window_t window)
+{
+	xcb_randr_get_screen_resources_cookie_t ck = {
+		xshim_record(XSHIM_RANDR, window, 0) };
+
+	UNUSED(c);
+	return ck;
+}
+
+xcb_randr_get_screen_resources_reply_t *xcb_randr_get_screen_resources_reply(
+		xcb_connection_t *c, xcb_randr_get_screen_resources_cookie_t cookie,
+		xcb_generic_error_t **e)
+{
+	UNUSED(c);
+	UNUSED(cookie);
+	if (e)
+		*e = NULL;
+	xshim_replies++;
+	return NULL;
+}
+
+int xcb_randr_get_screen_resources_outputs_length(
+		const xcb_randr_get_screen_resources_reply_t *R)
+{
+	(void)R;
+	return 0;
+}
+
+xcb_randr_output_t *xcb_randr_get_screen_resources_outputs(
+		const xcb_randr_get_screen_resources_reply_t *R)
+{
+	(void)R;
+	return NULL;
+}
+
+xcb_randr_get_output_info_cookie_t xcb_randr_get_output_info(xcb_connection_t *c,
+		xcb_randr_output_t output, xcb_timestamp_t config_timestamp)
+{
+	xcb_randr_get_output_info_cookie_t ck = {
+		xshim_record(XSHIM_RANDR, XCB_NONE, 0) };
+
+	UNUSED(c);
+	UNUSED(output);
+	UNUSED(config_timestamp);
+	return ck;
+}
+
+xcb_randr_get_output_info_reply_t *xcb_randr_get_output_info_reply(
+		xcb_connection_t *c, xcb_randr_get_output_info_cookie_t cookie,
+		xcb_generic_error_t **e)
+{
+	UNUSED(c);
+	UNUSED(cookie);
+	if (e)
+		*e = NULL;
+	xshim_replies++;
+	return NULL;
+}
+
+xcb_randr_get_crtc_info_cookie_t xcb_randr_get_crtc_info(xcb_connection_t *c,
+		xcb_randr_crtc_t crtc, xcb_timestamp_t config_timestamp)
+{
+	xcb_randr_get_crtc_info_cookie_t ck = { xshim_record(XSHIM_RANDR, XCB_NONE, 0) };
+
+	UNUSED(c);
+	UNUSED(crtc);
+	UNUSED(config_timestamp);
+	return ck;
+}
+
+xcb_randr_get_crtc_info_reply_t *xcb_randr_get_crtc_info_reply(xcb_connection_t *c,
+		xcb_randr_get_crtc_info_cookie_t cookie, xcb_generic_error_t **e)
+{
+	UNUSED(c);
+	UNUSED(cookie);
+	if (e)
+		*e = NULL;
+	xshim_replies++;
+	return NULL;
+}
+
+xcb_randr_get_output_primary_cookie_t xcb_randr_get_output_primary(
+		xcb_connection_t *c, xcb_window_t window)
+{
+	xcb_randr_get_output_primary_cookie_t ck = {
+		xshim_record(XSHIM_RANDR, window, 0) };
+
+	UNUSED(c);
+	return ck;
+}
+
+xcb_randr_get_output_primary_reply_t *xcb_randr_get_output_primary_reply(
+		xcb_connection_t *c, xcb_randr_get_output_primary_cookie_t cookie,
+		xcb_generic_error_t **e)
+{
+	UNUSED(c);
+	UNUSED(cookie);
+	if (e)
+		*e = NULL;
+	xshim_replies++;
+	return NULL;
+}
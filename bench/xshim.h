@@ -0,0 +1,43 @@
+#ifndef XSHIM_H
+#define XSHIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+/**
+ * @file xshim.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** How many requests the log holds. Must be a power of two. */
+#define XSHIM_LOG_SIZE 65536
+/** RandR's requests don't have a fixed major opcode, so they are all logged
+ * with this one. */
+#define XSHIM_RANDR 140
+/** The first of the windows that the root window has before howm starts. */
+#define XSHIM_FIRST_CHILD 0x100000
+
+/**
+ * @brief A request that howm would have sent to the X server.
+ */
+struct xshim_req {
+	uint8_t opcode; /**< The major opcode, such as XCB_CONFIGURE_WINDOW. */
+	uint16_t mask; /**< The value mask of the request, if it has one. */
+	xcb_window_t win; /**< The window that the request is for, if any. */
+};
+
+extern struct xshim_req xshim_log[XSHIM_LOG_SIZE];
+extern uint64_t xshim_seq;
+extern uint64_t xshim_counts[256];
+extern uint64_t xshim_replies;
+extern unsigned int xshim_tree_len;
+
+void xshim_reset(void);
+
+#endif
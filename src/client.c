@@ -9,7 +9,9 @@
 #include "helper.h"
 #include "howm.h"
 #include "layout.h"
+#include "location.h"
 #include "scratchpad.h"
+#include "trace.h"
 #include "workspace.h"
 #include "xcb_help.h"
 
@@ -26,6 +28,10 @@
 
 static void move_down(client_t *c);
 
+/** The amount of ConfigureWindow requests that weren't sent as they wouldn't
+ * have changed anything. */
+unsigned long configures_skipped;
+
 /**
  * @brief Find the client before the given client.
  *
@@ -38,13 +44,58 @@ static void move_down(client_t *c);
  */
 client_t *prev_client(client_t *c, workspace_t *w)
 {
-	client_t *p = NULL;
-
 	if (!c || !w->head || !w->head->next)
 		return NULL;
-	for (p = w->head; p->next && p->next != c; p = p->next)
-		;
-	return p;
+	return c->prev ? c->prev : w->tail;
+}
+
+/**
+ * @brief Insert a client into a workspace's client list.
+ *
+ * @param w The workspace that the client should be inserted into.
+ * @param after The client that c should be placed after. If NULL, c becomes
+ * the head of the list.
+ * @param c The client to be inserted.
+ */
+void attach_client(workspace_t *w, client_t *after, client_t *c)
+{
+	c->prev = after;
+	c->next = after ? after->next : w->head;
+	if (c->next)
+		c->next->prev = c;
+	else
+		w->tail = c;
+	if (after)
+		after->next = c;
+	else
+		w->head = c;
+	w->client_cnt++;
+	if (c->is_urgent)
+		w->urgent_cnt++;
+}
+
+/**
+ * @brief Unlink a client from a workspace's client list.
+ *
+ * The client isn't freed and the workspace's focus isn't changed.
+ *
+ * @param w The workspace that the client is on.
+ * @param c The client to be unlinked.
+ */
+void detach_client(workspace_t *w, client_t *c)
+{
+	if (c->prev)
+		c->prev->next = c->next;
+	else
+		w->head = c->next;
+	if (c->next)
+		c->next->prev = c->prev;
+	else
+		w->tail = c->prev;
+	c->next = c->prev = NULL;
+	w->client_cnt--;
+	if (c->is_urgent)
+		w->urgent_cnt--;
 }
 
 /**
@@ -69,8 +120,8 @@ client_t *next_client(client_t *c)
 }
 
 /**
- * @brief Sets c to the active window and gives it input focus. Sorts out
- * border colours as well.
+ * @brief Sets c to the active window. Giving it input focus, restacking and
+ * sorting out border colours are deferred until the monitor is restacked.
  *
  * WARNING: Do NOT use this to focus a client on another workspace. Instead,
  * set ws->c to the client that you want focused.
@@ -79,14 +130,12 @@ client_t *next_client(client_t *c)
  */
 void update_focused_client(client_t *c)
 {
-	unsigned int all = 0, fullscreen = 0, float_trans = 0;
-
 	if (!c)
 		return;
 
 	if (!mon->ws->head) {
 		mon->ws->prev_foc = mon->ws->c = NULL;
-		xcb_ewmh_set_active_window(ewmh, 0, XCB_NONE);
+		ewmh_set_active_window(XCB_NONE);
 		return;
 	} else if (c == mon->ws->prev_foc) {
 		mon->ws->prev_foc = prev_client(mon->ws->c = mon->ws->prev_foc, mon->ws);
@@ -96,37 +145,137 @@ void update_focused_client(client_t *c)
 	}
 
 	log_info("Focusing client <%p>", c);
-	for (c = mon->ws->head; c; c = c->next, ++all) {
-		if (FFT(c)) {
-			fullscreen++;
-			if (!c->is_fullscreen)
-				float_trans++;
+	mon->dirty |= DIRTY_STACK;
+	arrange_windows(mon);
+}
+
+/**
+ * @brief Set the border colour of a client's window, unless it already has
+ * that colour.
+ *
+ * @param c The client whose border colour should be changed.
+ * @param colour The new border colour.
+ */
+static void set_border_colour(client_t *c, uint32_t colour)
+{
+	if (c->is_coloured && c->border_colour == colour)
+		return;
+	change_window_attributes(c->win, XCB_CW_BORDER_PIXEL, &colour);
+	c->border_colour = colour;
+	c->is_coloured = true;
+}
+
+/**
+ * @brief Find which elements of a sequence form its longest strictly
+ * increasing subsequence. Zeroes are never part of the subsequence.
+ *
+ * @param seq The sequence to be searched.
+ * @param n The length of seq.
+ * @param keep Set to true for each element of seq that is part of the
+ * subsequence, false otherwise.
+ */
+static void longest_increasing(const unsigned int *seq, unsigned int n, bool *keep)
+{
+	unsigned int tails[n + 1], prev[n + 1];
+	unsigned int len = 0, lo, hi, mid, i;
+
+	for (i = 0; i < n; i++) {
+		keep[i] = false;
+		if (!seq[i])
+			continue;
+		/* Find the first subsequence whose last element isn't smaller. */
+		for (lo = 0, hi = len; lo < hi;) {
+			mid = (lo + hi) / 2;
+			if (seq[tails[mid]] < seq[i])
+				lo = mid + 1;
+			else
+				hi = mid;
 		}
-	}
-	xcb_window_t windows[all];
-	memset(windows, 0, sizeof(windows));
-
-	windows[(mon->ws->c->is_floating || mon->ws->c->is_transient) ? 0 : float_trans] = mon->ws->c->win;
-	c = mon->ws->head;
-	for (fullscreen += !FFT(mon->ws->c) ? 1 : 0; c; c = c->next) {
-		set_border_width(c->win, c->is_fullscreen ? 0 : conf.border_px);
-		xcb_change_window_attributes(dpy, c->win, XCB_CW_BORDER_PIXEL,
-					     (c == mon->ws->c ? &conf.border_focus :
-					      c == mon->ws->prev_foc ? &conf.border_prev_focus
-					      : &conf.border_unfocus));
-		if (c != mon->ws->c)
-			windows[c->is_fullscreen ? --fullscreen : FFT(c) ?
-				--float_trans : --all] = c->win;
+		prev[i] = lo ? tails[lo - 1] : n;
+		tails[lo] = i;
+		if (lo == len)
+			len++;
 	}
 
-	for (float_trans = 1; float_trans <= all; ++float_trans)
-		elevate_window(windows[all - float_trans]);
+	for (i = len ? tails[len - 1] : n; i != n; i = prev[i])
+		keep[i] = true;
+}
 
-	xcb_ewmh_set_active_window(ewmh, 0, mon->ws->c->win);
+/**
+ * @brief Restack the windows on a monitor and update their borders to show
+ * which client is in focus.
+ *
+ * From the bottom up, the stacking order is tiled clients, fullscreen
+ * clients, floating and transient clients. The focused client is placed on
+ * top of its group, or on top of the fullscreen clients if it is tiled.
+ *
+ * The new order is compared with the order that was last sent for the
+ * workspace. The longest run of windows that are already in the right
+ * order relative to each other is left alone, and every other window is
+ * moved directly below the window that should be above it.
+ *
+ * If m is the focused monitor, its focused client is given input focus.
+ *
+ * @param m The monitor whose current workspace should be restacked.
+ */
+void restack_clients(monitor_t *m)
+{
+	unsigned int i, n = 0;
+	client_t *c, *f = m->ws->c;
+	uint32_t vals[2];
 
-	xcb_set_input_focus(dpy, XCB_INPUT_FOCUS_POINTER_ROOT, mon->ws->c->win,
-			    XCB_CURRENT_TIME);
-	arrange_windows(mon);
+	if (!f)
+		return;
+
+	client_t *order[m->ws->client_cnt];
+
+	for (c = m->ws->head; c; c = c->next)
+		if (c != f && !FFT(c))
+			order[n++] = c;
+	for (c = m->ws->head; c; c = c->next)
+		if (c != f && c->is_fullscreen)
+			order[n++] = c;
+	if (!f->is_floating && !f->is_transient)
+		order[n++] = f;
+	for (c = m->ws->head; c; c = c->next)
+		if (c != f && FFT(c) && !c->is_fullscreen)
+			order[n++] = c;
+	if (f->is_floating || f->is_transient)
+		order[n++] = f;
+
+	unsigned int seq[n];
+	bool keep[n];
+
+	for (i = 0; i < n; i++)
+		seq[i] = order[i]->stack_pos;
+	longest_increasing(seq, n, keep);
+
+	for (i = n; i-- > 0;) {
+		if (!keep[i]) {
+			log_info("Restacking window <0x%x>", order[i]->win);
+			if (i == n - 1) {
+				vals[0] = XCB_STACK_MODE_ABOVE;
+				configure_window(order[i]->win,
+						XCB_CONFIG_WINDOW_STACK_MODE, vals);
+			} else {
+				vals[0] = order[i + 1]->win;
+				vals[1] = XCB_STACK_MODE_BELOW;
+				configure_window(order[i]->win,
+						XCB_CONFIG_WINDOW_SIBLING
+						| XCB_CONFIG_WINDOW_STACK_MODE, vals);
+			}
+		}
+		order[i]->stack_pos = i + 1;
+		set_border_colour(order[i], order[i] == f ? conf.border_focus
+				: order[i] == m->ws->prev_foc ? conf.border_prev_focus
+				: conf.border_unfocus);
+	}
+
+	if (m != mon)
+		return;
+
+	ewmh_set_active_window(f->win);
+	set_input_focus(f->win);
 }
 
 /**
@@ -171,15 +320,11 @@ client_t *get_first_non_tff(monitor_t *m)
  */
 void remove_client(monitor_t *m, workspace_t *w, client_t *c)
 {
-	client_t **temp = NULL;
-
-	for (temp = &w->head; *temp; temp = &(*temp)->next)
-		if (*temp == c)
-			goto found;
-	return;
+	if (!c || (!c->prev && w->head != c))
+		return;
 
-found:
-	*temp = c->next;
+	detach_client(w, c);
+	loc_index_remove(c->win);
 
 	log_info("Removing client <%p>", c);
 	if (c == w->prev_foc)
@@ -191,37 +336,53 @@ found:
 	}
 	free(c);
 	c = NULL;
-	w->client_cnt--;
 }
 
 /**
- * @brief Move a client down in its client list.
+ * @brief Move a client a number of places through its client list, wrapping
+ * around the ends.
+ *
+ * The client is unlinked and linked back in once, so this only walks as many
+ * places as it moves.
  *
  * @param c The client to be moved.
+ * @param steps How many places to move the client.
+ * @param down Whether to move the client down, towards the tail.
  */
-static void move_down(client_t *c)
+static void move_by(client_t *c, unsigned int steps, bool down)
 {
-	client_t *prev = prev_client(c, mon->ws);
-	client_t *n = (c->next) ? c->next : mon->ws->head;
+	unsigned int n = mon->ws->client_cnt;
+	client_t *after;
 
-	if (!c)
+	if (!c || n < 2)
 		return;
-	if (!prev)
-		return;
-	if (mon->ws->head == c)
-		mon->ws->head = n;
-	else
-		prev->next = c->next;
-	c->next = (c->next) ? n->next : n;
-	if (n->next == c->next)
-		n->next = c;
-	else
-		mon->ws->head = c;
-	log_info("Moved client <%p> on workspace <%d> down",
-				c, workspace_to_index(mon->ws));
+	after = c->prev;
+	detach_client(mon->ws, c);
+	/* The client can be linked in after any of the other n - 1 clients or
+	 * at the head, so moving n places leaves it where it started. Moving
+	 * past the tail wraps around to the head and vice versa. */
+	for (steps %= n; steps > 0; steps--) {
+		if (down)
+			after = after ? after->next : mon->ws->head;
+		else
+			after = after ? after->prev : mon->ws->tail;
+	}
+	attach_client(mon->ws, after, c);
+	log_info("Moved client <%p> on workspace <%d> %s",
+				c, workspace_to_index(mon->ws), down ? "down" : "up");
 	arrange_windows(mon);
 }
 
+/**
+ * @brief Move a client down in its client list.
+ *
+ * @param c The client to be moved.
+ */
+static void move_down(client_t *c)
+{
+	move_by(c, 1, true);
+}
+
 /**
  * @brief Move a client up in its client list.
  *
@@ -229,25 +390,7 @@ static void move_down(client_t *c)
  */
 void move_up(client_t *c)
 {
-	client_t *p = prev_client(c, mon->ws);
-	client_t *pp = NULL;
-
-	if (!c)
-		return;
-	if (!p)
-		return;
-	if (p->next)
-		for (pp = mon->ws->head; pp && pp->next != p; pp = pp->next)
-			;
-	if (pp)
-		pp->next = c;
-	else
-		mon->ws->head = (mon->ws->head == c) ? c->next : c;
-	p->next = (c->next == mon->ws->head) ? c : c->next;
-	c->next = (c->next == mon->ws->head) ? NULL : p;
-	log_info("Moved client <%p> on workspace <%d> down",
-				c, workspace_to_index(mon->ws));
-	arrange_windows(mon);
+	move_by(c, 1, false);
 }
 
 /**
@@ -286,31 +429,38 @@ void focus_prev_client(void)
  */
 void kill_client(monitor_t *m, workspace_t *w, client_t *c)
 {
-	xcb_icccm_get_wm_protocols_reply_t rep;
-	unsigned int i;
-	bool found = false;
-
 	if (!c)
 		return;
 
-	if (xcb_icccm_get_wm_protocols_reply(dpy,
-				xcb_icccm_get_wm_protocols(dpy,
-					c->win,
-					wm_atoms[WM_PROTOCOLS]), &rep, NULL)) {
-		for (i = 0; i < rep.atoms_len; ++i)
-			if (rep.atoms[i] == wm_atoms[WM_DELETE_WINDOW]) {
-				delete_win(c->win);
-				found = true;
-				break;
-			}
-		xcb_icccm_get_wm_protocols_reply_wipe(&rep);
-	}
-	if (!found)
+	if (c->can_delete)
+		delete_win(c->win);
+	else
 		xcb_kill_client(dpy, c->win);
 	log_info("Killing Client <%p>", c);
 	remove_client(m, w, c);
 }
 
+/**
+ * @brief Update the protocols that a client supports from the reply to a
+ * WM_PROTOCOLS request.
+ *
+ * @param c The client whose protocols should be updated.
+ * @param cookie The cookie of a WM_PROTOCOLS request for the client's window.
+ */
+void update_client_protocols(client_t *c, xcb_get_property_cookie_t cookie)
+{
+	xcb_icccm_get_wm_protocols_reply_t rep;
+	unsigned int i;
+
+	c->can_delete = false;
+	if (!xcb_icccm_get_wm_protocols_reply(dpy, cookie, &rep, NULL))
+		return;
+	for (i = 0; i < rep.atoms_len; ++i)
+		if (rep.atoms[i] == wm_atoms[WM_DELETE_WINDOW])
+			c->can_delete = true;
+	xcb_icccm_get_wm_protocols_reply_wipe(&rep);
+}
+
 /**
  * @brief Moves a client either upwards or down.
  *
@@ -325,22 +475,21 @@ void move_client(int cnt, bool up)
 	int cntcopy;
 	client_t *c;
 
+	if (cnt <= 0)
+		return;
 	if (up) {
 		if (mon->ws->c == mon->ws->head)
 			return;
-		c = prev_client(mon->ws->c, mon->ws);
-		/* TODO optimise this by inserting the client only once
-			* and in the correct location.*/
-		for (; cnt > 0; move_down(c), cnt--)
-			;
+		/* Moving the client above the group below it moves the whole
+		 * group up. */
+		move_by(prev_client(mon->ws->c, mon->ws), cnt, true);
 	} else {
-		if (mon->ws->c == prev_client(mon->ws->head, mon->ws))
+		if (mon->ws->c == mon->ws->tail)
 			return;
 		cntcopy = cnt;
 		for (c = mon->ws->c; cntcopy > 0; c = next_client(c), cntcopy--)
 			;
-		for (; cnt > 0; move_up(c), cnt--)
-			;
+		move_by(c, cnt, false);
 	}
 }
 
@@ -373,33 +522,21 @@ void move_current_up(void)
  */
 void client_to_ws(client_t *c, workspace_t *ws, bool follow)
 {
-	client_t *last;
 	client_t *prev = prev_client(c, mon->ws);
 
 	/* Performed for the current workspace. */
 	if (!c || ws == mon->ws)
 		return;
-	/* Target workspace. */
-	last = prev_client(ws->head, ws);
-	if (!ws->head)
-		ws->head = c;
-	else if (last)
-		last->next = c;
-	else
-		ws->head->next = c;
-	ws->c = c;
-	ws->client_cnt++;
 
-	/* Current workspace. */
-	if (c == mon->ws->head || !prev)
-		mon->ws->head = c->next;
-	else
-		prev->next = c->next;
+	detach_client(mon->ws, c);
 	mon->ws->c = prev;
-	mon->ws->client_cnt--;
 
-	c->next = NULL;
-	xcb_unmap_window(dpy, c->win);
+	attach_client(ws, ws->tail, c);
+	ws->c = c;
+	c->stack_pos = 0;
+	loc_index_add(mon, ws, c);
+
+	unmap_window(c->win);
 
 	log_info("Moved client <%p> from <%d> to <%d>", c,
 			workspace_to_index(mon->ws),
@@ -416,30 +553,86 @@ void client_to_ws(client_t *c, workspace_t *ws, bool follow)
  * @brief Arrange the client's windows on the screen.
  *
  * This function takes some strain off of the layout handlers by passing the
- * client's dimensions to move_resize. This splits the layout handlers into
+ * client's dimensions to configure_client. This splits the layout handlers into
  * smaller, more understandable parts.
+ *
+ * @param m The monitor whose current workspace should be drawn.
  */
-void draw_clients(void)
+void draw_clients(monitor_t *m)
 {
 	client_t *c = NULL;
+	uint64_t t = trace_begin();
 
 	log_debug("Drawing clients");
-	for (c = mon->ws->head; c; c = c->next)
-		if (mon->ws->layout == ZOOM && conf.zoom_gap && !c->is_floating) {
-			set_border_width(c->win, 0);
-			move_resize(c->win, c->rect.x + c->gap, c->rect.y + c->gap,
-					c->rect.width - (2 * c->gap), c->rect.height - (2 * c->gap));
+	for (c = m->ws->head; c; c = c->next)
+		if (m->ws->layout == ZOOM && conf.zoom_gap && !c->is_floating) {
+			configure_client(c, c->rect.x + c->gap, c->rect.y + c->gap,
+					c->rect.width - (2 * c->gap), c->rect.height - (2 * c->gap), 0);
 		} else if (c->is_floating && !c->is_fullscreen) {
-			set_border_width(c->win, conf.border_px);
-			move_resize(c->win, c->rect.x, c->rect.y, c->rect.width, c->rect.height);
-		} else if (c->is_fullscreen || mon->ws->layout == ZOOM) {
-			set_border_width(c->win, 0);
-			move_resize(c->win, c->rect.x, c->rect.y, c->rect.width, c->rect.height);
+			configure_client(c, c->rect.x, c->rect.y, c->rect.width, c->rect.height,
+					conf.border_px);
+		} else if (c->is_fullscreen || m->ws->layout == ZOOM) {
+			configure_client(c, c->rect.x, c->rect.y, c->rect.width, c->rect.height, 0);
 		} else {
-			move_resize(c->win, c->rect.x + c->gap, c->rect.y + c->gap,
+			configure_client(c, c->rect.x + c->gap, c->rect.y + c->gap,
 					c->rect.width - (2 * (c->gap + conf.border_px)),
-					c->rect.height - (2 * (c->gap + conf.border_px)));
+					c->rect.height - (2 * (c->gap + conf.border_px)),
+					conf.border_px);
 		}
+	log_debug("%lu configure requests have been skipped", configures_skipped);
+	trace_end("draw_clients", "layout", t);
+}
+
+/**
+ * @brief Send the geometry and border width of a client's window to the X
+ * server.
+ *
+ * Only the values that differ from those that were last sent are included in
+ * the request. If nothing has changed, no request is sent at all.
+ *
+ * @param c The client whose window should be configured.
+ * @param x The x coordinate of the client's window.
+ * @param y The y coordinate of the client's window.
+ * @param w The width of the client's window.
+ * @param h The height of the client's window.
+ * @param bw The width of the client's window's border.
+ */
+void configure_client(client_t *c, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t bw)
+{
+	uint32_t vals[5];
+	uint16_t mask = 0;
+	unsigned int i = 0;
+
+	if (!c->is_drawn || c->drawn_rect.x != x) {
+		mask |= XCB_CONFIG_WINDOW_X;
+		vals[i++] = x;
+	}
+	if (!c->is_drawn || c->drawn_rect.y != y) {
+		mask |= XCB_CONFIG_WINDOW_Y;
+		vals[i++] = y;
+	}
+	if (!c->is_drawn || c->drawn_rect.width != w) {
+		mask |= XCB_CONFIG_WINDOW_WIDTH;
+		vals[i++] = w;
+	}
+	if (!c->is_drawn || c->drawn_rect.height != h) {
+		mask |= XCB_CONFIG_WINDOW_HEIGHT;
+		vals[i++] = h;
+	}
+	if (!c->is_drawn || c->drawn_border != bw) {
+		mask |= XCB_CONFIG_WINDOW_BORDER_WIDTH;
+		vals[i++] = bw;
+	}
+
+	if (!mask) {
+		configures_skipped++;
+		return;
+	}
+
+	configure_window(c->win, mask, vals);
+	c->drawn_rect = (xcb_rectangle_t) { x, y, w, h };
+	c->drawn_border = bw;
+	c->is_drawn = true;
 }
 
 /**
@@ -475,12 +668,12 @@ void change_client_gaps(client_t *c, int size)
 
 	uint32_t space = c->gap + conf.border_px;
 
-	xcb_ewmh_set_frame_extents(ewmh, c->win, space, space, space, space);
-	draw_clients();
+	ewmh_set_frame_extents(c->win, space);
+	arrange_windows(mon);
 }
 
 /**
- * @brief Convert a window into a client.
+ * @brief Convert a window into a client on the focused workspace.
  *
  * @param w A valid xcb window.
  *
@@ -488,9 +681,24 @@ void change_client_gaps(client_t *c, int size)
  * clients.
  */
 client_t *create_client(xcb_window_t w)
+{
+	return create_client_on(mon, mon->ws, w);
+}
+
+/**
+ * @brief Convert a window into a client on any workspace.
+ *
+ * @param m The monitor that ws belongs to.
+ * @param ws The workspace whose list of clients the client is added to the
+ * end of.
+ * @param w A valid xcb window.
+ *
+ * @return A client that has already been inserted into the linked list of
+ * clients.
+ */
+client_t *create_client_on(monitor_t *m, workspace_t *ws, xcb_window_t w)
 {
 	client_t *c = (client_t *)calloc(1, sizeof(client_t));
-	client_t *t = prev_client(mon->ws->head, mon->ws); /* Get the last element. */
 	uint32_t vals[1] = { XCB_EVENT_MASK_PROPERTY_CHANGE
 				| XCB_EVENT_MASK_ENTER_WINDOW };
 
@@ -498,20 +706,13 @@ client_t *create_client(xcb_window_t w)
 		log_err("Can't allocate memory for client.");
 		exit(EXIT_FAILURE);
 	}
-	if (!mon->ws->head)
-		mon->ws->head = c;
-	else if (t)
-		t->next = c;
-	else
-		mon->ws->head->next = c;
+	attach_client(ws, ws->tail, c);
 	c->win = w;
-	c->gap = mon->ws->gap;
-	xcb_change_window_attributes(dpy, c->win, XCB_CW_EVENT_MASK, vals);
-	uint32_t space = c->gap + conf.border_px;
-
-	xcb_ewmh_set_frame_extents(ewmh, c->win, space, space, space, space);
+	c->gap = ws->gap;
+	change_window_attributes(c->win, XCB_CW_EVENT_MASK, vals);
+	ewmh_set_frame_extents(c->win, c->gap + conf.border_px);
 	log_info("Created client <%p>", c);
-	mon->ws->client_cnt++;
+	loc_index_add(m, ws, c);
 	return c;
 }
 
@@ -524,36 +725,30 @@ client_t *create_client(xcb_window_t w)
  */
 void set_fullscreen(client_t *c, bool fscr)
 {
-	long data[] = {fscr ? ewmh->_NET_WM_STATE_FULLSCREEN : XCB_NONE };
-
 	if (!c || fscr == c->is_fullscreen)
 		return;
 
 	c->is_fullscreen = fscr;
 	log_info("Setting client <%p>'s fullscreen state to %d", c, fscr);
-	xcb_change_property(dpy, XCB_PROP_MODE_REPLACE,
-			c->win, ewmh->_NET_WM_STATE, XCB_ATOM_ATOM, 32,
-			fscr, data);
-	if (fscr) {
-		set_border_width(c->win, 0);
+	ewmh_set_fullscreen(c->win, fscr);
+	if (fscr)
 		change_client_geom(c, 0, 0, mon->rect.width, mon->rect.height);
-		draw_clients();
-	} else {
-		set_border_width(c->win, !mon->ws->head->next ? 0 : conf.border_px);
-		arrange_windows(mon);
-		draw_clients();
-	}
+	arrange_windows(mon);
 }
 
 void set_urgent(client_t *c, bool urg)
 {
+	location_t loc;
+
 	if (!c || urg == c->is_urgent)
 		return;
 
 	c->is_urgent = urg;
-	xcb_change_window_attributes(dpy, c->win, XCB_CW_BORDER_PIXEL,
-			urg ? &conf.border_urgent : c == mon->ws->c
-			? &conf.border_focus : &conf.border_unfocus);
+	if (loc_client(&loc, c))
+		loc.ws->urgent_cnt += urg ? 1 : -1;
+	set_border_colour(c, urg ? conf.border_urgent : c == mon->ws->c
+			? conf.border_focus : conf.border_unfocus);
+	howm_info();
 }
 
 /**
@@ -605,7 +800,7 @@ void teleport_client(const int direction)
 		mon->ws->c->rect.y = (conf.bar_bottom ? mon->rect.height - bh : mon->rect.height) - h - g - (2 * conf.border_px);
 		break;
 	};
-	draw_clients();
+	arrange_windows(mon);
 }
 
 /**
@@ -655,7 +850,7 @@ void resize_float_width(const int dw)
 		return;
 	log_info("Resizing width of client <%p> from %d by %d", mon->ws->c, mon->ws->c->rect.width, dw);
 	mon->ws->c->rect.width += dw;
-	draw_clients();
+	arrange_windows(mon);
 }
 
 /**
@@ -674,7 +869,7 @@ void resize_float_height(const int dh)
 		return;
 	log_info("Resizing height of client <%p> from %d to %d", mon->ws->c, mon->ws->c->rect.height, dh);
 	mon->ws->c->rect.height += dh;
-	draw_clients();
+	arrange_windows(mon);
 }
 
 /**
@@ -693,7 +888,7 @@ void move_float_y(const int dy)
 		return;
 	log_info("Changing y of client <%p> from %d to %d", mon->ws->c, mon->ws->c->rect.y, dy);
 	mon->ws->c->rect.y += dy;
-	draw_clients();
+	arrange_windows(mon);
 }
 
 /**
@@ -712,7 +907,7 @@ void move_float_x(const int dx)
 		return;
 	log_info("Changing x of client <%p> from %d to %d", mon->ws->c, mon->ws->c->rect.x, dx);
 	mon->ws->c->rect.x += dx;
-	draw_clients();
+	arrange_windows(mon);
 }
 
 /**
@@ -727,8 +922,9 @@ void make_master(void)
 			|| !(mon->ws->layout == HSTACK
 			|| mon->ws->layout == VSTACK))
 		return;
-	while (mon->ws->c != mon->ws->head)
-		move_up(mon->ws->c);
+	detach_client(mon->ws, mon->ws->c);
+	attach_client(mon->ws, NULL, mon->ws->c);
+	arrange_windows(mon);
 	update_focused_client(mon->ws->head);
 }
 
@@ -797,46 +993,22 @@ void resize_master(const int ds)
  */
 void paste(void)
 {
-	client_t *head = stack_pop(&del_reg);
-	client_t *t, *c = head;
+	client_t *n, *c = stack_pop(&del_reg);
 
-	if (!head) {
+	if (!c) {
 		log_warn("No clients on stack.");
 		return;
 	}
 
-	if (!mon->ws->c) {
-		mon->ws->head = head;
-		mon->ws->c = head;
-		while (c) {
-			xcb_map_window(dpy, c->win);
-			mon->ws->c = c;
-			c = c->next;
-			mon->ws->client_cnt++;
-		}
-	} else if (!mon->ws->c->next) {
-		mon->ws->c->next = head;
-		while (c) {
-			xcb_map_window(dpy, c->win);
-			mon->ws->c = c;
-			c = c->next;
-			mon->ws->client_cnt++;
-		}
-	} else {
-		t = mon->ws->c->next;
-		mon->ws->c->next = head;
-		while (c) {
-			xcb_map_window(dpy, c->win);
-			mon->ws->client_cnt++;
-			if (!c->next) {
-				c->next = t;
-				mon->ws->c = c;
-				break;
-			} else {
-				mon->ws->c = c;
-				c = c->next;
-			}
-		}
+	/* Insert the clients after the focused client, leaving the last one
+	 * that was inserted in focus. */
+	for (; c; c = n) {
+		n = c->next;
+		attach_client(mon->ws, mon->ws->c, c);
+		c->stack_pos = 0;
+		map_window(c->win);
+		loc_index_add(mon, mon->ws, c);
+		mon->ws->c = c;
 	}
 	update_focused_client(mon->ws->c);
 }
@@ -857,9 +1029,7 @@ void toggle_bar(void)
 	} else {
 		return;
 	}
-	xcb_ewmh_geometry_t workarea[] = { { 0, conf.bar_bottom ? 0 : mon->ws->bar_height,
-				mon->rect.width, mon->rect.height - mon->ws->bar_height } };
-	xcb_ewmh_set_workarea(ewmh, 0, LENGTH(workarea), workarea);
+	ewmh_set_workarea();
 	arrange_windows(mon);
 }
 
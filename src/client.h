@@ -18,20 +18,28 @@
  * @brief howm
  */
 
+extern unsigned long configures_skipped;
+
 enum teleport_locations { TOP_LEFT, TOP_CENTER, TOP_RIGHT, CENTER, BOTTOM_LEFT, BOTTOM_CENTER, BOTTOM_RIGHT };
 
 int get_non_tff_count(monitor_t *m);
 client_t *get_first_non_tff(monitor_t *m);
 void change_client_gaps(client_t *c, int size);
 void kill_client(monitor_t *m, workspace_t *w, client_t *c);
+void update_client_protocols(client_t *c, xcb_get_property_cookie_t cookie);
 void move_up(client_t *c);
 client_t *next_client(client_t *c);
 void update_focused_client(client_t *c);
 client_t *prev_client(client_t *c, workspace_t *w);
+void attach_client(workspace_t *w, client_t *after, client_t *c);
+void detach_client(workspace_t *w, client_t *c);
 client_t *create_client(xcb_window_t w);
+client_t *create_client_on(monitor_t *m, workspace_t *ws, xcb_window_t w);
 void remove_client(monitor_t *m, workspace_t *w, client_t *c);
 void client_to_ws(client_t *c, workspace_t *ws, bool follow);
-void draw_clients(void);
+void draw_clients(monitor_t *m);
+void configure_client(client_t *c, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t bw);
+void restack_clients(monitor_t *m);
 void change_client_geom(client_t *c, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
 void set_fullscreen(client_t *c, bool fscr);
 void set_urgent(client_t *c, bool urg);
@@ -1,6 +1,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <xcb/xcb.h>
 #include <xcb/xcb_ewmh.h>
 #include <xcb/xcb_icccm.h>
@@ -10,9 +11,13 @@
 #include "handler.h"
 #include "helper.h"
 #include "howm.h"
+#include "journal.h"
 #include "layout.h"
 #include "location.h"
 #include "monitor.h"
+#include "scratchpad.h"
+#include "stats.h"
+#include "trace.h"
 #include "types.h"
 #include "workspace.h"
 #include "xcb_help.h"
@@ -35,6 +40,47 @@ static void configure_event(xcb_generic_event_t *ev);
 static void unmap_event(xcb_generic_event_t *ev);
 static void client_message_event(xcb_generic_event_t *ev);
 static void unhandled_event(xcb_generic_event_t *ev);
+static void property_event(xcb_generic_event_t *ev);
+static void cancel_pending_map(xcb_window_t win);
+static void manage_pending_windows(void);
+static void update_pending_protocols(void);
+
+/**
+ * @brief A window that has asked to be mapped, but whose replies haven't
+ * been collected yet.
+ */
+struct pending_map {
+	xcb_window_t win; /**< The window that wants to be mapped. */
+	bool cancelled; /**< Has the window been destroyed since asking? */
+	bool adopt; /**< Did the window exist before howm started, rather than
+		      asking to be mapped? */
+	xcb_get_window_attributes_cookie_t wa; /**< The window's attributes. */
+	xcb_get_property_cookie_t type; /**< The window's EWMH window type. */
+	xcb_get_property_cookie_t transient; /**< The window's WM_TRANSIENT_FOR. */
+	xcb_get_geometry_cookie_t geom; /**< The window's initial geometry. */
+	xcb_get_property_cookie_t protocols; /**< The window's WM_PROTOCOLS. */
+};
+
+/**
+ * @brief A client whose WM_PROTOCOLS have changed, but whose reply hasn't
+ * been collected yet.
+ */
+struct pending_protocols {
+	xcb_window_t win; /**< The window whose protocols changed. */
+	xcb_get_property_cookie_t cookie; /**< The window's WM_PROTOCOLS. */
+};
+
+static void request_window_info(struct pending_map *pm, xcb_window_t win);
+static client_t *manage_window(struct pending_map *pm);
+static unsigned int forget_missing_windows(const xcb_window_t *children, int len);
+static client_t *forget_missing_list(client_t *head, const xcb_window_t *sorted,
+		int len, unsigned int *cnt);
+static int window_cmp(const void *a, const void *b);
+
+static struct pending_map pending_maps[64];
+static unsigned int pending_map_cnt;
+static struct pending_protocols pending_protocols[64];
+static unsigned int pending_protocols_cnt;
 
 /**
  * @brief Process a button press.
@@ -59,79 +105,438 @@ static void button_press_event(xcb_generic_event_t *ev)
 /**
  * @brief Handles mapping requests.
  *
- * When an X window wishes to be displayed, it send a mapping request. This
- * function processes that mapping request and inserts the new client (created
- * from the map requesting window) into the list of clients for the current
- * workspace.
+ * When an X window wishes to be displayed, it send a mapping request. The
+ * requests for everything that howm needs to know about the window are sent
+ * straight away, but the replies aren't waited for until the event queue has
+ * been drained. This means that the round trips for a batch of windows that
+ * are mapped at once overlap, rather than happening one after another.
  *
  * @param ev A mapping request event.
  */
 static void map_event(xcb_generic_event_t *ev)
 {
-	xcb_window_t transient = 0;
-	xcb_get_geometry_reply_t *geom;
-	xcb_get_window_attributes_reply_t *wa;
 	xcb_map_request_event_t *me = (xcb_map_request_event_t *)ev;
-	xcb_ewmh_get_atoms_reply_t type;
+	struct pending_map *pm;
+	location_t loc;
+	unsigned int i;
+
+	if (loc_win(&loc, me->window))
+		return;
+	for (i = 0; i < pending_map_cnt; i++)
+		if (pending_maps[i].win == me->window && !pending_maps[i].cancelled)
+			return;
+	if (pending_map_cnt == LENGTH(pending_maps))
+		handle_pending_replies();
+
+	log_info("Mapping request for window <0x%x>", me->window);
+
+	pm = &pending_maps[pending_map_cnt++];
+	request_window_info(pm, me->window);
+}
+
+/**
+ * @brief Send the requests for everything that howm needs to know about a
+ * window before it can be managed, without waiting for the replies.
+ *
+ * @param pm Where the window and the cookies for its replies are stored.
+ * @param win The window.
+ */
+static void request_window_info(struct pending_map *pm, xcb_window_t win)
+{
+	pm->win = win;
+	pm->cancelled = false;
+	pm->adopt = false;
+	pm->wa = xcb_get_window_attributes(dpy, win);
+	pm->type = xcb_ewmh_get_wm_window_type(ewmh, win);
+	pm->transient = xcb_icccm_get_wm_transient_for_unchecked(dpy, win);
+	pm->geom = xcb_get_geometry_unchecked(dpy, win);
+	pm->protocols = xcb_icccm_get_wm_protocols_unchecked(dpy, win,
+			wm_atoms[WM_PROTOCOLS]);
+}
+
+/**
+ * @brief Forget about a window that is waiting to be managed.
+ *
+ * @param win The window that should no longer be managed.
+ */
+static void cancel_pending_map(xcb_window_t win)
+{
+	unsigned int i;
+
+	for (i = 0; i < pending_map_cnt; i++)
+		if (pending_maps[i].win == win) {
+			log_info("Cancelling mapping request for window <0x%x>", win);
+			pending_maps[i].cancelled = true;
+		}
+}
+
+/**
+ * @brief Collect the replies to the requests that were sent whilst handling
+ * events.
+ *
+ * This should be called once the event queue has been drained. Every request
+ * was sent before any reply is waited for, so only the first reply blocks
+ * and the whole batch counts as one round trip.
+ */
+void handle_pending_replies(void)
+{
+	if (pending_map_cnt || pending_protocols_cnt)
+		stats_round_trips++;
+	manage_pending_windows();
+	update_pending_protocols();
+}
+
+/**
+ * @brief Collect the replies for the windows that have asked to be mapped and
+ * insert a new client for each of them into the list of clients for the
+ * current workspace.
+ */
+static void manage_pending_windows(void)
+{
 	unsigned int i;
 	client_t *c;
+
+	for (i = 0; i < pending_map_cnt; i++) {
+		c = manage_window(&pending_maps[i]);
+		if (!c)
+			continue;
+		arrange_windows(mon);
+		map_window(c->win);
+		update_focused_client(c);
+		grab_buttons(c);
+	}
+	pending_map_cnt = 0;
+}
+
+/**
+ * @brief Manage every window that already exists, such as when howm starts
+ * or is restarted.
+ *
+ * The tree is queried once, then the requests for every child are sent
+ * before any replies are waited for. This means that adopting any number of
+ * windows takes two round trips, rather than two for each window. Windows
+ * that aren't viewable are left alone, as they will send a MapRequest if they
+ * want to be mapped.
+ *
+ * Each window is added to the focused workspace of the monitor that it is
+ * on, and the topmost one on each monitor is focused. Arranging is deferred
+ * until every window has been adopted.
+ *
+ * Clients restored from a restart whose windows aren't among the children
+ * were destroyed while no instance of howm was listening, so are removed.
+ *
+ * @return True if any window was adopted or any client was removed.
+ */
+bool adopt_windows(void)
+{
+	xcb_query_tree_reply_t *tree;
+	xcb_window_t *children;
+	struct pending_map *pms;
 	location_t loc;
+	monitor_t *m;
+	client_t *c;
+	unsigned int forgot;
+	int i, len, cnt = 0, req_cnt = 0;
+
+	tree = xcb_query_tree_reply(dpy, xcb_query_tree(dpy, screen->root), NULL);
+	stats_round_trips++;
+	if (!tree) {
+		log_err("Couldn't query the windows that already exist.");
+		return false;
+	}
+	len = xcb_query_tree_children_length(tree);
+	children = xcb_query_tree_children(tree);
+	pms = calloc(len ? len : 1, sizeof(*pms));
+	if (!pms) {
+		log_err("Can't allocate memory to adopt %d windows.", len);
+		free(tree);
+		return false;
+	}
 
-	wa = xcb_get_window_attributes_reply(dpy, xcb_get_window_attributes(dpy, me->window), NULL);
-	if (!wa || wa->override_redirect || loc_win(&loc, me->window)) {
-		free(wa);
-		return;
+	/* Windows that are already managed, such as after a restart, are
+	 * skipped. */
+	forgot = forget_missing_windows(children, len);
+	for (i = 0; i < len; i++) {
+		if (loc_win(&loc, children[i]))
+			continue;
+		request_window_info(&pms[req_cnt], children[i]);
+		pms[req_cnt++].adopt = true;
 	}
-	free(wa);
 
-	log_info("Mapping request for window <0x%x>", me->window);
+	/* Children are in stacking order, so the last window to be adopted on
+	 * a monitor is the topmost and is focused. */
+	if (req_cnt)
+		stats_round_trips++;
+	for (i = 0; i < req_cnt; i++) {
+		c = manage_window(&pms[i]);
+		if (!c || !loc_client(&loc, c))
+			continue;
+		grab_buttons(c);
+		loc.ws->c = c;
+		loc.mon->dirty |= DIRTY_STACK;
+		cnt++;
+	}
+
+	/* Each monitor that was given a window is restacked, so is arranged
+	 * once now that they have all been adopted. */
+	for (m = mon_head; m && cnt; m = m->next)
+		if (m->dirty & DIRTY_STACK)
+			arrange_windows(m);
+	if (cnt && mon->ws->c)
+		update_focused_client(mon->ws->c);
+
+	log_info("Adopted %d of %d existing windows", cnt, len);
+	free(pms);
+	free(tree);
+	return cnt || forgot;
+}
+
+/**
+ * @brief Remove every client whose window no longer exists.
+ *
+ * After a restart, a window that was destroyed before the new instance
+ * started listening for DestroyNotify would otherwise be managed forever.
+ *
+ * @param children Every window that exists, as children of the root window.
+ * @param len The length of children.
+ *
+ * @return How many clients were removed.
+ */
+static unsigned int forget_missing_windows(const xcb_window_t *children, int len)
+{
+	xcb_window_t *sorted = malloc((len ? len : 1) * sizeof(*sorted));
+	unsigned int i, j, cnt = 0;
+	monitor_t *m;
+	workspace_t *ws;
+	client_t *c, *n;
+
+	if (!sorted) {
+		log_err("Can't allocate memory to check %d windows.", len);
+		return 0;
+	}
+	memcpy(sorted, children, len * sizeof(*sorted));
+	qsort(sorted, len, sizeof(*sorted), window_cmp);
+
+	for (m = mon_head; m; m = m->next) {
+		for (ws = m->ws_head; ws; ws = ws->next) {
+			for (c = ws->head; c; c = n) {
+				n = c->next;
+				if (bsearch(&c->win, sorted, len, sizeof(*sorted), window_cmp))
+					continue;
+				log_warn("Window <0x%x> no longer exists", c->win);
+				remove_client(m, ws, c);
+				arrange_windows(m);
+				cnt++;
+			}
+		}
+	}
+
+	if (scratchpad && !bsearch(&scratchpad->win, sorted, len, sizeof(*sorted),
+				window_cmp)) {
+		free(scratchpad);
+		scratchpad = NULL;
+		cnt++;
+	}
+
+	/* Entries of the delete register that are left empty are removed. */
+	for (i = 1, j = 1; i <= del_reg.size; i++) {
+		c = forget_missing_list(del_reg.contents[i], sorted, len, &cnt);
+		if (c)
+			del_reg.contents[j++] = c;
+	}
+	del_reg.size = j - 1;
+
+	if (cnt)
+		log_info("Forgot %u clients whose windows no longer exist", cnt);
+	free(sorted);
+	return cnt;
+}
+
+/**
+ * @brief Remove the clients whose windows no longer exist from a list of
+ * clients that isn't on a workspace, such as an entry of the delete register.
+ *
+ * @param head The head of the list.
+ * @param sorted Every window that exists, sorted.
+ * @param len The length of sorted.
+ * @param cnt Incremented for each client that is removed.
+ *
+ * @return The new head of the list, or NULL if it is now empty.
+ */
+static client_t *forget_missing_list(client_t *head, const xcb_window_t *sorted,
+		int len, unsigned int *cnt)
+{
+	client_t *c, *n;
+
+	for (c = head; c; c = n) {
+		n = c->next;
+		if (bsearch(&c->win, sorted, len, sizeof(*sorted), window_cmp))
+			continue;
+		if (c->prev)
+			c->prev->next = n;
+		else
+			head = n;
+		if (n)
+			n->prev = c->prev;
+		free(c);
+		(*cnt)++;
+	}
+	return head;
+}
+
+/**
+ * @brief Compare two windows, for sorting.
+ *
+ * @param a A window.
+ * @param b Another window.
+ *
+ * @return Less than, equal to or greater than zero, as for qsort.
+ */
+static int window_cmp(const void *a, const void *b)
+{
+	xcb_window_t x = *(const xcb_window_t *)a, y = *(const xcb_window_t *)b;
 
-	c = create_client(me->window);
+	return (x > y) - (x < y);
+}
 
-	if (xcb_ewmh_get_wm_window_type_reply(ewmh,
-				xcb_ewmh_get_wm_window_type(ewmh, me->window),
-				&type, NULL) == 1) {
-		for (i = 0; i < type.atoms_len; i++) {
-			xcb_atom_t a = type.atoms[i];
+/**
+ * @brief Collect the replies for a window and, if it should be managed,
+ * create a client for it.
+ *
+ * Windows that are asking to be mapped are added to the focused workspace.
+ * Adopted windows are added to the focused workspace of the monitor that
+ * they are on. Docks are mapped, but not managed.
+ *
+ * @param pm The window and the cookies for its replies.
+ *
+ * @return The new client, which the caller must map and focus, or NULL.
+ */
+static client_t *manage_window(struct pending_map *pm)
+{
+	xcb_window_t transient;
+	xcb_get_geometry_reply_t *geom;
+	xcb_get_window_attributes_reply_t *wa;
+	xcb_ewmh_get_atoms_reply_t type;
+	unsigned int j;
+	bool is_floating, is_dock;
+	monitor_t *m = mon;
+	client_t *c;
+
+	wa = xcb_get_window_attributes_reply(dpy, pm->wa, NULL);
+	if (!wa || wa->override_redirect || pm->cancelled
+			|| (pm->adopt && wa->map_state != XCB_MAP_STATE_VIEWABLE)) {
+		free(wa);
+		xcb_discard_reply(dpy, pm->type.sequence);
+		xcb_discard_reply(dpy, pm->transient.sequence);
+		xcb_discard_reply(dpy, pm->geom.sequence);
+		xcb_discard_reply(dpy, pm->protocols.sequence);
+		return NULL;
+	}
+	free(wa);
+
+	is_floating = is_dock = false;
+	if (xcb_ewmh_get_wm_window_type_reply(ewmh, pm->type, &type, NULL) == 1) {
+		for (j = 0; j < type.atoms_len; j++) {
+			xcb_atom_t a = type.atoms[j];
 
 			if (a == ewmh->_NET_WM_WINDOW_TYPE_DOCK
 				|| a == ewmh->_NET_WM_WINDOW_TYPE_TOOLBAR) {
-				xcb_map_window(dpy, c->win);
-				remove_client(mon, mon->ws, c);
-				return;
+				is_dock = true;
 			} else if (a == ewmh->_NET_WM_WINDOW_TYPE_NOTIFICATION
 				|| a == ewmh->_NET_WM_WINDOW_TYPE_DROPDOWN_MENU
 				|| a == ewmh->_NET_WM_WINDOW_TYPE_SPLASH
 				|| a == ewmh->_NET_WM_WINDOW_TYPE_POPUP_MENU
 				|| a == ewmh->_NET_WM_WINDOW_TYPE_TOOLTIP
 				|| a == ewmh->_NET_WM_WINDOW_TYPE_DIALOG) {
-				c->is_floating = true;
+				is_floating = true;
 			}
 		}
+		xcb_ewmh_get_atoms_reply_wipe(&type);
+	}
+
+	/* Docks and toolbars are mapped, but not managed. */
+	if (is_dock) {
+		map_window(pm->win);
+		xcb_discard_reply(dpy, pm->transient.sequence);
+		xcb_discard_reply(dpy, pm->geom.sequence);
+		xcb_discard_reply(dpy, pm->protocols.sequence);
+		return NULL;
 	}
 
+	geom = xcb_get_geometry_reply(dpy, pm->geom, NULL);
+	if (geom && pm->adopt) {
+		xcb_point_t centre = { geom->x + geom->width / 2,
+			geom->y + geom->height / 2 };
+
+		m = point_to_monitor(centre);
+		if (!m)
+			m = mon;
+	}
+
+	c = create_client_on(m, m->ws, pm->win);
+	c->is_floating = is_floating;
+
 	/* Assume that transient windows MUST float. */
-	xcb_icccm_get_wm_transient_for_reply(dpy, xcb_icccm_get_wm_transient_for_unchecked(dpy, me->window), &transient, NULL);
+	transient = 0;
+	xcb_icccm_get_wm_transient_for_reply(dpy, pm->transient, &transient, NULL);
 	c->is_transient = transient ? true : false;
 	if (c->is_transient)
 		c->is_floating = true;
 
-	geom = xcb_get_geometry_reply(dpy, xcb_get_geometry_unchecked(dpy, me->window), NULL);
 	if (geom) {
 		log_info("Mapped client's initial geom is %ux%u+%d+%d", geom->width, geom->height, geom->x, geom->y);
 		if (c->is_floating) {
 			c->rect.width = geom->width > 1 ? geom->width : conf.float_spawn_width;
 			c->rect.height = geom->height > 1 ? geom->height : conf.float_spawn_height;
-			c->rect.x = conf.center_floating ? (mon->rect.width / 2) - (c->rect.width / 2) : geom->x;
-			c->rect.y = conf.center_floating ? (mon->rect.height - mon->ws->bar_height - c->rect.height) / 2 : geom->y;
+			c->rect.x = conf.center_floating ? (m->rect.width / 2) - (c->rect.width / 2) : geom->x;
+			c->rect.y = conf.center_floating ? (m->rect.height - m->ws->bar_height - c->rect.height) / 2 : geom->y;
 		}
 		free(geom);
 	}
 
-	arrange_windows(mon);
-	xcb_map_window(dpy, c->win);
-	update_focused_client(c);
-	grab_buttons(c);
+	update_client_protocols(c, pm->protocols);
+	return c;
+}
+
+/**
+ * @brief Collect the replies for the clients whose WM_PROTOCOLS have changed.
+ */
+static void update_pending_protocols(void)
+{
+	location_t loc;
+	unsigned int i;
+
+	for (i = 0; i < pending_protocols_cnt; i++) {
+		if (loc_win(&loc, pending_protocols[i].win))
+			update_client_protocols(loc.c, pending_protocols[i].cookie);
+		else
+			xcb_discard_reply(dpy, pending_protocols[i].cookie.sequence);
+	}
+	pending_protocols_cnt = 0;
+}
+
+/**
+ * @brief Handle a change to one of a window's properties.
+ *
+ * When a client changes its WM_PROTOCOLS, they are requested again so that
+ * the cached copy stays up to date.
+ *
+ * @param ev The property notify event.
+ */
+static void property_event(xcb_generic_event_t *ev)
+{
+	xcb_property_notify_event_t *pe = (xcb_property_notify_event_t *)ev;
+	location_t loc;
+
+	if (pe->atom != wm_atoms[WM_PROTOCOLS] || !loc_win(&loc, pe->window))
+		return;
+	if (pending_protocols_cnt == LENGTH(pending_protocols))
+		handle_pending_replies();
+
+	log_info("WM_PROTOCOLS changed for client <%p>", loc.c);
+	pending_protocols[pending_protocols_cnt].win = pe->window;
+	pending_protocols[pending_protocols_cnt++].cookie =
+		xcb_icccm_get_wm_protocols_unchecked(dpy, pe->window, wm_atoms[WM_PROTOCOLS]);
 }
 
 /**
@@ -148,6 +553,7 @@ static void destroy_event(xcb_generic_event_t *ev)
 	xcb_destroy_notify_event_t *de = (xcb_destroy_notify_event_t *)ev;
 	location_t loc;
 
+	cancel_pending_map(de->window);
 	if (!loc_win(&loc, de->window))
 		return;
 	log_info("Client <%p> wants to be destroyed", loc.c);
@@ -179,18 +585,30 @@ static void enter_event(xcb_generic_event_t *ev)
 /**
  * @brief Deal with a window's request to change its geometry.
  *
+ * A window that howm doesn't manage gets what it asks for. The layout decides
+ * the geometry of tiled and fullscreen clients, so their requests are refused
+ * by telling them the geometry that they already have. A floating client's
+ * new geometry is recorded and then drawn along with the rest of its monitor,
+ * so only the values that differ are sent.
+ *
  * @param ev The event sent from the window.
  */
 static void configure_event(xcb_generic_event_t *ev)
 {
 	xcb_configure_request_event_t *ce = (xcb_configure_request_event_t *)ev;
 	uint32_t vals[7] = {0}, i = 0;
+	uint16_t mask = ce->value_mask;
 	location_t loc;
 	bool found;
 
 	found = loc_win(&loc, ce->window);
 	log_info("Received configure request for window <0x%x>", ce->window);
 
+	if (found && (!loc.c->is_floating || loc.c->is_fullscreen)) {
+		send_configure_notify(loc.c);
+		return;
+	}
+
 	/* TODO: Need to test whether gaps etc need to be taken into account
 	 * here. */
 	if (XCB_CONFIG_WINDOW_X & ce->value_mask)
@@ -201,15 +619,34 @@ static void configure_event(xcb_generic_event_t *ev)
 		vals[i++] = (ce->width < mon->rect.width - conf.border_px) ? ce->width : mon->rect.width - conf.border_px;
 	if (XCB_CONFIG_WINDOW_HEIGHT & ce->value_mask)
 		vals[i++] = (ce->height < mon->rect.height - conf.border_px) ? ce->height : mon->rect.height - conf.border_px;
-	if (XCB_CONFIG_WINDOW_BORDER_WIDTH & ce->value_mask)
+	if (!found && XCB_CONFIG_WINDOW_BORDER_WIDTH & ce->value_mask)
 		vals[i++] = ce->border_width;
 	if (XCB_CONFIG_WINDOW_SIBLING & ce->value_mask)
 		vals[i++] = ce->sibling;
 	if (XCB_CONFIG_WINDOW_STACK_MODE & ce->value_mask)
 		vals[i++] = ce->stack_mode;
-	xcb_configure_window(dpy, ce->window, ce->value_mask, vals);
-	if (found)
-		arrange_windows(loc.mon);
+
+	if (!found) {
+		configure_window(ce->window, mask, vals);
+		return;
+	}
+
+	/* The geometry is left to draw_clients, and the border width to howm. */
+	i = 0;
+	if (mask & XCB_CONFIG_WINDOW_X)
+		loc.c->rect.x = vals[i++];
+	if (mask & XCB_CONFIG_WINDOW_Y)
+		loc.c->rect.y = vals[i++];
+	if (mask & XCB_CONFIG_WINDOW_WIDTH)
+		loc.c->rect.width = vals[i++];
+	if (mask & XCB_CONFIG_WINDOW_HEIGHT)
+		loc.c->rect.height = vals[i++];
+	mask &= XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE;
+	if (mask) {
+		configure_window(ce->window, mask, vals + i);
+		loc.c->stack_pos = 0;
+	}
+	arrange_windows(loc.mon);
 }
 
 /**
@@ -279,7 +716,12 @@ static void unhandled_event(xcb_generic_event_t *ev)
 
 void handle_event(xcb_generic_event_t *ev)
 {
-	switch (ev->response_type & ~0x80) {
+	uint8_t type = ev->response_type & ~0x80;
+	uint64_t start;
+
+	journal_event(ev);
+	start = stats_now();
+	switch (type) {
 	case XCB_BUTTON_PRESS:
 		button_press_event(ev);
 		break;
@@ -292,7 +734,7 @@ void handle_event(xcb_generic_event_t *ev)
 	case XCB_ENTER_NOTIFY:
 		enter_event(ev);
 		break;
-	case XCB_CONFIGURE_NOTIFY:
+	case XCB_CONFIGURE_REQUEST:
 		configure_event(ev);
 		break;
 	case XCB_UNMAP_NOTIFY:
@@ -301,8 +743,14 @@ void handle_event(xcb_generic_event_t *ev)
 	case XCB_CLIENT_MESSAGE:
 		client_message_event(ev);
 		break;
+	case XCB_PROPERTY_NOTIFY:
+		property_event(ev);
+		break;
 	default:
 		unhandled_event(ev);
 		break;
 	}
+
+	stats_event(type, start);
+	trace_end(stats_event_name(type), "event", start);
 }
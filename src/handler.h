@@ -14,5 +14,7 @@
  */
 
 void handle_event(xcb_generic_event_t *ev);
+void handle_pending_replies(void);
+bool adopt_windows(void);
 
 #endif
@@ -1,10 +1,13 @@
+#define _GNU_SOURCE
+
 #include <errno.h>
 #include <getopt.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/select.h>
-#include <sys/socket.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <xcb/xcb.h>
 #include <xcb/randr.h>
@@ -14,8 +17,17 @@
 #include "helper.h"
 #include "howm.h"
 #include "ipc.h"
+#include "journal.h"
+#include "layout.h"
+#include "location.h"
 #include "monitor.h"
+#include "reactor.h"
+#include "restart.h"
 #include "scratchpad.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "trace.h"
+#include "status.h"
 #include "xcb_help.h"
 #include "workspace.h"
 
@@ -41,6 +53,13 @@
 static void setup(void);
 static void cleanup(void);
 static void exec_config(char *conf_path);
+static void handle_x_events(int fd, uint32_t events, void *data);
+static bool handle_queued_events(void);
+static void setup_signals(void);
+static void handle_signals(int fd, uint32_t events, void *data);
+static void reset_signals(void);
+static void emit_info(void);
+static bool start_journal(bool restored, bool adopted);
 
 struct config conf = {
 	.focus_mouse = false,
@@ -61,6 +80,7 @@ struct config conf = {
 	.delete_register_size = 5,
 	.scratchpad_height = 500,
 	.scratchpad_width = 500,
+	.status_interval = 0,
 };
 
 bool running = true;
@@ -85,6 +105,11 @@ monitor_t *mon = NULL;
 monitor_t *mon_head = NULL;
 monitor_t *mon_tail = NULL;
 
+static bool info_dirty;
+static int signal_fd = -1;
+static char conf_path[128];
+static char journal_path[128];
+
 /**
  * @brief Occurs when howm first starts.
  *
@@ -125,31 +150,26 @@ static void setup(void)
  */
 int main(int argc, char *argv[])
 {
-	fd_set descs;
-	int sock_fd, dpy_fd, cmd_fd, ret;
-	ssize_t n;
-	xcb_generic_event_t *ev;
 	char ch;
-	char conf_path[128] = {0};
-	char *data = calloc(IPC_BUF_SIZE, sizeof(char));
-
-	if (!data) {
-		log_err("Can't allocate memory for socket buffer.");
-		exit(EXIT_FAILURE);
-	}
+	uint64_t t;
+	bool restored, adopted;
 
-	conf_path[0] = '\0';
+	log_init();
+	stats_init();
 
-	while ((ch = getopt(argc, argv, "vhc:")) != -1) {
+	while ((ch = getopt(argc, argv, "vhc:j:")) != -1) {
 		switch (ch) {
 		case 'c':
 			snprintf(conf_path, sizeof(conf_path), "%s", optarg);
 			break;
+		case 'j':
+			snprintf(journal_path, sizeof(journal_path), "%s", optarg);
+			break;
 		case 'v':
 			printf("%s\n", VERSION);
 			exit(EXIT_SUCCESS);
 		case 'h':
-			printf("%s: %s", WM_NAME, "[-v|-h|-c CONFIG_PATH]\n");
+			printf("%s: %s", WM_NAME, "[-v|-h|-c CONFIG_PATH|-j JOURNAL_PATH]\n");
 			exit(EXIT_SUCCESS);
 		}
 	}
@@ -167,81 +187,220 @@ int main(int argc, char *argv[])
 	}
 
 	setup();
-	sock_fd = ipc_init();
+	reactor_init();
+	ipc_init();
+	status_init();
 	check_other_wm();
-	dpy_fd = xcb_get_file_descriptor(dpy);
+	restored = restart_restore();
+	adopted = adopt_windows();
+	if (journal_path[0] != '\0' && !start_journal(restored, adopted))
+		exit(EXIT_FAILURE);
+	setup_signals();
+	reactor_add(xcb_get_file_descriptor(dpy), EPOLLIN, handle_x_events, NULL);
 	exec_config(conf_path);
 
 	while (running) {
+		journal_loop();
+		t = trace_begin();
+		handle_pending_replies();
+		t = trace_end("pending_replies", "loop", t);
+#ifndef NDEBUG
+		loc_index_check();
+#endif
+		arrange_dirty();
+		t = trace_end("arrange", "loop", t);
+		ipc_send_events();
+		emit_info();
+		t = trace_end("publish", "loop", t);
 		if (!xcb_flush(dpy))
 			log_err("Failed to flush X connection");
+		trace_end("xcb_flush", "loop", t);
+		restart_handoff(argv);
+
+		/* Waiting for replies or flushing can read events into XCB's
+		 * queue without the X connection becoming readable again, so
+		 * they must be handled before going to sleep. */
+		if (handle_queued_events())
+			continue;
+		reactor_poll(-1);
+	}
+
+	cleanup();
+
+	return retval;
+}
+
+/**
+ * @brief Handle every event that is waiting on the X connection.
+ *
+ * @param fd The X connection's file descriptor.
+ * @param events The epoll events that occurred.
+ * @param data Unused.
+ */
+static void handle_x_events(int fd, uint32_t events, void *data)
+{
+	xcb_generic_event_t *ev;
+	uint64_t t = trace_begin();
 
-		FD_ZERO(&descs);
-		FD_SET(dpy_fd, &descs);
-		FD_SET(sock_fd, &descs);
-
-		if (select(MAX_FD(dpy_fd, sock_fd), &descs, NULL, NULL, NULL) > 0) {
-			if (FD_ISSET(sock_fd, &descs)) {
-				cmd_fd = accept(sock_fd, NULL, 0);
-				if (cmd_fd == -1) {
-					log_err("Failed to accept connection");
-					continue;
-				}
-				n = read(cmd_fd, data, IPC_BUF_SIZE - 1);
-				if (n > 0) {
-					data[n] = '\0';
-					ret = ipc_process(data, n);
-					if (write(cmd_fd, &ret, sizeof(int)) == -1)
-						log_err("Unable to send response. errno: %d", errno);
-				}
-			}
-			if (FD_ISSET(dpy_fd, &descs)) {
-				while ((ev = xcb_poll_for_event(dpy)) != NULL) {
-					if (ev)
-						handle_event(ev);
-					else
-						log_debug("Unimplemented event: %d", ev->response_type & ~0x80);
-					free(ev);
-				}
-			}
-			if (xcb_connection_has_error(dpy)) {
-				log_err("XCB connection encountered an error.");
-				running = false;
-			}
+	UNUSED(fd);
+	UNUSED(events);
+	UNUSED(data);
+
+	while ((ev = xcb_poll_for_event(dpy)) != NULL) {
+		handle_event(ev);
+		free(ev);
+	}
+	trace_end("x_events", "loop", t);
+	if (xcb_connection_has_error(dpy)) {
+		log_err("XCB connection encountered an error.");
+		running = false;
+	}
+}
+
+/**
+ * @brief Handle the events that XCB has already read from the X connection.
+ *
+ * @return True if any events were handled.
+ */
+static bool handle_queued_events(void)
+{
+	xcb_generic_event_t *ev;
+	bool handled = false;
+
+	while ((ev = xcb_poll_for_queued_event(dpy)) != NULL) {
+		handle_event(ev);
+		free(ev);
+		handled = true;
+	}
+	return handled;
+}
+
+/**
+ * @brief Block the signals that howm handles and watch for them through a
+ * signalfd instead, so that they are handled by the main loop.
+ */
+static void setup_signals(void)
+{
+	sigset_t mask;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	sigaddset(&mask, SIGTERM);
+	sigaddset(&mask, SIGHUP);
+	if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1) {
+		log_err("Couldn't block signals. errno: %d", errno);
+		return;
+	}
+	signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (signal_fd == -1) {
+		log_err("Couldn't create signalfd. errno: %d", errno);
+		return;
+	}
+	reactor_add(signal_fd, EPOLLIN, handle_signals, NULL);
+}
+
+/**
+ * @brief Handle the signals that have been received.
+ *
+ * SIGCHLD reaps any children that have exited, SIGTERM quits and SIGHUP
+ * executes the config file again.
+ *
+ * @param fd The signalfd.
+ * @param events The epoll events that occurred.
+ * @param data Unused.
+ */
+static void handle_signals(int fd, uint32_t events, void *data)
+{
+	struct signalfd_siginfo si;
+
+	UNUSED(events);
+	UNUSED(data);
+
+	while (read(fd, &si, sizeof(si)) == sizeof(si)) {
+		switch (si.ssi_signo) {
+		case SIGCHLD:
+			while (waitpid(-1, NULL, WNOHANG) > 0)
+				;
+			break;
+		case SIGTERM:
+			quit(EXIT_SUCCESS);
+			break;
+		case SIGHUP:
+			log_info("Reloading config");
+			exec_config(conf_path);
+			break;
 		}
 	}
+}
 
-	cleanup();
-	close(sock_fd);
-	free(data);
+/**
+ * @brief Unblock the signals that howm handles through its signalfd.
+ *
+ * This should be called by children before they exec, as the signal mask is
+ * inherited.
+ */
+static void reset_signals(void)
+{
+	sigset_t mask;
 
-	if (!running)
-		return retval;
+	sigemptyset(&mask);
+	sigprocmask(SIG_SETMASK, &mask, NULL);
 }
 
 /**
- * @brief Print debug information about the current state of howm.
+ * @brief Request that information about the current state of howm is
+ * printed and published in the snapshot.
+ *
+ * This should be called whenever that state changes. The information is
+ * printed once the event queue has been drained, so many requests whilst
+ * handling a batch of events will only print a single line.
+ */
+void howm_info(void)
+{
+	info_dirty = true;
+}
+
+/**
+ * @brief Output information about the current state of howm and update the
+ * snapshot, if it has been requested.
  *
  * This can be parsed by programs such as scripts that will pipe their input
  * into a status bar.
  */
-void howm_info(void)
+static void emit_info(void)
 {
-#if DEBUG_ENABLE
-	const workspace_t *ws;
+	if (!info_dirty)
+		return;
+	info_dirty = false;
+	snapshot_update();
+	status_update();
+}
 
-	for (ws = mon->ws_head; ws != NULL; ws = ws->next) {
-		fprintf(stdout, "%d:%u:%d:%u:%u\n",  ws->layout,
-			workspace_to_index(ws), cur_state,
-			ws->client_cnt, monitor_to_index(mon));
+/**
+ * @brief Start recording the journal that was asked for with -j.
+ *
+ * A journal can only be replayed from the state that howm was in when it was
+ * started, which is an empty screen. If howm started with windows to adopt,
+ * or restored the state of an instance that wasn't recording, no journal is
+ * recorded. After restarting from an instance that was recording, the journal
+ * is appended to, but only if nothing else changed while howm restarted.
+ *
+ * @param restored Whether state was restored from a restart.
+ * @param adopted Whether adopting windows changed howm's state.
+ *
+ * @return False if the journal couldn't be created.
+ */
+static bool start_journal(bool restored, bool adopted)
+{
+	bool append = getenv(ENV_JOURNAL_VAR) != NULL;
+
+	unsetenv(ENV_JOURNAL_VAR);
+	if (adopted || restored != append) {
+		log_warn("Not recording a journal to %s, as howm didn't start "
+				"from a state that it can be replayed from", journal_path);
+		return true;
 	}
-	fflush(stdout);
-#else
-	fprintf(stdout, "%d:%d:%d:%u:%u\n",  mon->ws->layout,
-		workspace_to_index(mon->ws), cur_state,
-		mon->ws->client_cnt, monitor_to_index(mon));
-	fflush(stdout);
-#endif
+	return journal_open(journal_path, screen, append);
 }
 
 /**
@@ -257,13 +416,20 @@ static void cleanup(void)
 	while (mon)
 		remove_monitor(mon);
 
-	xcb_set_input_focus(dpy, XCB_INPUT_FOCUS_POINTER_ROOT, screen->root,
-			XCB_CURRENT_TIME);
+	set_input_focus(screen->root);
 	xcb_ewmh_connection_wipe(ewmh);
 	if (ewmh)
 		free(ewmh);
 	stack_free(&del_reg);
+	loc_index_free();
 	ipc_cleanup();
+	status_cleanup();
+	snapshot_cleanup();
+	stats_cleanup();
+	journal_close();
+	reactor_cleanup();
+	if (signal_fd != -1)
+		close(signal_fd);
 	xcb_disconnect(dpy);
 }
 
@@ -289,6 +455,7 @@ uint32_t get_colour(char *colour)
 	b = (rgb & 0xFF) * 257;
 	rep = xcb_alloc_color_reply(dpy, xcb_alloc_color(dpy, map,
 				    r, g, b), NULL);
+	stats_round_trips++;
 	if (!rep) {
 		log_err("ERROR: Can't allocate the colour %s", colour);
 		return 0;
@@ -307,9 +474,11 @@ static void exec_config(char *conf_path)
 {
 	if (fork())
 		return;
+	reset_signals();
 	setsid();
 	execl(conf_path, conf_path, NULL);
 	log_err("Couldn't execute the configuration file %s", conf_path);
+	exit(EXIT_FAILURE);
 }
 
 /**
@@ -337,6 +506,7 @@ void spawn(char *cmd[])
 		return;
 	if (dpy)
 		close(screen->root);
+	reset_signals();
 	setsid();
 	log_info("Spawning command: %s", (char *)cmd[0]);
 	execvp((char *)cmd[0], (char **)cmd);
@@ -15,6 +15,8 @@
 #define CONF_NAME "howmrc"
 #define HOWM_PATH "/usr/bin/howm"
 #define ENV_SOCK_VAR "HOWM_SOCK"
+#define ENV_RESTART_VAR "HOWM_RESTART_FD"
+#define ENV_JOURNAL_VAR "HOWM_JOURNAL"
 #define DEF_SOCK_PATH "/tmp/howm"
 #define IPC_BUF_SIZE 1024
 
@@ -55,6 +57,7 @@ struct config {
 	unsigned int delete_register_size;
 	uint16_t scratchpad_height;
 	uint16_t scratchpad_width;
+	uint16_t status_interval;
 };
 
 enum states { OPERATOR_STATE, COUNT_STATE, MOTION_STATE, END_STATE };
@@ -1,6 +1,12 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <limits.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -10,14 +16,91 @@
 #include "helper.h"
 #include "howm.h"
 #include "ipc.h"
+#include "journal.h"
 #include "layout.h"
 #include "monitor.h"
 #include "op.h"
+#include "query.h"
+#include "reactor.h"
+#include "restart.h"
 #include "scratchpad.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "trace.h"
 #include "types.h"
 #include "workspace.h"
 
-enum msg_type { MSG_FUNCTION = 1, MSG_CONFIG };
+enum msg_type { MSG_FUNCTION = 1, MSG_CONFIG, MSG_TRANSACTION, MSG_SUBSCRIBE,
+	MSG_SNAPSHOT, MSG_QUERY };
+enum conn_mode { CONN_NEW, CONN_LEGACY, CONN_FRAMED };
+
+/** The largest framed message that will be accepted. */
+#define IPC_MAX_FRAME (64 * 1024)
+/** The most args, including the message type and command, in a text message. */
+#define IPC_MAX_ARGS 64
+/** The most messages that can be sent in a single batch. */
+#define IPC_MAX_BATCH 64
+/** The largest event that can be sent. */
+#define IPC_EVENT_SIZE 128
+/** The most reply data that can be queued for a client that isn't reading. */
+#define IPC_MAX_QUEUED (256 * 1024)
+/** The most chunks of a query's document that are written each time that its
+ * connection becomes writable, so that a fast reader can't starve the others. */
+#define IPC_QUERY_CHUNKS 16
+
+/**
+ * @brief A client that is connected to the IPC socket.
+ */
+struct ipc_conn {
+	int fd; /**< The connection's socket. */
+	enum conn_mode mode; /**< Whether the client has sent a handshake. */
+	bool binary; /**< Whether framed messages use the binary format. */
+	char *in; /**< Data that has been read but not yet processed. */
+	size_t in_len; /**< How many bytes of in are used. */
+	size_t in_size; /**< The size of in. */
+	char *out; /**< Replies that are waiting to be sent. */
+	size_t out_len; /**< How many bytes of out are used. */
+	size_t out_size; /**< The size of out. */
+	bool closing; /**< Close once every reply has been sent. */
+	bool broken; /**< Close as soon as possible. */
+	unsigned int events; /**< The events that the client is subscribed to. */
+	bool events_sent; /**< Has the client been sent the state of every event
+			    it is subscribed to? */
+	int pass_fd; /**< A file descriptor waiting to be sent, or -1. */
+	size_t pass_off; /**< The offset in out of the reply that pass_fd must
+			  be sent with. */
+	bool querying; /**< Is a query's document still being written? */
+	struct query_cursor query; /**< Where the document continues from. */
+	struct ipc_conn *next; /**< Connections are stored in a linked list. */
+};
+
+/**
+ * @brief The parts of a workspace's state that are described by events.
+ */
+struct ipc_ws_state {
+	uint32_t mon; /**< The index of the workspace's monitor. */
+	uint32_t client_cnt; /**< The amount of clients on the workspace. */
+	uint32_t urgent_cnt; /**< How many of those clients are urgent. */
+	unsigned int changed; /**< The events whose values have changed. */
+};
+
+/**
+ * @brief The parts of howm's state that are described by events.
+ */
+struct ipc_state {
+	uint32_t mon; /**< The index of the focused monitor. */
+	uint32_t ws; /**< The index of the focused workspace. */
+	uint32_t layout; /**< The layout of the focused workspace. */
+	uint32_t focus; /**< The focused window, or XCB_WINDOW_NONE. */
+	uint32_t mon_cnt; /**< The amount of monitors. */
+	uint32_t ws_cnt; /**< The amount of workspaces, on every monitor. */
+	struct ipc_ws_state *wss; /**< Every workspace, by its index. */
+	uint32_t ws_size; /**< How many workspaces wss has room for. */
+};
+
+/** The names of events, in the order of enum ipc_event. */
+static const char *event_names[] = { "workspace", "layout", "focus", "client",
+	"urgent", "monitor" };
 
 /**
  * @file ipc.c
@@ -30,26 +113,225 @@ enum msg_type { MSG_FUNCTION = 1, MSG_CONFIG };
  * are sent over IPC.
  */
 
-static char **ipc_process_args(char *msg, int len, int *err);
+/** How many slots the command hash table has. Must be a power of two. */
+#define IPC_HASH_SIZE 1024
+/** The most seeds that are tried when building the command hash table. */
+#define IPC_MAX_SEED 100000
+
+/** Bounds that depend on howm's current state, which are resolved when a
+ * command's args are decoded. */
+enum ipc_bound { BOUND_LAST_WS = INT_MAX - 3, BOUND_LAST_MON, BOUND_MON_WIDTH,
+	BOUND_MON_HEIGHT };
+
+/** The arg that a command takes. */
+enum ipc_arg_type { ARG_NONE, ARG_INT, ARG_BOOL, ARG_COLOUR, ARG_WS, ARG_MON,
+	ARG_STR, ARG_ARGV };
+
+/**
+ * @brief A command that can be sent over IPC, either a function or a config
+ * option.
+ *
+ * Exactly one of the call, op or opt members is set, depending on what sort of
+ * command it is.
+ */
+struct ipc_cmd {
+	const char *name; /**< The name that is sent over IPC. */
+	enum msg_type type; /**< MSG_FUNCTION or MSG_CONFIG. */
+	enum ipc_arg_type arg; /**< The arg that the command takes. */
+	int lower; /**< The inclusive lower bound of an integer arg. */
+	int upper; /**< The inclusive upper bound of an integer arg. */
+	void (*call)(void);
+	void (*call_int)(const int);
+	void (*call_mon)(monitor_t *);
+	void (*call_mon_int)(monitor_t *, const int);
+	void (*call_ws)(workspace_t *);
+	void (*call_mon_ws)(monitor_t *, workspace_t *);
+	void (*call_str)(char *);
+	void (*call_argv)(char **);
+	void (*op)(const unsigned int, unsigned int); /**< An operator. */
+	uint16_t *opt_u16; /**< A config option. */
+	bool *opt_bool; /**< A config option. */
+	uint32_t *opt_colour; /**< A config option. */
+};
+
+/**
+ * @brief The decoded arg of a command.
+ */
+struct ipc_val {
+	int i; /**< Also used for workspace and monitor indexes. */
+	bool b;
+	char colour[8]; /**< In the form #RRGGBB. */
+	char *str;
+	char **argv;
+};
+
+static void ipc_count(const int cnt);
+static void ipc_change_ws(workspace_t *ws);
+
+#define FUNC(n, ...) { .name = #n, .type = MSG_FUNCTION, __VA_ARGS__ }
+#define OPERATOR(n) FUNC(n, .op = n)
+#define CONFIG(n, ...) { .name = #n, .type = MSG_CONFIG, __VA_ARGS__ }
+
+/* The index of each command is its id in the binary protocol, so new commands
+ * must only be added to the end. */
+static const struct ipc_cmd ipc_cmds[] = {
+	FUNC(teleport_client, .arg = ARG_INT, .lower = TOP_LEFT, .upper = BOTTOM_RIGHT,
+		.call_int = teleport_client),
+	FUNC(quit, .arg = ARG_INT, .lower = EXIT_SUCCESS, .upper = EXIT_FAILURE,
+		.call_int = quit),
+	FUNC(resize_float_width, .arg = ARG_INT, .lower = -100, .upper = 100,
+		.call_int = resize_float_width),
+	FUNC(resize_float_height, .arg = ARG_INT, .lower = -100, .upper = 100,
+		.call_int = resize_float_height),
+	FUNC(move_float_x, .arg = ARG_INT, .lower = -100, .upper = 100,
+		.call_int = move_float_x),
+	FUNC(move_float_y, .arg = ARG_INT, .lower = -100, .upper = 100,
+		.call_int = move_float_y),
+	FUNC(resize_master, .arg = ARG_INT, .lower = -100, .upper = 100,
+		.call_int = resize_master),
+	FUNC(count, .arg = ARG_INT, .lower = 1, .upper = 9, .call_int = ipc_count),
+	FUNC(change_ws, .arg = ARG_WS, .lower = 0, .upper = BOUND_LAST_WS,
+		.call_ws = ipc_change_ws),
+	FUNC(current_to_ws, .arg = ARG_WS, .lower = 0, .upper = BOUND_LAST_WS,
+		.call_ws = current_to_ws),
+	FUNC(add_ws, .call_mon = add_ws),
+	FUNC(remove_ws, .arg = ARG_WS, .lower = 0, .upper = BOUND_LAST_WS,
+		.call_mon_ws = remove_ws),
+	FUNC(move_current_down, .call = move_current_down),
+	FUNC(move_current_up, .call = move_current_up),
+	FUNC(focus_monitor, .arg = ARG_MON, .lower = 0, .upper = BOUND_LAST_MON,
+		.call_mon = focus_monitor),
+	FUNC(focus_next_client, .call = focus_next_client),
+	FUNC(focus_prev_client, .call = focus_prev_client),
+	FUNC(toggle_float, .call = toggle_float),
+	FUNC(toggle_fullscreen, .call = toggle_fullscreen),
+	FUNC(focus_urgent, .call = focus_urgent),
+	FUNC(send_to_scratchpad, .call = send_to_scratchpad),
+	FUNC(get_from_scratchpad, .call = get_from_scratchpad),
+	FUNC(make_master, .call = make_master),
+	FUNC(toggle_bar, .call = toggle_bar),
+	FUNC(focus_next_ws, .call = focus_next_ws),
+	FUNC(focus_prev_ws, .call = focus_prev_ws),
+	FUNC(focus_last_ws, .call = focus_last_ws),
+	FUNC(paste, .call = paste),
+	/* TODO: Allow the layout of an arbitrary monitor to be changed
+	 * without having to focus it. */
+	FUNC(change_layout, .arg = ARG_INT, .lower = ZOOM, .upper = END_LAYOUT - 1,
+		.call_mon_int = change_layout),
+	FUNC(next_layout, .call_mon = next_layout),
+	FUNC(prev_layout, .call_mon = prev_layout),
+	FUNC(last_layout, .call_mon = last_layout),
+	FUNC(spawn, .arg = ARG_ARGV, .call_argv = spawn),
+	FUNC(motion, .arg = ARG_STR, .call_str = motion),
+	OPERATOR(op_kill),
+	OPERATOR(op_move_up),
+	OPERATOR(op_move_down),
+	OPERATOR(op_focus_down),
+	OPERATOR(op_focus_up),
+	OPERATOR(op_shrink_gaps),
+	OPERATOR(op_grow_gaps),
+	OPERATOR(op_cut),
+	CONFIG(border_px, .arg = ARG_INT, .lower = 0, .upper = 32,
+		.opt_u16 = &conf.border_px),
+	CONFIG(float_spawn_height, .arg = ARG_INT, .lower = 1, .upper = BOUND_MON_HEIGHT,
+		.opt_u16 = &conf.float_spawn_height),
+	CONFIG(float_spawn_width, .arg = ARG_INT, .lower = 1, .upper = BOUND_MON_WIDTH,
+		.opt_u16 = &conf.float_spawn_width),
+	CONFIG(scratchpad_height, .arg = ARG_INT, .lower = 1, .upper = BOUND_MON_HEIGHT,
+		.opt_u16 = &conf.scratchpad_height),
+	CONFIG(scratchpad_width, .arg = ARG_INT, .lower = 1, .upper = BOUND_MON_WIDTH,
+		.opt_u16 = &conf.scratchpad_width),
+	CONFIG(op_gap_size, .arg = ARG_INT, .lower = 0, .upper = 32,
+		.opt_u16 = &conf.op_gap_size),
+	CONFIG(bar_height, .arg = ARG_INT, .lower = 0, .upper = BOUND_MON_HEIGHT,
+		.opt_u16 = &conf.bar_height),
+	CONFIG(focus_mouse, .arg = ARG_BOOL, .opt_bool = &conf.focus_mouse),
+	CONFIG(focus_mouse_click, .arg = ARG_BOOL, .opt_bool = &conf.focus_mouse_click),
+	CONFIG(follow_move, .arg = ARG_BOOL, .opt_bool = &conf.follow_move),
+	CONFIG(zoom_gap, .arg = ARG_BOOL, .opt_bool = &conf.zoom_gap),
+	CONFIG(center_floating, .arg = ARG_BOOL, .opt_bool = &conf.center_floating),
+	CONFIG(bar_bottom, .arg = ARG_BOOL, .opt_bool = &conf.bar_bottom),
+	CONFIG(border_focus, .arg = ARG_COLOUR, .opt_colour = &conf.border_focus),
+	CONFIG(border_unfocus, .arg = ARG_COLOUR, .opt_colour = &conf.border_unfocus),
+	CONFIG(border_prev_focus, .arg = ARG_COLOUR, .opt_colour = &conf.border_prev_focus),
+	CONFIG(border_urgent, .arg = ARG_COLOUR, .opt_colour = &conf.border_urgent),
+	CONFIG(status_interval, .arg = ARG_INT, .lower = 0, .upper = 10000,
+		.opt_u16 = &conf.status_interval),
+	CONFIG(log_level, .arg = ARG_INT, .lower = LOG_DEBUG, .upper = LOG_NONE,
+		.opt_u16 = &log_level),
+	CONFIG(log_ring_level, .arg = ARG_INT, .lower = LOG_DEBUG, .upper = LOG_NONE,
+		.opt_u16 = &log_ring_level),
+	FUNC(reset_stats, .call = stats_reset),
+	CONFIG(trace, .arg = ARG_BOOL, .opt_bool = &trace_enabled),
+	FUNC(restart, .call = restart),
+};
+
+#undef FUNC
+#undef OPERATOR
+#undef CONFIG
+
+/** Maps a slot of the hash table to an index of ipc_cmds, plus one. Zero means
+ * that the slot is empty. */
+static uint8_t cmd_slots[IPC_HASH_SIZE];
+static uint32_t cmd_seed;
+
+static int ipc_process_args(char *msg, int len, char **args, int cap, int *err);
 static int ipc_arg_to_int(char *arg, int *err, int lower, int upper);
-static int ipc_process_function(char **args);
-static int ipc_process_config(char **args);
+static int ipc_process_msg(char *msg, int len);
+static int ipc_process_bin(const char *msg, uint32_t len);
+static int ipc_parse_msg(char *msg, int len, char **args, int cap,
+		const struct ipc_cmd **cmd, struct ipc_val *val);
+static int ipc_parse_bin(const char *msg, uint32_t len,
+		const struct ipc_cmd **cmd, struct ipc_val *val);
+static int ipc_process_batch(char *msg, uint32_t len, bool binary, int32_t *errs,
+		int max);
+static void ipc_build_hash(void);
+static unsigned int ipc_hash(const char *name, uint32_t seed);
+static const struct ipc_cmd *ipc_lookup(const char *name);
+static int ipc_bound(int bound);
+static int ipc_decode(const struct ipc_cmd *cmd, char **args, struct ipc_val *val);
+static int ipc_decode_bin(const struct ipc_cmd *cmd, const char *args,
+		unsigned int argc, struct ipc_val *val);
+static int ipc_call(const struct ipc_cmd *cmd, const struct ipc_val *val);
 static bool ipc_arg_to_bool(char *arg, int *err);
+static void ipc_accept(int fd, uint32_t events, void *data);
+static void ipc_conn_close(struct ipc_conn *conn);
+static void ipc_close_broken(void);
+static void ipc_conn_ready(int fd, uint32_t events, void *data);
+static void ipc_conn_process(struct ipc_conn *conn);
+static int ipc_conn_dispatch(struct ipc_conn *conn, char *msg, uint32_t len,
+		int32_t *errs, int *fd, int *query);
+static int ipc_query(struct ipc_conn *conn, char *msg, uint32_t len, int *query);
+static void ipc_conn_query(struct ipc_conn *conn, enum query_type type);
+static void ipc_conn_query_next(struct ipc_conn *conn);
+static void ipc_query_sink(const char *buf, size_t len, void *data);
+static int ipc_subscribe(struct ipc_conn *conn, char *msg, uint32_t len);
+static bool ipc_get_state(struct ipc_state *state);
+static void ipc_send_event(struct ipc_conn *conn, enum ipc_event event, int n, ...);
+static void ipc_conn_send(struct ipc_conn *conn, const void *buf, size_t len);
+static void ipc_conn_flush(struct ipc_conn *conn);
+static void ipc_conn_watch(struct ipc_conn *conn);
+static void ipc_conn_send_fd(struct ipc_conn *conn, const void *buf, size_t len,
+		int fd);
+static ssize_t send_fd(int sock, const void *buf, size_t len, int fd);
+static bool buf_reserve(char **buf, size_t *size, size_t need);
+
+static int sock_fd = -1;
+static struct ipc_conn *conn_head;
+/** Is a journal being replayed? Commands that start programs are skipped. */
+static bool replaying;
 
 /**
- * @brief Open a socket and return it.
+ * @brief Open a socket and start listening for connections on it.
  *
  * If a socket path is defined in the env variable defined as ENV_SOCK_VAR then
  * use that - else use DEF_SOCK_PATH.
- *
- * @return A socket file descriptor.
  */
-int ipc_init(void)
+void ipc_init(void)
 {
 	struct sockaddr_un addr;
 	char *sp = NULL;
 	char sock_path[256];
-	int sock_fd;
 
 	sp = getenv(ENV_SOCK_VAR);
 
@@ -62,7 +344,7 @@ int ipc_init(void)
 	addr.sun_family = AF_UNIX;
 	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", sock_path);
 	unlink(sock_path);
-	sock_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	sock_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
 
 	if (sock_fd == -1) {
 		log_err("Couldn't create the socket.");
@@ -74,21 +356,852 @@ int ipc_init(void)
 		exit(EXIT_FAILURE);
 	}
 
-	if (listen(sock_fd, 1) == -1) {
+	if (listen(sock_fd, SOMAXCONN) == -1) {
 		log_err("Listening error.");
 		exit(EXIT_FAILURE);
 	}
 
-	return sock_fd;
+	ipc_build_hash();
+	reactor_add(sock_fd, EPOLLIN, ipc_accept, NULL);
+}
+
+/**
+ * @brief Accept a connection and start watching it for messages.
+ *
+ * @param fd The listening socket.
+ * @param events The epoll events that occurred.
+ * @param data Unused.
+ */
+static void ipc_accept(int fd, uint32_t events, void *data)
+{
+	struct ipc_conn *conn;
+	int cmd_fd;
+
+	UNUSED(events);
+	UNUSED(data);
+
+	cmd_fd = accept4(fd, NULL, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (cmd_fd == -1) {
+		log_err("Failed to accept connection. errno: %d", errno);
+		return;
+	}
+
+	conn = calloc(1, sizeof(struct ipc_conn));
+	if (!conn) {
+		log_err("Can't allocate memory for IPC connection.");
+		close(cmd_fd);
+		return;
+	}
+	conn->fd = cmd_fd;
+	conn->pass_fd = -1;
+	conn->next = conn_head;
+	conn_head = conn;
+	reactor_add(cmd_fd, EPOLLIN, ipc_conn_ready, conn);
+}
+
+/**
+ * @brief Stop watching a connection, close it and free its buffers.
+ *
+ * @param conn The connection to close.
+ */
+static void ipc_conn_close(struct ipc_conn *conn)
+{
+	struct ipc_conn **c;
+
+	for (c = &conn_head; *c; c = &(*c)->next) {
+		if (*c == conn) {
+			*c = conn->next;
+			break;
+		}
+	}
+	reactor_remove(conn->fd);
+	close(conn->fd);
+	if (conn->pass_fd != -1)
+		close(conn->pass_fd);
+	free(conn->in);
+	free(conn->out);
+	free(conn);
+}
+
+/**
+ * @brief Close every connection that broke while howm was sending to it
+ * outside of ipc_conn_ready, such as when it was sent an event.
+ *
+ * Otherwise, a broken connection would only be closed once epoll next
+ * reported an event for it, which might never happen.
+ */
+static void ipc_close_broken(void)
+{
+	struct ipc_conn **c = &conn_head;
+
+	while (*c) {
+		if ((*c)->broken)
+			ipc_conn_close(*c);
+		else
+			c = &(*c)->next;
+	}
+}
+
+/**
+ * @brief Handle a connection becoming readable or writable.
+ *
+ * At most one read is made per call, so that a client that is sending lots of
+ * data can't starve the X connection or other clients. The connection is
+ * closed once the client hangs up and every reply has been sent, or as soon as
+ * it misbehaves.
+ *
+ * @param fd The connection's socket.
+ * @param events The epoll events that occurred.
+ * @param data The connection.
+ */
+static void ipc_conn_ready(int fd, uint32_t events, void *data)
+{
+	struct ipc_conn *conn = data;
+	ssize_t n;
+
+	if (events & EPOLLOUT) {
+		ipc_conn_flush(conn);
+		ipc_conn_query_next(conn);
+		/* Handle the messages that were left while a query's document
+		 * was being sent. */
+		if (conn->in_len > 0 && !conn->querying)
+			ipc_conn_process(conn);
+	}
+
+	if (!conn->broken && !conn->closing && !conn->querying
+			&& (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+		if (!buf_reserve(&conn->in, &conn->in_size, conn->in_len + IPC_BUF_SIZE)) {
+			conn->broken = true;
+		} else {
+			/* Leave room for the null terminator that legacy messages
+			 * are given. */
+			n = read(fd, conn->in + conn->in_len,
+					conn->in_size - conn->in_len - 1);
+			if (n > 0) {
+				conn->in_len += n;
+				ipc_conn_process(conn);
+			} else if (n == 0) {
+				conn->closing = true;
+			} else if (errno != EAGAIN && errno != EINTR) {
+				conn->broken = true;
+			}
+		}
+	}
+
+	if (conn->broken || (conn->closing && conn->out_len == 0
+				&& !conn->querying))
+		ipc_conn_close(conn);
+}
+
+/**
+ * @brief Process every complete message that a connection has sent.
+ *
+ * The first byte that a client sends determines how the connection is
+ * treated. A message type (as sent by older versions of cottage) means that
+ * the whole of the data is a single message, after which the connection is
+ * closed. Otherwise the client must send IPC_MAGIC followed by the version
+ * of the protocol that it speaks and, from version 2, the format of its
+ * messages (enum ipc_format). howm echoes the handshake back, after which the
+ * client can send any number of framed messages. Each frame is a native endian uint32_t length followed by
+ * a message or a batch of messages and is replied to with a frame containing
+ * an error code for each message.
+ *
+ * @param conn The connection that has received data.
+ */
+static void ipc_conn_process(struct ipc_conn *conn)
+{
+	size_t off = 0;
+	uint32_t len;
+	int32_t ret, errs[IPC_MAX_BATCH];
+	int cnt, fd, query;
+	char *msg, reply[sizeof(uint32_t) + sizeof(int32_t)];
+
+	if (conn->mode == CONN_NEW
+			&& (conn->in[0] == MSG_FUNCTION || conn->in[0] == MSG_CONFIG))
+		conn->mode = CONN_LEGACY;
+
+	if (conn->mode == CONN_NEW) {
+		if (memcmp(conn->in, IPC_MAGIC,
+					conn->in_len < IPC_MAGIC_LEN ? conn->in_len : IPC_MAGIC_LEN) != 0) {
+			log_warn("Unknown IPC handshake, closing connection");
+			conn->broken = true;
+			return;
+		} else if (conn->in_len < IPC_MAGIC_LEN + 1) {
+			return;
+		} else if (conn->in[IPC_MAGIC_LEN] == 1) {
+			off = IPC_MAGIC_LEN + 1;
+		} else if (conn->in[IPC_MAGIC_LEN] != IPC_VERSION) {
+			log_warn("Unsupported IPC version %d", conn->in[IPC_MAGIC_LEN]);
+			conn->broken = true;
+			return;
+		} else if (conn->in_len < IPC_MAGIC_LEN + 2) {
+			return;
+		} else if (conn->in[IPC_MAGIC_LEN + 1] > IPC_FORMAT_BINARY) {
+			log_warn("Unknown IPC format %d", conn->in[IPC_MAGIC_LEN + 1]);
+			conn->broken = true;
+			return;
+		} else {
+			conn->binary = conn->in[IPC_MAGIC_LEN + 1] == IPC_FORMAT_BINARY;
+			off = IPC_MAGIC_LEN + 2;
+		}
+		conn->mode = CONN_FRAMED;
+		ipc_conn_send(conn, conn->in, off);
+	}
+
+	if (conn->mode == CONN_LEGACY) {
+		conn->in[conn->in_len] = '\0';
+		journal_ipc(conn->in, conn->in_len, false);
+		ret = ipc_process(conn->in, conn->in_len);
+		ipc_conn_send(conn, &ret, sizeof(ret));
+		conn->in_len = 0;
+		conn->closing = true;
+		return;
+	}
+
+	while (!conn->broken && !conn->querying
+			&& conn->in_len - off >= sizeof(len)) {
+		memcpy(&len, conn->in + off, sizeof(len));
+		if (len > IPC_MAX_FRAME) {
+			log_warn("IPC frame of %u bytes is too large", len);
+			conn->broken = true;
+			return;
+		}
+		if (conn->in_len - off - sizeof(len) < len)
+			break;
+		msg = conn->in + off + sizeof(len);
+		off += sizeof(len) + len;
+		cnt = ipc_conn_dispatch(conn, msg, len, errs, &fd, &query);
+		len = cnt * sizeof(int32_t);
+		if (fd != -1) {
+			memcpy(reply, &len, sizeof(len));
+			memcpy(reply + sizeof(len), errs, len);
+			ipc_conn_send_fd(conn, reply, sizeof(len) + len, fd);
+			continue;
+		}
+		ipc_conn_send(conn, &len, sizeof(len));
+		ipc_conn_send(conn, errs, len);
+		if (query != -1)
+			ipc_conn_query(conn, query);
+	}
+
+	conn->in_len -= off;
+	memmove(conn->in, conn->in + off, conn->in_len);
+}
+
+/**
+ * @brief Act on a framed message from a connection, depending on its type.
+ *
+ * @param conn The connection that sent the message.
+ * @param msg The message, without its length.
+ * @param len The length of the message.
+ * @param errs Where the error code of each message is stored.
+ * @param fd Where a file descriptor that should be passed along with the
+ * reply is stored, or -1.
+ * @param query Where the query whose document should follow the reply is
+ * stored, or -1.
+ *
+ * @return How many error codes were stored in errs.
+ */
+static int ipc_conn_dispatch(struct ipc_conn *conn, char *msg, uint32_t len,
+		int32_t *errs, int *fd, int *query)
+{
+	uint16_t id = 0;
+	int cnt = 1;
+
+	*fd = -1;
+	*query = -1;
+
+	if (conn->binary && len < sizeof(id)) {
+		errs[0] = IPC_ERR_SYNTAX;
+		return 1;
+	}
+	if (conn->binary)
+		memcpy(&id, msg, sizeof(id));
+
+	if ((conn->binary && id == IPC_BIN_TRANSACTION)
+			|| (!conn->binary && len > 0 && msg[0] == MSG_TRANSACTION)) {
+		journal_ipc(msg, len, conn->binary);
+		cnt = ipc_process_batch(msg, len, conn->binary, errs, IPC_MAX_BATCH);
+		if (cnt < 0) {
+			errs[0] = IPC_ERR_SYNTAX;
+			cnt = 1;
+		}
+	} else if ((conn->binary && id == IPC_BIN_SUBSCRIBE)
+			|| (!conn->binary && len > 0 && msg[0] == MSG_SUBSCRIBE)) {
+		errs[0] = ipc_subscribe(conn, msg, len);
+	} else if ((conn->binary && id == IPC_BIN_SNAPSHOT)
+			|| (!conn->binary && len > 0 && msg[0] == MSG_SNAPSHOT)) {
+		/* Only one file descriptor can wait to be sent at a time. */
+		if (conn->pass_fd == -1)
+			*fd = snapshot_get_fd();
+		errs[0] = *fd == -1 ? IPC_ERR_NO_SNAPSHOT : IPC_ERR_NONE;
+	} else if ((conn->binary && id == IPC_BIN_QUERY)
+			|| (!conn->binary && len > 0 && msg[0] == MSG_QUERY)) {
+		errs[0] = ipc_query(conn, msg, len, query);
+	} else if (conn->binary) {
+		journal_ipc(msg, len, true);
+		errs[0] = ipc_process_bin(msg, len);
+	} else {
+		journal_ipc(msg, len, false);
+		errs[0] = ipc_process(msg, len);
+	}
+	return cnt;
+}
+
+/**
+ * @brief Change the events that a connection is subscribed to.
+ *
+ * A text subscription is MSG_SUBSCRIBE followed by the null terminated names
+ * of the events. A binary subscription is a message with the command
+ * IPC_BIN_SUBSCRIBE whose only arg is a mask of enum ipc_event. Either
+ * replaces the previous subscription, so subscribing to no events
+ * unsubscribes. The current state of each subscribed event is sent straight
+ * away.
+ *
+ * @param conn The connection that is subscribing.
+ * @param msg The subscription message.
+ * @param len The length of msg.
+ *
+ * @return An error code.
+ */
+static int ipc_subscribe(struct ipc_conn *conn, char *msg, uint32_t len)
+{
+	int err = IPC_ERR_NONE;
+	int cap = len < IPC_MAX_ARGS ? len : IPC_MAX_ARGS;
+	char *args[cap + 1];
+	struct ipc_bin_msg hdr;
+	int32_t mask = 0;
+	int argc, i;
+	unsigned int e;
+
+	if (conn->binary) {
+		memcpy(&hdr, msg, sizeof(hdr) < len ? sizeof(hdr) : len);
+		if (len != sizeof(hdr) + sizeof(mask) || hdr.argc != 1)
+			return IPC_ERR_SYNTAX;
+		memcpy(&mask, msg + sizeof(hdr), sizeof(mask));
+		if (mask & ~EVENT_ALL)
+			return IPC_ERR_ARG_TOO_LARGE;
+	} else {
+		argc = ipc_process_args(msg, len, args, cap, &err);
+		if (argc == -1)
+			return err;
+		for (i = 1; i < argc; i++) {
+			for (e = 0; e < LENGTH(event_names); e++)
+				if (strcmp(args[i], event_names[e]) == 0)
+					break;
+			if (e == LENGTH(event_names))
+				return IPC_ERR_SYNTAX;
+			mask |= 1 << e;
+		}
+	}
+
+	conn->events = mask;
+	conn->events_sent = false;
+	return IPC_ERR_NONE;
+}
+
+/**
+ * @brief Parse a query for part of howm's state.
+ *
+ * A text query is MSG_QUERY followed by the null terminated name of the
+ * query. A binary query is a message with the command IPC_BIN_QUERY whose only
+ * arg is a value from enum query_type.
+ *
+ * @param conn The connection that sent the query.
+ * @param msg The query.
+ * @param len The length of msg.
+ * @param query Where the type of the query is stored, if it is valid.
+ *
+ * @return An IPC error code.
+ */
+static int ipc_query(struct ipc_conn *conn, char *msg, uint32_t len, int *query)
+{
+	int err = IPC_ERR_NONE;
+	char *args[3];
+	struct ipc_bin_msg hdr;
+	int32_t type;
+
+	if (conn->binary) {
+		memcpy(&hdr, msg, sizeof(hdr) < len ? sizeof(hdr) : len);
+		if (len != sizeof(hdr) + sizeof(type) || hdr.argc != 1)
+			return IPC_ERR_SYNTAX;
+		memcpy(&type, msg + sizeof(hdr), sizeof(type));
+		if (type < 0 || type >= END_QUERY)
+			return IPC_ERR_NO_QUERY;
+	} else {
+		if (ipc_process_args(msg, len, args, 2, &err) != 2)
+			return err != IPC_ERR_NONE ? err : IPC_ERR_TOO_FEW_ARGS;
+		type = query_from_name(args[1]);
+		if (type == -1)
+			return IPC_ERR_NO_QUERY;
+	}
+
+	*query = type;
+	return IPC_ERR_NONE;
+}
+
+/**
+ * @brief Stream a query's document to a connection, after its reply.
+ *
+ * The document is sent as a series of frames with IPC_DATA_FLAG set in their
+ * length, ending with an empty one. Until the whole document has been sent,
+ * no more of the connection's messages are read or handled.
+ *
+ * @param conn The connection to send the document to.
+ * @param type The document to send.
+ */
+static void ipc_conn_query(struct ipc_conn *conn, enum query_type type)
+{
+	if (conn->broken)
+		return;
+
+	query_start(&conn->query, type);
+	conn->querying = true;
+	ipc_conn_query_next(conn);
+	if (conn->querying)
+		ipc_conn_watch(conn);
+}
+
+/**
+ * @brief Write more of a query's document to a connection.
+ *
+ * The next chunk is only written once everything before it has been sent,
+ * so a document never takes more than a chunk of the connection's queue,
+ * however large it is. The rest is written as the connection becomes
+ * writable.
+ *
+ * @param conn The connection whose document should be continued.
+ */
+static void ipc_conn_query_next(struct ipc_conn *conn)
+{
+	uint32_t end = IPC_DATA_FLAG;
+	unsigned int i;
+
+	for (i = 0; i < IPC_QUERY_CHUNKS && conn->querying && !conn->broken
+			&& conn->out_len == 0; i++) {
+		if (!query_next(&conn->query, ipc_query_sink, conn))
+			continue;
+		ipc_conn_send(conn, &end, sizeof(end));
+		conn->querying = false;
+		ipc_conn_watch(conn);
+	}
+}
+
+/**
+ * @brief Send a chunk of a query's document as a data frame.
+ *
+ * @param buf The chunk.
+ * @param len The length of buf.
+ * @param data The connection to send the chunk to.
+ */
+static void ipc_query_sink(const char *buf, size_t len, void *data)
+{
+	struct ipc_conn *conn = data;
+	uint32_t hdr = len | IPC_DATA_FLAG;
+
+	ipc_conn_send(conn, &hdr, sizeof(hdr));
+	ipc_conn_send(conn, buf, len);
+}
+
+/**
+ * @brief Send the events that have happened since this was last called to the
+ * connections that are subscribed to them.
+ *
+ * This should be called once per iteration of the main loop, after relaying
+ * out. Events describe howm's state rather than each change to it, so however
+ * many times something changes in an iteration, subscribers receive at most
+ * one event of each type. Connections that break while being sent their
+ * events are closed.
+ */
+void ipc_send_events(void)
+{
+	static struct ipc_state states[2];
+	static unsigned int last_i;
+	struct ipc_state *cur = &states[!last_i], *last = &states[last_i];
+	struct ipc_ws_state *w;
+	struct ipc_conn *c;
+	unsigned int changed, events, ws_events;
+	uint32_t i;
+	bool subscribed = false;
+
+	for (c = conn_head; c; c = c->next)
+		subscribed |= c->events != 0;
+	if (!subscribed || !ipc_get_state(cur))
+		return;
+
+	changed = 0;
+	if (cur->mon != last->mon || cur->ws != last->ws)
+		changed |= EVENT_WORKSPACE;
+	if (cur->layout != last->layout)
+		changed |= EVENT_LAYOUT;
+	if (cur->focus != last->focus)
+		changed |= EVENT_FOCUS;
+	if (cur->mon != last->mon || cur->mon_cnt != last->mon_cnt)
+		changed |= EVENT_MONITOR;
+	/* Workspaces that didn't exist last time are compared with an empty
+	 * one. */
+	for (i = 0; i < cur->ws_cnt; i++) {
+		w = &cur->wss[i];
+		w->changed = 0;
+		if (w->client_cnt != (i < last->ws_cnt ? last->wss[i].client_cnt : 0))
+			w->changed |= EVENT_CLIENT;
+		if (w->urgent_cnt != (i < last->ws_cnt ? last->wss[i].urgent_cnt : 0))
+			w->changed |= EVENT_URGENT;
+	}
+	last_i = !last_i;
+
+	for (c = conn_head; c; c = c->next) {
+		/* A connection that is being sent a query's document is sent
+		 * the whole state once it has finished, rather than each
+		 * change. */
+		if (c->querying) {
+			c->events_sent = false;
+			continue;
+		}
+		events = c->events_sent ? changed & c->events : c->events;
+		if (events & EVENT_WORKSPACE)
+			ipc_send_event(c, EVENT_WORKSPACE, 2, cur->mon, cur->ws);
+		if (events & EVENT_LAYOUT)
+			ipc_send_event(c, EVENT_LAYOUT, 3, cur->mon, cur->ws, cur->layout);
+		if (events & EVENT_FOCUS)
+			ipc_send_event(c, EVENT_FOCUS, 1, cur->focus);
+		for (i = 0; i < cur->ws_cnt && c->events & (EVENT_CLIENT | EVENT_URGENT); i++) {
+			w = &cur->wss[i];
+			ws_events = c->events_sent ? w->changed & c->events : c->events;
+			if (ws_events & EVENT_CLIENT)
+				ipc_send_event(c, EVENT_CLIENT, 3, w->mon, i, w->client_cnt);
+			if (ws_events & EVENT_URGENT)
+				ipc_send_event(c, EVENT_URGENT, 3, w->mon, i, w->urgent_cnt);
+		}
+		if (events & EVENT_MONITOR)
+			ipc_send_event(c, EVENT_MONITOR, 2, cur->mon, cur->mon_cnt);
+		c->events_sent = true;
+	}
+	ipc_close_broken();
+}
+
+/**
+ * @brief Get the parts of howm's state that events describe.
+ *
+ * @param state Where the state is stored. Its array of workspaces is reused,
+ * and grown if there are more workspaces than it has room for.
+ *
+ * @return False if there wasn't enough memory.
+ */
+static bool ipc_get_state(struct ipc_state *state)
+{
+	struct ipc_ws_state *wss;
+	const monitor_t *m;
+	const workspace_t *ws;
+	uint32_t i = 0, j = 0;
+
+	state->mon = monitor_to_index(mon);
+	state->ws = workspace_to_index(mon->ws);
+	state->layout = mon->ws->layout;
+	state->focus = mon->ws->c ? mon->ws->c->win : XCB_WINDOW_NONE;
+	state->mon_cnt = mon_cnt;
+
+	for (m = mon_head; m; m = m->next)
+		i += m->workspace_cnt;
+	if (i > state->ws_size) {
+		wss = realloc(state->wss, i * sizeof(*wss));
+		if (!wss) {
+			log_err("Can't allocate memory for the state of %u workspaces", i);
+			return false;
+		}
+		state->wss = wss;
+		state->ws_size = i;
+	}
+
+	for (m = mon_head, i = 0; m; m = m->next, j++) {
+		for (ws = m->ws_head; ws; ws = ws->next, i++) {
+			state->wss[i].mon = j;
+			state->wss[i].client_cnt = ws->client_cnt;
+			state->wss[i].urgent_cnt = ws->urgent_cnt;
+		}
+	}
+	state->ws_cnt = i;
+	return true;
+}
+
+/**
+ * @brief Send an event to a connection.
+ *
+ * Events are framed like replies, but with IPC_EVENT_FLAG set in their length.
+ * On a text connection, the event is its name followed by its values as
+ * decimal strings, each terminated by a null character. On a binary
+ * connection, it is the event's uint32_t type followed by its values.
+ *
+ * @param conn The connection to send the event to.
+ * @param event The type of the event.
+ * @param n How many values follow.
+ * @param ... The event's values, as uint32_t.
+ */
+static void ipc_send_event(struct ipc_conn *conn, enum ipc_event event, int n, ...)
+{
+	char buf[IPC_EVENT_SIZE];
+	uint32_t len = 0, val;
+	unsigned int e;
+	va_list ap;
+
+	if (conn->binary) {
+		val = event;
+		memcpy(buf, &val, sizeof(val));
+		len = sizeof(val);
+	} else {
+		for (e = 0; !(event & (1 << e)); e++)
+			;
+		len = snprintf(buf, sizeof(buf), "%s", event_names[e]) + 1;
+	}
+
+	va_start(ap, n);
+	while (n--) {
+		val = va_arg(ap, uint32_t);
+		if (conn->binary) {
+			memcpy(buf + len, &val, sizeof(val));
+			len += sizeof(val);
+		} else {
+			len += snprintf(buf + len, sizeof(buf) - len, "%u", val) + 1;
+		}
+	}
+	va_end(ap);
+
+	val = len | IPC_EVENT_FLAG;
+	ipc_conn_send(conn, &val, sizeof(val));
+	ipc_conn_send(conn, buf, len);
+}
+
+/**
+ * @brief Send data to a connection.
+ *
+ * As much as possible is written straight away, the rest is queued and sent
+ * once the socket becomes writable. A client that stops reading its replies
+ * is disconnected rather than being allowed to queue unbounded data.
+ *
+ * @param conn The connection to send to.
+ * @param buf The data to send.
+ * @param len The length of buf.
+ */
+static void ipc_conn_send(struct ipc_conn *conn, const void *buf, size_t len)
+{
+	ssize_t n = 0;
+
+	if (conn->broken)
+		return;
+
+	if (conn->out_len == 0) {
+		n = send(conn->fd, buf, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (n == -1) {
+			if (errno != EAGAIN && errno != EINTR) {
+				conn->broken = true;
+				return;
+			}
+			n = 0;
+		}
+		if ((size_t)n == len)
+			return;
+	}
+
+	if (conn->out_len + len - n > IPC_MAX_QUEUED) {
+		log_warn("IPC client isn't reading its replies, disconnecting");
+		conn->broken = true;
+		return;
+	}
+	if (!buf_reserve(&conn->out, &conn->out_size, conn->out_len + len - n)) {
+		conn->broken = true;
+		return;
+	}
+	memcpy(conn->out + conn->out_len, (const char *)buf + n, len - n);
+	conn->out_len += len - n;
+	if (conn->out_len == len - n)
+		ipc_conn_watch(conn);
 }
 
 /**
- * @brief Delete the UNIX socket file.
+ * @brief Send as much of a connection's queued data as the socket will take.
+ *
+ * @param conn The connection whose queued data should be sent.
+ */
+static void ipc_conn_flush(struct ipc_conn *conn)
+{
+	ssize_t n;
+
+	if (conn->out_len == 0)
+		return;
+
+	if (conn->pass_fd != -1 && conn->pass_off == 0)
+		n = send_fd(conn->fd, conn->out, conn->out_len, conn->pass_fd);
+	else if (conn->pass_fd != -1)
+		n = send(conn->fd, conn->out, conn->pass_off, MSG_NOSIGNAL | MSG_DONTWAIT);
+	else
+		n = send(conn->fd, conn->out, conn->out_len, MSG_NOSIGNAL | MSG_DONTWAIT);
+	if (n == -1) {
+		if (errno != EAGAIN && errno != EINTR)
+			conn->broken = true;
+		return;
+	}
+	if (conn->pass_fd != -1 && conn->pass_off == 0) {
+		close(conn->pass_fd);
+		conn->pass_fd = -1;
+	} else if (conn->pass_fd != -1) {
+		conn->pass_off -= n;
+	}
+	conn->out_len -= n;
+	memmove(conn->out, conn->out + n, conn->out_len);
+	if (conn->out_len == 0)
+		ipc_conn_watch(conn);
+}
+
+/**
+ * @brief Watch a connection for the events that it needs.
+ *
+ * A connection is watched for EPOLLOUT while it has data queued or a query's
+ * document to finish, and for EPOLLIN unless it is sending a document.
+ *
+ * @param conn The connection to watch.
+ */
+static void ipc_conn_watch(struct ipc_conn *conn)
+{
+	reactor_modify(conn->fd, (conn->querying ? 0 : EPOLLIN)
+			| (conn->out_len > 0 || conn->querying ? EPOLLOUT : 0));
+}
+
+/**
+ * @brief Send data to a connection along with a file descriptor.
+ *
+ * The file descriptor is sent with the first byte of buf, even if there is
+ * other data queued before it. It is closed once it has been sent.
+ *
+ * @param conn The connection to send to.
+ * @param buf The data to send, which mustn't be empty.
+ * @param len The length of buf.
+ * @param fd The file descriptor to send.
+ */
+static void ipc_conn_send_fd(struct ipc_conn *conn, const void *buf, size_t len,
+		int fd)
+{
+	ssize_t n;
+
+	if (conn->broken) {
+		close(fd);
+		return;
+	}
+
+	if (conn->out_len == 0) {
+		do {
+			n = send_fd(conn->fd, buf, len, fd);
+		} while (n == -1 && errno == EINTR);
+		if (n > 0) {
+			close(fd);
+			ipc_conn_send(conn, (const char *)buf + n, len - n);
+			return;
+		} else if (errno != EAGAIN) {
+			close(fd);
+			conn->broken = true;
+			return;
+		}
+	}
+
+	/* The data is queued directly, as ipc_conn_send would send it without
+	 * the file descriptor if nothing else is queued. */
+	conn->pass_fd = fd;
+	conn->pass_off = conn->out_len;
+	if (conn->out_len + len > IPC_MAX_QUEUED) {
+		log_warn("IPC client isn't reading its replies, disconnecting");
+		conn->broken = true;
+		return;
+	}
+	if (!buf_reserve(&conn->out, &conn->out_size, conn->out_len + len)) {
+		conn->broken = true;
+		return;
+	}
+	memcpy(conn->out + conn->out_len, buf, len);
+	conn->out_len += len;
+	ipc_conn_watch(conn);
+}
+
+/**
+ * @brief Send data and a file descriptor over a UNIX socket, without blocking.
+ *
+ * @param sock The socket to send to.
+ * @param buf The data to send.
+ * @param len The length of buf.
+ * @param fd The file descriptor to send.
+ *
+ * @return The amount of data that was sent, or -1 on error.
+ */
+static ssize_t send_fd(int sock, const void *buf, size_t len, int fd)
+{
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+
+	memset(&msg, 0, sizeof(msg));
+	memset(&control, 0, sizeof(control));
+	iov.iov_base = (void *)buf;
+	iov.iov_len = len;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+	return sendmsg(sock, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+/**
+ * @brief Make sure that a buffer can hold at least a given number of bytes,
+ * growing it if required.
+ *
+ * @param buf The buffer, which may be NULL.
+ * @param size The current size of buf, which is updated if buf grows.
+ * @param need How many bytes buf must be able to hold.
+ *
+ * @return False if memory couldn't be allocated.
+ */
+static bool buf_reserve(char **buf, size_t *size, size_t need)
+{
+	size_t new_size = *size ? *size : IPC_BUF_SIZE;
+	char *new;
+
+	if (need <= *size)
+		return true;
+	while (new_size < need)
+		new_size *= 2;
+	new = realloc(*buf, new_size);
+	if (!new) {
+		log_err("Can't allocate memory for IPC buffer.");
+		return false;
+	}
+	*buf = new;
+	*size = new_size;
+	return true;
+}
+
+/**
+ * @brief Stop listening on the socket and delete the UNIX socket file.
  */
 void ipc_cleanup(void)
 {
 	char *sp = getenv(ENV_SOCK_VAR);
 
+	while (conn_head)
+		ipc_conn_close(conn_head);
+
+	if (sock_fd != -1) {
+		reactor_remove(sock_fd);
+		close(sock_fd);
+		sock_fd = -1;
+	}
+
 	if (sp)
 		unlink(sp);
 	else
@@ -106,169 +1219,523 @@ void ipc_cleanup(void)
  */
 int ipc_process(char *msg, int len)
 {
-	int err = IPC_ERR_NONE;
-	char **args = ipc_process_args(msg, len, &err);
+	return ipc_process_msg(msg, len);
+}
 
-	if (**args == MSG_FUNCTION)
-		err = ipc_process_function(args + 1);
-	else if (**args == MSG_CONFIG)
-		err = ipc_process_config(args + 1);
-	else
-		err = IPC_ERR_UNKNOWN_TYPE;
+/**
+ * @brief Process a message that was recorded in a journal, as it would have
+ * been when it was received.
+ *
+ * Commands that start programs, such as spawn, are checked but not acted on,
+ * so that replaying a session doesn't run everything that was run during it.
+ *
+ * @param msg The message, without the length of its frame.
+ * @param len The length of the message.
+ * @param binary Whether the message is in the binary format.
+ *
+ * @return The error code of the message, or of the first message in a batch
+ * that failed.
+ */
+int ipc_replay(char *msg, uint32_t len, bool binary)
+{
+	int32_t errs[IPC_MAX_BATCH];
+	uint16_t id = 0;
+	int i, cnt, err = IPC_ERR_NONE;
+
+	if (binary && len >= sizeof(id))
+		memcpy(&id, msg, sizeof(id));
+
+	replaying = true;
+	if ((binary && id == IPC_BIN_TRANSACTION)
+			|| (!binary && len > 0 && msg[0] == MSG_TRANSACTION)) {
+		cnt = ipc_process_batch(msg, len, binary, errs, IPC_MAX_BATCH);
+		if (cnt < 0)
+			err = IPC_ERR_SYNTAX;
+		for (i = 0; i < cnt && err == IPC_ERR_NONE; i++)
+			err = errs[i];
+	} else if (binary) {
+		err = ipc_process_bin(msg, len);
+	} else {
+		err = ipc_process_msg(msg, len);
+	}
+	replaying = false;
 
-	free(args);
 	return err;
 }
 
 /**
- * @brief Receive a char array from a UNIX socket and subsequently call a
- * function, passing the args from within msg.
+ * @brief Process a batch of messages, storing an error code for each of them.
+ *
+ * A batch is MSG_TRANSACTION followed by a null character (or a binary message
+ * with the command IPC_BIN_TRANSACTION and no args) and then each message,
+ * prefixed by its native endian uint32_t length. Every message is decoded and
+ * checked before any are acted on. If any of them are invalid, none of them
+ * are applied and the messages that were valid are given IPC_ERR_ABORTED.
+ * The main loop relays out and outputs the status once after the whole
+ * batch.
+ *
+ * Messages are checked against howm's state before the batch is applied, and
+ * the values that were decoded then are what is applied, so a message can't
+ * fail to decode because of an earlier message in the same batch. The one
+ * exception is a message whose workspace or monitor has been removed by an
+ * earlier message: it is skipped and given IPC_ERR_ARG_TOO_LARGE, while the
+ * messages before it stay applied and those after it are still applied.
+ *
+ * @param msg A buffer containing the batch.
+ * @param len The length of the batch.
+ * @param binary Whether the batch's messages are in the binary format.
+ * @param errs Where the error code of each message is stored.
+ * @param max How many error codes errs can hold.
+ *
+ * @return The number of messages in the batch, or -1 if the batch was
+ * malformed.
+ */
+static int ipc_process_batch(char *msg, uint32_t len, bool binary, int32_t *errs,
+		int max)
+{
+	char *sub[IPC_MAX_BATCH];
+	uint32_t sub_len[IPC_MAX_BATCH];
+	const struct ipc_cmd *cmds[IPC_MAX_BATCH];
+	struct ipc_val vals[IPC_MAX_BATCH];
+	uint32_t off = binary ? sizeof(struct ipc_bin_msg) : 2;
+	bool valid = true;
+	char **pool = NULL, **args;
+	size_t pool_len = 0;
+	int i, cap, cnt = 0;
+
+	while (off < len) {
+		if (cnt == max || cnt == IPC_MAX_BATCH
+				|| len - off < sizeof(uint32_t))
+			return -1;
+		memcpy(&sub_len[cnt], msg + off, sizeof(uint32_t));
+		off += sizeof(uint32_t);
+		if (sub_len[cnt] > len - off)
+			return -1;
+		sub[cnt] = msg + off;
+		pool_len += (sub_len[cnt] < IPC_MAX_ARGS ? sub_len[cnt] : IPC_MAX_ARGS) + 1;
+		off += sub_len[cnt++];
+	}
+
+	/* The decoded args of a text message can point into its array of args,
+	 * so each message keeps its own until the batch has been applied. */
+	if (!binary && cnt) {
+		pool = malloc(pool_len * sizeof(*pool));
+		if (!pool) {
+			for (i = 0; i < cnt; i++)
+				errs[i] = IPC_ERR_ALLOC;
+			return cnt;
+		}
+	}
+
+	for (i = 0, args = pool; i < cnt; i++) {
+		if (binary) {
+			errs[i] = ipc_parse_bin(sub[i], sub_len[i], &cmds[i], &vals[i]);
+		} else {
+			cap = sub_len[i] < IPC_MAX_ARGS ? sub_len[i] : IPC_MAX_ARGS;
+			errs[i] = ipc_parse_msg(sub[i], sub_len[i], args, cap,
+					&cmds[i], &vals[i]);
+			args += cap + 1;
+		}
+		if (errs[i] != IPC_ERR_NONE)
+			valid = false;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		if (!valid) {
+			if (errs[i] == IPC_ERR_NONE)
+				errs[i] = IPC_ERR_ABORTED;
+			continue;
+		}
+		errs[i] = ipc_call(cmds[i], &vals[i]);
+		if (errs[i] != IPC_ERR_NONE)
+			log_warn("Message %d of a batch was skipped, as its target "
+					"was removed by an earlier message", i);
+	}
+
+	free(pool);
+	return cnt;
+}
+
+/**
+ * @brief Parse a message and act on it.
  *
- * @param args The args (as strings).
+ * @param msg A buffer containing the message.
+ * @param len The length of the message.
  *
- * @return The error code, as set by this function itself or those that it
- * calls.
+ * @return An error code resulting from processing msg.
  */
-static int ipc_process_function(char **args)
+static int ipc_process_msg(char *msg, int len)
+{
+	/* Every arg is terminated by a null character, so a message can't
+	 * contain more args than it does bytes. */
+	int cap = len < IPC_MAX_ARGS ? len : IPC_MAX_ARGS;
+	char *args[cap + 1];
+	const struct ipc_cmd *cmd;
+	struct ipc_val val;
+	int err = ipc_parse_msg(msg, len, args, cap, &cmd, &val);
+
+	return err == IPC_ERR_NONE ? ipc_call(cmd, &val) : err;
+}
+
+/**
+ * @brief Parse a message, finding its command and decoding its args
+ * according to the command's schema.
+ *
+ * @param msg A buffer containing the message.
+ * @param len The length of the message.
+ * @param args Where the message is split into args, which must hold cap + 1
+ * pointers and must outlive val.
+ * @param cap The most args that the message may have.
+ * @param cmd Where the command is stored.
+ * @param val Where the command's decoded args are stored.
+ *
+ * @return An error code resulting from parsing msg.
+ */
+static int ipc_parse_msg(char *msg, int len, char **args, int cap,
+		const struct ipc_cmd **cmd, struct ipc_val *val)
 {
 	int err = IPC_ERR_NONE;
-	int i = 0;
-
-#define CALL_INT(func, arg, lower, upper) \
-	do { \
-		i = ipc_arg_to_int(arg, &err, lower, upper); \
-		if (err == IPC_ERR_NONE) \
-			func(i); \
-	} while (0)
-
-	if (strncmp(args[0], "teleport_client", strlen("teleport_client")) == 0) {
-		CALL_INT(teleport_client, args[1], TOP_LEFT, BOTTOM_RIGHT);
-	} else if (strncmp(args[0], "quit", strlen("quit")) == 0) {
-		CALL_INT(quit, args[1], EXIT_SUCCESS, EXIT_FAILURE);
-	} else if (strncmp(args[0], "resize_float_width", strlen("resize_float_width")) == 0) {
-		CALL_INT(resize_float_width, args[1], -100, 100);
-	} else if (strncmp(args[0], "resize_float_height", strlen("resize_float_height")) == 0) {
-		CALL_INT(resize_float_height, args[1], -100, 100);
-	} else if (strncmp(args[0], "move_float_x", strlen("move_float_x")) == 0) {
-		CALL_INT(move_float_x, args[1], -100, 100);
-	} else if (strncmp(args[0], "move_float_y", strlen("move_float_y")) == 0) {
-		CALL_INT(move_float_y, args[1], -100, 100);
-	} else if (strncmp(args[0], "resize_master", strlen("resize_master")) == 0) {
-		CALL_INT(resize_master, args[1], -100, 100);
-	} else if (strncmp(args[0], "count", strlen("count")) == 0) {
-		CALL_INT(count, args[1], 1, 9);
-#undef CALL_INT
-
-/*TODO: Don't do this - we should have a neat wrapper function
- * for functions requiring a workspace pointer.
- */
-#define CALL_WORKSPACE(func, arg, lower, upper) \
-	do { \
-		i = ipc_arg_to_int(arg, &err, lower, upper); \
-		if (err == IPC_ERR_NONE) { \
-			func(index_to_workspace(mon, i)); \
-		} \
-	} while (0)
-
-	} else if (strncmp(args[0], "change_ws", strlen("change_ws")) == 0) {
-		CALL_WORKSPACE(change_ws, args[1], 0, mon->workspace_cnt - 1);
-	} else if (strncmp(args[0], "current_to_ws", strlen("current_to_ws")) == 0) {
-		CALL_WORKSPACE(current_to_ws, args[1], 0, mon->workspace_cnt - 1);
-#undef CALL_WORKSPACE
-	} else if (strncmp(args[0], "add_ws", strlen("add_ws")) == 0) {
-		add_ws(mon);
-	} else if (strncmp(args[0], "remove_ws", strlen("remove_ws")) == 0) {
-		i = ipc_arg_to_int(args[1], &err, 0, mon->workspace_cnt - 1);
-		if (err == IPC_ERR_NONE)
-			remove_ws(mon, index_to_workspace(mon, i));
-	} else if (strncmp(args[0], "move_current_down", strlen("move_current_down")) == 0) {
-		move_current_down();
-	} else if (strncmp(args[0], "move_current_up", strlen("move_current_up")) == 0) {
-		move_current_up();
-	} else if (strncmp(args[0], "focus_monitor", strlen("focus_monitor")) == 0) {
-		i = ipc_arg_to_int(args[1], &err, 0, mon_cnt - 1);
-		if (err == IPC_ERR_NONE)
-			focus_monitor(index_to_monitor(i));
-	} else if (strncmp(args[0], "focus_next_client", strlen("focus_next_client")) == 0) {
-		focus_next_client();
-	} else if (strncmp(args[0], "focus_prev_client", strlen("focus_prev_client")) == 0) {
-		focus_prev_client();
-	} else if (strncmp(args[0], "toggle_float", strlen("toggle_float")) == 0) {
-		toggle_float();
-	} else if (strncmp(args[0], "toggle_fullscreen", strlen("toggle_fullscreen")) == 0) {
-		toggle_fullscreen();
-	} else if (strncmp(args[0], "focus_urgent", strlen("focus_urgent")) == 0) {
-		focus_urgent();
-	} else if (strncmp(args[0], "send_to_scratchpad", strlen("send_to_scratchpad")) == 0) {
-		send_to_scratchpad();
-	} else if (strncmp(args[0], "get_from_scratchpad", strlen("get_from_scratchpad")) == 0) {
-		get_from_scratchpad();
-	} else if (strncmp(args[0], "make_master", strlen("make_master")) == 0) {
-		make_master();
-	} else if (strncmp(args[0], "toggle_bar", strlen("toggle_bar")) == 0) {
-		toggle_bar();
-	} else if (strncmp(args[0], "focus_next_ws", strlen("focus_next_ws")) == 0) {
-		focus_next_ws();
-	} else if (strncmp(args[0], "focus_prev_ws", strlen("focus_prev_ws")) == 0) {
-		focus_prev_ws();
-	} else if (strncmp(args[0], "focus_last_ws", strlen("focus_last_ws")) == 0) {
-		focus_last_ws();
-	} else if (strncmp(args[0], "paste", strlen("paste")) == 0) {
-		paste();
-	} else if (strncmp(args[0], "change_layout", strlen("change_layout")) == 0) {
-		/* TODO: Allow the layout of an arbitrary monitor to be changed
-		 * without having to focus it. */
-		i = ipc_arg_to_int(args[0], &err, ZOOM, END_LAYOUT - 1);
-		if (err == IPC_ERR_NONE)
-			change_layout(mon, i);
-	} else if (strncmp(args[0], "next_layout", strlen("next_layout")) == 0) {
-		next_layout(mon);
-	} else if (strncmp(args[0], "prev_layout", strlen("prev_layout")) == 0) {
-		prev_layout(mon);
-	} else if (strncmp(args[0], "last_layout", strlen("last_layout")) == 0) {
-		last_layout(mon);
-	} else if (strncmp(args[0], "spawn", strlen("spawn")) == 0) {
-		spawn(args + 1);
-	} else if (strncmp(args[0], "motion", strlen("motion")) == 0) {
-		motion(args[1]);
-	} else if (strncmp(args[0], "op_kill", strlen("op_kill")) == 0) {
-		operator_func = op_kill;
-		cur_state = COUNT_STATE;
-	} else if (strncmp(args[0], "op_move_up", strlen("op_move_up")) == 0) {
-		operator_func = op_move_up;
-		cur_state = COUNT_STATE;
-	} else if (strncmp(args[0], "op_move_down", strlen("op_move_down")) == 0) {
-		operator_func = op_move_down;
-		cur_state = COUNT_STATE;
-	} else if (strncmp(args[0], "op_focus_down", strlen("op_focus_down")) == 0) {
-		operator_func = op_focus_down;
-		cur_state = COUNT_STATE;
-	} else if (strncmp(args[0], "op_focus_up", strlen("op_focus_up")) == 0) {
-		operator_func = op_focus_up;
-		cur_state = COUNT_STATE;
-	} else if (strncmp(args[0], "op_shrink_gaps", strlen("op_shrink_gaps")) == 0) {
-		operator_func = op_shrink_gaps;
-		cur_state = COUNT_STATE;
-	} else if (strncmp(args[0], "op_grow_gaps", strlen("op_grow_gaps")) == 0) {
-		operator_func = op_grow_gaps;
-		cur_state = COUNT_STATE;
-	} else if (strncmp(args[0], "op_cut", strlen("op_cut")) == 0) {
-		operator_func = op_cut;
-		cur_state = COUNT_STATE;
+
+	if (ipc_process_args(msg, len, args, cap, &err) == -1)
+		return err;
+
+	if (**args != MSG_FUNCTION && **args != MSG_CONFIG) {
+		err = IPC_ERR_UNKNOWN_TYPE;
+	} else if (!args[1]) {
+		err = IPC_ERR_TOO_FEW_ARGS;
 	} else {
+		*cmd = ipc_lookup(args[1]);
+		if (!*cmd || (int)(*cmd)->type != **args)
+			err = **args == MSG_CONFIG ? IPC_ERR_NO_CONFIG : IPC_ERR_NO_FUNC;
+		else
+			err = ipc_decode(*cmd, args + 2, val);
+	}
+
+	return err;
+}
+
+/**
+ * @brief Parse a binary message and act on it.
+ *
+ * @param msg A buffer containing the message.
+ * @param len The length of the message.
+ *
+ * @return An error code resulting from processing msg.
+ */
+static int ipc_process_bin(const char *msg, uint32_t len)
+{
+	const struct ipc_cmd *cmd;
+	struct ipc_val val;
+	int err = ipc_parse_bin(msg, len, &cmd, &val);
+
+	return err == IPC_ERR_NONE ? ipc_call(cmd, &val) : err;
+}
+
+/**
+ * @brief Parse a binary message, finding its command and decoding its args.
+ *
+ * A binary message is a struct ipc_bin_msg followed by its packed args. The
+ * command id is the command's index in ipc_cmds. No memory is allocated.
+ *
+ * @param msg A buffer containing the message.
+ * @param len The length of the message.
+ * @param cmd Where the command is stored.
+ * @param val Where the command's decoded args are stored.
+ *
+ * @return An error code resulting from parsing msg.
+ */
+static int ipc_parse_bin(const char *msg, uint32_t len,
+		const struct ipc_cmd **cmd, struct ipc_val *val)
+{
+	struct ipc_bin_msg hdr;
+
+	if (len < sizeof(hdr))
+		return IPC_ERR_SYNTAX;
+	memcpy(&hdr, msg, sizeof(hdr));
+	if (len != sizeof(hdr) + hdr.argc * sizeof(int32_t))
+		return IPC_ERR_SYNTAX;
+	if (hdr.cmd >= LENGTH(ipc_cmds))
 		return IPC_ERR_NO_FUNC;
+
+	*cmd = &ipc_cmds[hdr.cmd];
+	return ipc_decode_bin(*cmd, msg + sizeof(hdr), hdr.argc, val);
+}
+
+/**
+ * @brief Build the perfect hash that is used to find commands by name.
+ *
+ * Seeds are tried until one is found that gives every command in the table
+ * its own slot, so that a lookup is a single hash and string comparison.
+ */
+static void ipc_build_hash(void)
+{
+	unsigned int i, h;
+
+	if (LENGTH(ipc_cmds) >= UINT8_MAX) {
+		log_err("Too many IPC commands for the hash table.");
+		exit(EXIT_FAILURE);
+	}
+
+	for (cmd_seed = 0; cmd_seed < IPC_MAX_SEED; cmd_seed++) {
+		memset(cmd_slots, 0, sizeof(cmd_slots));
+		for (i = 0; i < LENGTH(ipc_cmds); i++) {
+			h = ipc_hash(ipc_cmds[i].name, cmd_seed);
+			if (cmd_slots[h])
+				break;
+			cmd_slots[h] = i + 1;
+		}
+		if (i == LENGTH(ipc_cmds)) {
+			log_debug("Using IPC hash seed %u", cmd_seed);
+			return;
+		}
+	}
+
+	log_err("Couldn't find a perfect hash for the IPC commands.");
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Hash a command's name into a slot of the command hash table.
+ *
+ * This is FNV-1a, with the offset basis perturbed by a seed.
+ *
+ * @param name The command's name.
+ * @param seed The seed to hash with.
+ *
+ * @return A slot of the command hash table.
+ */
+static unsigned int ipc_hash(const char *name, uint32_t seed)
+{
+	uint32_t h = 2166136261u ^ seed;
+
+	while (*name) {
+		h ^= (uint8_t)*name++;
+		h *= 16777619u;
+	}
+	return (h ^ (h >> 16)) & (IPC_HASH_SIZE - 1);
+}
+
+/**
+ * @brief Find a command by its name.
+ *
+ * @param name The name of the command.
+ *
+ * @return The command, or NULL if there isn't a command called name.
+ */
+static const struct ipc_cmd *ipc_lookup(const char *name)
+{
+	unsigned int i = cmd_slots[ipc_hash(name, cmd_seed)];
+
+	if (!i || strcmp(ipc_cmds[i - 1].name, name) != 0)
+		return NULL;
+	return &ipc_cmds[i - 1];
+}
+
+/**
+ * @brief Resolve a bound that depends on howm's current state.
+ *
+ * @param bound Either a constant bound or one of the values in enum
+ * ipc_bound.
+ *
+ * @return The value of the bound.
+ */
+static int ipc_bound(int bound)
+{
+	switch (bound) {
+	case BOUND_LAST_WS:
+		return mon->workspace_cnt - 1;
+	case BOUND_LAST_MON:
+		return mon_cnt - 1;
+	case BOUND_MON_WIDTH:
+		return mon->rect.width;
+	case BOUND_MON_HEIGHT:
+		return mon->rect.height;
+	default:
+		return bound;
 	}
+}
 
+/**
+ * @brief Decode the args of a command according to its schema.
+ *
+ * @param cmd The command whose args are being decoded.
+ * @param args The args that follow the command's name, terminated by NULL.
+ * @param val Where the decoded value is stored.
+ *
+ * @return An error code if the args weren't valid.
+ */
+static int ipc_decode(const struct ipc_cmd *cmd, char **args, struct ipc_val *val)
+{
+	int err = IPC_ERR_NONE;
+
+	memset(val, 0, sizeof(*val));
+	if (cmd->arg != ARG_NONE && !args[0])
+		return IPC_ERR_TOO_FEW_ARGS;
+
+	switch (cmd->arg) {
+	case ARG_NONE:
+		break;
+	case ARG_INT:
+	case ARG_WS:
+	case ARG_MON:
+		val->i = ipc_arg_to_int(args[0], &err, ipc_bound(cmd->lower),
+				ipc_bound(cmd->upper));
+		break;
+	case ARG_BOOL:
+		val->b = ipc_arg_to_bool(args[0], &err);
+		break;
+	case ARG_COLOUR:
+		if (strlen(args[0]) > 7)
+			err = IPC_ERR_ARG_TOO_LARGE;
+		else if (strlen(args[0]) < 7)
+			err = IPC_ERR_ARG_TOO_SMALL;
+		else
+			memcpy(val->colour, args[0], sizeof(val->colour));
+		break;
+	case ARG_STR:
+		val->str = args[0];
+		break;
+	case ARG_ARGV:
+		val->argv = args;
+		break;
+	}
 	return err;
 }
 
+/**
+ * @brief Decode the packed args of a binary message according to its
+ * command's schema.
+ *
+ * Commands that take strings can't be sent as binary messages.
+ *
+ * @param cmd The command whose args are being decoded.
+ * @param args The packed int32_t args, which may be unaligned.
+ * @param argc How many args there are.
+ * @param val Where the decoded value is stored.
+ *
+ * @return An error code if the args weren't valid.
+ */
+static int ipc_decode_bin(const struct ipc_cmd *cmd, const char *args,
+		unsigned int argc, struct ipc_val *val)
+{
+	int32_t arg = 0;
+
+	memset(val, 0, sizeof(*val));
+	if (cmd->arg == ARG_NONE)
+		return IPC_ERR_NONE;
+	if (argc < 1)
+		return IPC_ERR_TOO_FEW_ARGS;
+	memcpy(&arg, args, sizeof(arg));
+
+	switch (cmd->arg) {
+	case ARG_NONE:
+		break;
+	case ARG_INT:
+	case ARG_WS:
+	case ARG_MON:
+		if (arg > ipc_bound(cmd->upper))
+			return IPC_ERR_ARG_TOO_LARGE;
+		else if (arg < ipc_bound(cmd->lower))
+			return IPC_ERR_ARG_TOO_SMALL;
+		val->i = arg;
+		break;
+	case ARG_BOOL:
+		if (arg != 0 && arg != 1)
+			return IPC_ERR_ARG_NOT_BOOL;
+		val->b = arg;
+		break;
+	case ARG_COLOUR:
+		if (arg > 0xFFFFFF)
+			return IPC_ERR_ARG_TOO_LARGE;
+		else if (arg < 0)
+			return IPC_ERR_ARG_TOO_SMALL;
+		snprintf(val->colour, sizeof(val->colour), "#%06X", (unsigned int)arg);
+		break;
+	case ARG_STR:
+	case ARG_ARGV:
+		return IPC_ERR_SYNTAX;
+	}
+	return IPC_ERR_NONE;
+}
+
+/**
+ * @brief Act on a command whose args have been decoded.
+ *
+ * @param cmd The command to act on.
+ * @param val The command's decoded args.
+ *
+ * @return IPC_ERR_ARG_TOO_LARGE if the command's workspace or monitor no
+ * longer exists, which can only happen in a batch.
+ */
+static int ipc_call(const struct ipc_cmd *cmd, const struct ipc_val *val)
+{
+	uint64_t start = stats_now();
+	monitor_t *m = cmd->arg == ARG_MON ? index_to_monitor(val->i) : mon;
+	workspace_t *ws = cmd->arg == ARG_WS ? index_to_workspace(mon, val->i) : NULL;
+
+	if (!m || (cmd->arg == ARG_WS && !ws))
+		return IPC_ERR_ARG_TOO_LARGE;
+
+	if (cmd->op) {
+		operator_func = cmd->op;
+		cur_state = COUNT_STATE;
+	} else if (cmd->call) {
+		cmd->call();
+	} else if (cmd->call_int) {
+		cmd->call_int(val->i);
+	} else if (cmd->call_mon) {
+		cmd->call_mon(m);
+	} else if (cmd->call_mon_int) {
+		cmd->call_mon_int(mon, val->i);
+	} else if (cmd->call_ws) {
+		cmd->call_ws(ws);
+	} else if (cmd->call_mon_ws) {
+		cmd->call_mon_ws(mon, ws);
+	} else if (cmd->call_str) {
+		cmd->call_str(val->str);
+	} else if (cmd->call_argv && !replaying) {
+		cmd->call_argv(val->argv);
+	} else if (cmd->opt_u16) {
+		*cmd->opt_u16 = val->i;
+	} else if (cmd->opt_bool) {
+		*cmd->opt_bool = val->b;
+	} else if (cmd->opt_colour) {
+		*cmd->opt_colour = get_colour((char *)val->colour);
+	}
+
+	if (cmd->type == MSG_CONFIG)
+		update_focused_client(mon->ws->c);
+
+	stats_cmd(cmd - ipc_cmds, cmd->name, start);
+	trace_end(cmd->name, "ipc", start);
+	return IPC_ERR_NONE;
+}
+
+/**
+ * @brief Call count(), which takes an unsigned count.
+ *
+ * @param cnt The count.
+ */
+static void ipc_count(const int cnt)
+{
+	count(cnt);
+}
+
+/**
+ * @brief Call change_ws(), which takes a const workspace.
+ *
+ * @param ws The workspace to change to.
+ */
+static void ipc_change_ws(workspace_t *ws)
+{
+	change_ws(ws);
+}
+
 /**
  * @brief Convert a numerical string into a decimal value, such as "12"
  * becoming 12.
  *
- * Minus signs are handled. It is assumed that a two digit number won't start
- * with a zero. Args with more than two digits will not be accepted, nor will
- * args that aren't numerical.
+ * Minus signs are handled. Args that aren't numerical will not be accepted.
  *
  * @param arg The string to be converted.
  * @param err Where errors are reported.
@@ -279,16 +1746,19 @@ static int ipc_process_function(char **args)
  */
 static int ipc_arg_to_int(char *arg, int *err, int lower, int upper)
 {
-	int ret = 0;
+	long ret = 0;
+	char *end;
 
 	if (!arg) {
 		*err = IPC_ERR_TOO_FEW_ARGS;
 		return ret;
 	}
 
-	ret = atoi(arg);
+	ret = strtol(arg, &end, 10);
 
-	if (ret > upper)
+	if (end == arg || *end != '\0')
+		*err = IPC_ERR_ARG_NOT_INT;
+	else if (ret > upper)
 		*err = IPC_ERR_ARG_TOO_LARGE;
 	else if (ret < lower)
 		*err = IPC_ERR_ARG_TOO_SMALL;
@@ -296,157 +1766,45 @@ static int ipc_arg_to_int(char *arg, int *err, int lower, int upper)
 }
 
 /**
- * @brief Accepts a char array and convert it into an array of strings.
+ * @brief Split a char array into an array of strings.
  *
- * msg is split into strings (delimited by a null character) and placed in an
- * array. err is set with a corresponding error (such as args too few args), or
- * nothing.
- *
- * XXX: args must be freed by the caller.
+ * msg is split into strings (delimited by a null character) and placed in
+ * args, which is terminated by NULL. Nothing is allocated: args points into
+ * msg.
  *
  * @param msg A char array that is read from a UNIX socket.
  * @param len The length of data in msg.
+ * @param args Where the strings are stored.
+ * @param cap How many strings args can hold, excluding the terminating NULL.
  * @param err Where any errors will be stored.
  *
- * @return A pointer to an array of strings, each one representing an argument
- * that has been passed over a UNIX socket.
+ * @return The number of strings in args, or -1 if there was an error.
  */
-static char **ipc_process_args(char *msg, int len, int *err)
+static int ipc_process_args(char *msg, int len, char **args, int cap, int *err)
 {
-	int argc = 0, i = 0, arg_start = 0, lim = 2;
-	char **args = malloc(lim * sizeof(char *));
-
-	if (!args) {
-		*err = IPC_ERR_ALLOC;
-		return NULL;
-	}
+	int argc = 0, i = 0, arg_start = 0;
 
 	for (; i < len; i++) {
 		if (msg[i] == 0) {
-			*(args + argc++) = msg + arg_start;
-			arg_start = i + 1;
-
-			if (argc == lim) {
-				lim *= 2;
-				char **new = realloc(args, lim * sizeof(char *));
-
-				if (!new) {
-					*err = IPC_ERR_ALLOC;
-					free(args);
-					return NULL;
-				}
-				args = new;
+			if (argc == cap) {
+				*err = IPC_ERR_TOO_MANY_ARGS;
+				return -1;
 			}
+			args[argc++] = msg + arg_start;
+			arg_start = i + 1;
 		}
 	}
 
-	/* Make room to add the NULL after the last character. */
-	if (argc == lim) {
-		char **new = realloc(args, (lim + 1) * sizeof(char *));
-
-		if (!new) {
-			*err = IPC_ERR_ALLOC;
-			return NULL;
-		}
-		args = new;
-	}
-
 	/* The end of the array should be NULL, as the whole array can be passed to
-	 * spawn() and that expects a NULL terminated array.
-	 *
-	 * Use argc here as args are zero indexed. */
-	*(args + argc) = NULL;
+	 * spawn() and that expects a NULL terminated array. */
+	args[argc] = NULL;
 
 	if (argc < 1) {
 		*err = IPC_ERR_TOO_FEW_ARGS;
-		free(args);
-		return NULL;
+		return -1;
 	}
 
-	return args;
-}
-
-/**
- * @brief Process a config message. If the config option isn't recognised, set
- * err to IPC_ERR_NO_CONFIG.
- *
- * @param args An array of strings representing the args.
- *
- * @return err containing the error (or lack of) that has occurred.
- */
-static int ipc_process_config(char **args)
-{
-	int err = IPC_ERR_NONE;
-	int i = 0;
-	bool b = false;
-
-	if (!args[0] || !args[1])
-		return IPC_ERR_TOO_FEW_ARGS;
-
-#define SET_INT(opt, arg, lower, upper) \
-	do { \
-		i = ipc_arg_to_int(arg, &err, lower, upper); \
-			if (err == IPC_ERR_NONE) \
-				opt = i; \
-	} while (0)
-
-	if (strcmp("border_px", args[0]) == 0)
-		SET_INT(conf.border_px, args[1], 0, 32);
-	else if (strcmp("float_spawn_height", args[0]) == 0)
-		SET_INT(conf.float_spawn_height, args[1], 1, mon->rect.height);
-	else if (strcmp("float_spawn_width", args[0]) == 0)
-		SET_INT(conf.float_spawn_width, args[1], 1, mon->rect.width);
-	else if (strcmp("scratchpad_height", args[0]) == 0)
-		SET_INT(conf.scratchpad_height, args[1], 1, mon->rect.height);
-	else if (strcmp("scratchpad_width", args[0]) == 0)
-		SET_INT(conf.scratchpad_width, args[1], 1, mon->rect.width);
-	else if (strcmp("op_gap_size", args[0]) == 0)
-		SET_INT(conf.op_gap_size, args[1], 0, 32);
-	else if (strcmp("bar_height", args[0]) == 0)
-		SET_INT(conf.bar_height, args[1], 0, mon->rect.height);
-#undef SET_INT
-#define SET_BOOL(opt, arg) \
-	do { \
-		b = ipc_arg_to_bool(arg, &err); \
-			if (err == IPC_ERR_NONE) \
-				opt = b; \
-	} while (0)
-
-	else if (strcmp("focus_mouse", args[0]) == 0)
-		SET_BOOL(conf.focus_mouse, args[1]);
-	else if (strcmp("focus_mouse_click", args[0]) == 0)
-		SET_BOOL(conf.focus_mouse_click, args[1]);
-	else if (strcmp("follow_move", args[0]) == 0)
-		SET_BOOL(conf.follow_move, args[1]);
-	else if (strcmp("zoom_gap", args[0]) == 0)
-		SET_BOOL(conf.zoom_gap, args[1]);
-	else if (strcmp("center_floating", args[0]) == 0)
-		SET_BOOL(conf.center_floating, args[1]);
-	else if (strcmp("bar_bottom", args[0]) == 0)
-		SET_BOOL(conf.bar_bottom, args[1]);
-#undef SET_BOOL
-#define SET_COLOUR(opt, arg) \
-	do { \
-		if (strlen(arg) > 7) \
-			return IPC_ERR_ARG_TOO_LARGE; \
-		else if (strlen(arg) < 7) \
-			return IPC_ERR_ARG_TOO_SMALL; \
-		opt = get_colour(arg); \
-	} while (0)
-
-	else if (strcmp("border_focus", args[0]) == 0)
-		SET_COLOUR(conf.border_focus, args[1]);
-	else if (strcmp("border_unfocus", args[0]) == 0)
-		SET_COLOUR(conf.border_unfocus, args[1]);
-	else if (strcmp("border_prev_focus", args[0]) == 0)
-		SET_COLOUR(conf.border_prev_focus, args[1]);
-	else if (strcmp("border_urgent", args[0]) == 0)
-		SET_COLOUR(conf.border_urgent, args[1]);
-	else
-		err = IPC_ERR_NO_CONFIG;
-	update_focused_client(mon->ws->c);
-	return err;
-#undef SET_COLOUR
+	return argc;
 }
 
 /**
@@ -1,6 +1,9 @@
 #ifndef IPC_H
 #define IPC_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 /**
  * @file ipc.h
  *
@@ -14,11 +17,49 @@
 enum ipc_errs { IPC_ERR_NONE, IPC_ERR_SYNTAX, IPC_ERR_ALLOC, IPC_ERR_NO_FUNC,
 	IPC_ERR_TOO_MANY_ARGS, IPC_ERR_TOO_FEW_ARGS, IPC_ERR_ARG_NOT_INT,
 	IPC_ERR_ARG_NOT_BOOL, IPC_ERR_ARG_TOO_LARGE, IPC_ERR_ARG_TOO_SMALL,
-	IPC_ERR_UNKNOWN_TYPE, IPC_ERR_NO_CONFIG };
+	IPC_ERR_UNKNOWN_TYPE, IPC_ERR_NO_CONFIG, IPC_ERR_ABORTED,
+	IPC_ERR_NO_SNAPSHOT, IPC_ERR_NO_QUERY };
+/** Sent by clients at the start of a connection to use framed messages. */
+#define IPC_MAGIC "howm"
+#define IPC_MAGIC_LEN 4
+/** The version of the framed protocol, sent after IPC_MAGIC. */
+#define IPC_VERSION 2
+/** The command id of a binary message that contains a batch of messages. */
+#define IPC_BIN_TRANSACTION UINT16_MAX
+/** The command id of a binary message that subscribes to events. */
+#define IPC_BIN_SUBSCRIBE (UINT16_MAX - 1)
+/** The command id of a binary message that asks for the snapshot's fd. */
+#define IPC_BIN_SNAPSHOT (UINT16_MAX - 2)
+/** The command id of a binary message that queries part of howm's state. */
+#define IPC_BIN_QUERY (UINT16_MAX - 3)
+/** Set in the length of a frame that contains an event rather than a reply. */
+#define IPC_EVENT_FLAG 0x80000000u
+/** Set in the length of a frame that contains part of a query's document. */
+#define IPC_DATA_FLAG 0x40000000u
+
+/** The events that clients can subscribe to. */
+enum ipc_event { EVENT_WORKSPACE = 1 << 0, EVENT_LAYOUT = 1 << 1,
+	EVENT_FOCUS = 1 << 2, EVENT_CLIENT = 1 << 3, EVENT_URGENT = 1 << 4,
+	EVENT_MONITOR = 1 << 5, EVENT_ALL = (1 << 6) - 1 };
+
+/** The format of framed messages, sent after IPC_VERSION. */
+enum ipc_format { IPC_FORMAT_TEXT, IPC_FORMAT_BINARY };
+
+/**
+ * @brief The header of a binary message, which is followed by argc packed
+ * int32_t args. Everything is native endian.
+ */
+struct ipc_bin_msg {
+	uint16_t cmd; /**< The command's id. */
+	uint16_t argc; /**< How many args follow the header. */
+};
+
 enum arg_types { TYPE_IGNORE, TYPE_INT, TYPE_STR };
 
 void ipc_cleanup(void);
-int ipc_init(void);
+void ipc_init(void);
 int ipc_process(char *msg, int len);
+int ipc_replay(char *msg, uint32_t len, bool binary);
+void ipc_send_events(void);
 
 #endif
@@ -0,0 +1,285 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+
+#include "helper.h"
+#include "journal.h"
+
+/**
+ * @file journal.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Record the X events and IPC messages that howm handles to a binary
+ * journal, and read a journal back so that a session can be replayed.
+ *
+ * Together with the points at which the main loop did its deferred work, the
+ * events and messages are everything that drives howm's state. Replaying them
+ * from the same starting state makes howm send the same requests, so a
+ * journal of a real session gives repeatable numbers for its hot paths.
+ *
+ * Records are buffered and only written once the buffer is full or the
+ * journal is closed. When howm restarts in place, the new instance appends to
+ * the journal, as the state that it restores is the state that the journal's
+ * records lead to.
+ */
+
+/** How much of the journal is buffered before it is written. */
+#define JOURNAL_BUF_SIZE (64 * 1024)
+
+bool journal_enabled;
+
+static int journal_fd = -1;
+static char buf[JOURNAL_BUF_SIZE];
+static size_t buf_len;
+/** Has anything been recorded since the last JOURNAL_LOOP record? */
+static bool since_loop;
+
+static void journal_put(enum journal_type type, const void *data, uint32_t len);
+static bool journal_write(const void *data, size_t len);
+static void journal_flush(void);
+
+/**
+ * @brief Start recording a journal.
+ *
+ * @param path Where the journal is written.
+ * @param scr The screen that howm is managing.
+ * @param append Whether to carry on with the journal at the path, such as
+ * after a restart, rather than replacing it.
+ *
+ * @return False if the journal couldn't be created.
+ */
+bool journal_open(const char *path, const xcb_screen_t *scr, bool append)
+{
+	uint32_t version = JOURNAL_VERSION;
+	struct journal_screen js = { .root = scr->root,
+		.width = scr->width_in_pixels, .height = scr->height_in_pixels };
+	struct stat st;
+
+	journal_fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC
+			| (append ? O_APPEND : O_TRUNC), 0644);
+	if (journal_fd == -1 || fstat(journal_fd, &st) == -1) {
+		log_err("Couldn't create the journal %s. errno: %d", path, errno);
+		if (journal_fd != -1)
+			close(journal_fd);
+		journal_fd = -1;
+		return false;
+	}
+	buf_len = 0;
+	journal_enabled = true;
+	/* A journal that is being carried on already has a header. */
+	if (st.st_size == 0) {
+		memcpy(buf, JOURNAL_MAGIC, JOURNAL_MAGIC_LEN);
+		memcpy(buf + JOURNAL_MAGIC_LEN, &version, sizeof(version));
+		buf_len = JOURNAL_MAGIC_LEN + sizeof(version);
+		journal_put(JOURNAL_SCREEN, &js, sizeof(js));
+	}
+	since_loop = false;
+	log_info("%s a journal to %s", st.st_size ? "Appending" : "Recording", path);
+	return true;
+}
+
+/**
+ * @brief Record an X event that is about to be handled.
+ *
+ * @param ev The event.
+ */
+void journal_event(const xcb_generic_event_t *ev)
+{
+	if (journal_enabled)
+		journal_put(JOURNAL_EVENT, ev, JOURNAL_EVENT_SIZE);
+}
+
+/**
+ * @brief Record an IPC message that is about to be processed.
+ *
+ * @param msg The message, without the length of its frame.
+ * @param len The length of msg.
+ * @param binary Whether the message is in the binary format.
+ */
+void journal_ipc(const char *msg, uint32_t len, bool binary)
+{
+	if (journal_enabled)
+		journal_put(binary ? JOURNAL_BINARY : JOURNAL_TEXT, msg, len);
+}
+
+/**
+ * @brief Record that the main loop is about to do its deferred work.
+ *
+ * Nothing is recorded if nothing has happened since the last time, so an idle
+ * loop doesn't grow the journal.
+ */
+void journal_loop(void)
+{
+	if (journal_enabled && since_loop) {
+		journal_put(JOURNAL_LOOP, NULL, 0);
+		since_loop = false;
+	}
+}
+
+/**
+ * @brief Write whatever is buffered and stop recording.
+ */
+void journal_close(void)
+{
+	if (journal_fd == -1)
+		return;
+	journal_flush();
+	if (journal_fd != -1)
+		close(journal_fd);
+	journal_fd = -1;
+	journal_enabled = false;
+}
+
+/**
+ * @brief Read a journal and pass each of its records to a sink.
+ *
+ * @param path The journal.
+ * @param sink Called with each record.
+ * @param data Passed to sink.
+ *
+ * @return The number of records, or -1 if the journal couldn't be read or
+ * isn't valid. A journal that was cut short is replayed up to its last
+ * complete record.
+ */
+long journal_replay(const char *path, journal_sink sink, void *data)
+{
+	struct journal_rec rec;
+	struct stat st;
+	uint32_t version;
+	size_t off = 0, size;
+	ssize_t n;
+	long cnt = 0;
+	char *j;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if (fd == -1 || fstat(fd, &st) == -1) {
+		log_err("Couldn't open the journal %s. errno: %d", path, errno);
+		if (fd != -1)
+			close(fd);
+		return -1;
+	}
+	size = st.st_size;
+	j = malloc(size ? size : 1);
+	while (j && off < size) {
+		n = read(fd, j + off, size - off);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		off += n;
+	}
+	close(fd);
+	if (!j || off < size) {
+		log_err("Couldn't read the journal %s.", path);
+		free(j);
+		return -1;
+	}
+
+	if (size >= JOURNAL_MAGIC_LEN + sizeof(version))
+		memcpy(&version, j + JOURNAL_MAGIC_LEN, sizeof(version));
+	if (size < JOURNAL_MAGIC_LEN + sizeof(version)
+			|| memcmp(j, JOURNAL_MAGIC, JOURNAL_MAGIC_LEN) != 0
+			|| version != JOURNAL_VERSION) {
+		log_err("%s isn't a version %d journal.", path, JOURNAL_VERSION);
+		free(j);
+		return -1;
+	}
+
+	for (off = JOURNAL_MAGIC_LEN + sizeof(version);
+			size - off >= sizeof(rec); off += rec.len, cnt++) {
+		memcpy(&rec, j + off, sizeof(rec));
+		off += sizeof(rec);
+		if (rec.len > size - off)
+			break;
+		sink(&rec, j + off, data);
+	}
+
+	free(j);
+	return cnt;
+}
+
+/**
+ * @brief Append a record to the journal.
+ *
+ * @param type The type of the record.
+ * @param data The record's data.
+ * @param len The length of data.
+ */
+static void journal_put(enum journal_type type, const void *data, uint32_t len)
+{
+	struct journal_rec rec = { .type = type, .len = len };
+
+	if (buf_len + sizeof(rec) + len > sizeof(buf))
+		journal_flush();
+	if (journal_fd == -1)
+		return;
+	memcpy(buf + buf_len, &rec, sizeof(rec));
+	buf_len += sizeof(rec);
+	since_loop = type != JOURNAL_LOOP;
+
+	/* A record that doesn't fit in the buffer is written straight away. */
+	if (buf_len + len > sizeof(buf)) {
+		journal_flush();
+		if (journal_fd != -1 && !journal_write(data, len))
+			journal_close();
+		return;
+	}
+	if (len)
+		memcpy(buf + buf_len, data, len);
+	buf_len += len;
+}
+
+/**
+ * @brief Write all of some data to the journal.
+ *
+ * @param data The data.
+ * @param len The length of data.
+ *
+ * @return False if the data couldn't be written.
+ */
+static bool journal_write(const void *data, size_t len)
+{
+	const char *p = data;
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(journal_fd, p, len);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1) {
+			log_err("Couldn't write to the journal, so it has been "
+					"stopped. errno: %d", errno);
+			return false;
+		}
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+/**
+ * @brief Write the buffered records to the journal, stopping it if that
+ * fails.
+ */
+static void journal_flush(void)
+{
+	bool ok = journal_write(buf, buf_len);
+
+	buf_len = 0;
+	if (!ok) {
+		close(journal_fd);
+		journal_fd = -1;
+		journal_enabled = false;
+	}
+}
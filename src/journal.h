@@ -0,0 +1,76 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+/**
+ * @file journal.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** The first bytes of a journal. */
+#define JOURNAL_MAGIC "howmjrnl"
+#define JOURNAL_MAGIC_LEN 8
+/** Incremented whenever the format of a journal changes. */
+#define JOURNAL_VERSION 1
+/** The size of a recorded X event. Core events are always this long. */
+#define JOURNAL_EVENT_SIZE 32
+
+/** The types of record in a journal. */
+enum journal_type { JOURNAL_EVENT = 1, JOURNAL_TEXT, JOURNAL_BINARY,
+	JOURNAL_LOOP, JOURNAL_SCREEN };
+
+/**
+ * @brief The header of a record, which is followed by len bytes of data.
+ * Everything is native endian.
+ *
+ * An event's data is the first JOURNAL_EVENT_SIZE bytes of the event. An IPC
+ * message's data is the message as it was framed, in the text or binary
+ * format. A JOURNAL_LOOP record has no data and marks the point at which the
+ * main loop did its deferred work, such as collecting the replies for mapped
+ * windows and arranging. A journal starts with a JOURNAL_SCREEN record, whose
+ * data is a struct journal_screen.
+ */
+struct journal_rec {
+	uint8_t type; /**< One of enum journal_type. */
+	uint8_t pad[3];
+	uint32_t len; /**< The length of the data that follows. */
+};
+
+/**
+ * @brief The screen that a journal was recorded on, so that events that refer
+ * to the root window can be recognised when it is replayed.
+ */
+struct journal_screen {
+	uint32_t root; /**< The root window. */
+	uint16_t width; /**< The width of the screen. */
+	uint16_t height; /**< The height of the screen. */
+};
+
+/**
+ * @brief Called with each record in a journal, in the order they were
+ * recorded.
+ *
+ * @param rec The record's header.
+ * @param buf The record's data, which the sink may modify. It isn't aligned.
+ * @param data The data that was passed to journal_replay.
+ */
+typedef void (*journal_sink)(const struct journal_rec *rec, char *buf, void *data);
+
+extern bool journal_enabled;
+
+bool journal_open(const char *path, const xcb_screen_t *scr, bool append);
+void journal_event(const xcb_generic_event_t *ev);
+void journal_ipc(const char *msg, uint32_t len, bool binary);
+void journal_loop(void);
+void journal_close(void);
+long journal_replay(const char *path, journal_sink sink, void *data);
+
+#endif
@@ -5,6 +5,7 @@
 #include "helper.h"
 #include "howm.h"
 #include "layout.h"
+#include "trace.h"
 #include "types.h"
 #include "xcb_help.h"
 
@@ -30,20 +31,58 @@ static void(*layout_handler[]) (monitor_t *m) = {
 	[VSTACK] = stack
 };
 
+const char *layout_names[] = {
+	[ZOOM] = "zoom",
+	[GRID] = "grid",
+	[HSTACK] = "hstack",
+	[VSTACK] = "vstack"
+};
+
 /**
- * @brief Call the appropriate layout handler for each layout.
+ * @brief Mark a monitor as needing to be arranged.
+ *
+ * The arrangement itself is deferred until the event queue and the IPC socket
+ * have been drained, so that any number of changes made whilst handling a
+ * batch of events only results in a single arrangement.
  *
  * @param m The monitor to be arranged.
  */
 void arrange_windows(monitor_t *m)
 {
-	if (!m->ws->head)
-		return;
-	log_debug("Arranging windows");
-	layout_handler[m->ws->head->next ? m->ws->layout : ZOOM](mon);
+	m->dirty |= DIRTY_LAYOUT;
 	howm_info();
 }
 
+/**
+ * @brief Perform the work that has been deferred for each monitor.
+ *
+ * Monitors that need arranging have the appropriate layout handler called
+ * and monitors that need restacking are restacked. This should be called
+ * once per iteration of the main loop, before the X connection is flushed.
+ */
+void arrange_dirty(void)
+{
+	monitor_t *m;
+	uint64_t t;
+	int l;
+
+	for (m = mon_head; m; m = m->next) {
+		if (m->dirty & DIRTY_LAYOUT && m->ws->head) {
+			log_debug("Arranging windows");
+			l = m->ws->head->next ? m->ws->layout : ZOOM;
+			t = trace_begin();
+			layout_handler[l](m);
+			trace_end(layout_names[l], "layout", t);
+		}
+		if (m->dirty & DIRTY_STACK) {
+			t = trace_begin();
+			restack_clients(m);
+			trace_end("restack_clients", "layout", t);
+		}
+		m->dirty = 0;
+	}
+}
+
 /**
  * @brief Arrange the windows into a grid layout.
  *
@@ -59,7 +98,7 @@ static void grid(monitor_t *m)
 	uint16_t col_h = m->rect.height - m->ws->bar_height;
 
 	if (n <= 1) {
-		zoom(mon);
+		zoom(m);
 		return;
 	}
 
@@ -87,7 +126,7 @@ static void grid(monitor_t *m)
 			col_cnt++;
 		}
 	}
-	draw_clients();
+	draw_clients(m);
 }
 
 /**
@@ -104,17 +143,14 @@ static void zoom(monitor_t *m)
 
 	log_info("Arranging clients in zoom format");
 	/* When zoom is called because there aren't enough clients for other
-	 * layouts to work, draw a border to be consistent with other layouts.
-	 * */
-	if (m->ws->layout != ZOOM && !m->ws->head->is_fullscreen)
-		set_border_width(m->ws->head->win, conf.border_px);
-
+	 * layouts to work, draw_clients() will give the client a border to be
+	 * consistent with other layouts. */
 	for (c = m->ws->head; c; c = c->next)
 		if (!FFT(c))
 			change_client_geom(c, m->rect.x, conf.bar_bottom
 					? m->rect.y : m->rect.y + m->ws->bar_height,
 					m->rect.width, m->rect.height - m->ws->bar_height);
-	draw_clients();
+	draw_clients(m);
 }
 
 /**
@@ -156,7 +192,7 @@ static void stack(monitor_t *m)
 	uint16_t span = vert ? h : w;
 
 	if (n <= 1) {
-		zoom(mon);
+		zoom(m);
 		return;
 	}
 
@@ -187,7 +223,7 @@ static void stack(monitor_t *m)
 			client_x += client_span;
 		}
 	}
-	draw_clients();
+	draw_clients(m);
 }
 
 /**
@@ -14,8 +14,12 @@
  */
 
 enum layouts { ZOOM, GRID, HSTACK, VSTACK, END_LAYOUT };
+enum dirty { DIRTY_LAYOUT = 1 << 0, DIRTY_STACK = 1 << 1 };
+
+extern const char *layout_names[END_LAYOUT];
 
 void arrange_windows(monitor_t *m);
+void arrange_dirty(void);
 void change_layout(monitor_t *m, const int layout);
 void next_layout(monitor_t *m);
 void prev_layout(monitor_t *m);
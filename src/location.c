@@ -1,3 +1,7 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "helper.h"
 #include "howm.h"
 #include "location.h"
 
@@ -11,32 +15,217 @@
  * @brief howm
  */
 
+/** The size of the index when it is first allocated. Must be a power of two. */
+#define LOC_INDEX_MIN_BITS 6
+
+/**
+ * @brief A slot in the window index. A slot is empty when its window is
+ * XCB_NONE, as no client can ever own that window.
+ */
+struct loc_entry {
+	xcb_window_t win; /**< The window that is used as the key. */
+	location_t loc; /**< Where the client that owns win lives. */
+};
+
+static struct loc_entry *loc_table;
+static unsigned int loc_bits;
+static unsigned int loc_cnt;
+
+static unsigned int loc_hash(xcb_window_t win);
+static struct loc_entry *loc_find(xcb_window_t win);
+static void loc_index_grow(void);
+
 /**
- * @brief Search all workspaces on all monitors for a window, populating
- * r_loc upon success.
+ * @brief Hash a window into a slot in the window index.
  *
- * @param r_loc Will be populated upon finding the window.
- * @param win A valid XCB window that is used when searching all clients.
- * across all desktops.
+ * Window IDs are handed out sequentially by the X server, so Fibonacci
+ * hashing is used to spread them across the table.
  *
- * @return True upon finding the window, False otherwise.
+ * @param win The window to be hashed.
+ *
+ * @return The index of the first slot to probe.
  */
-bool loc_win(location_t *r_loc, xcb_window_t win)
+static inline unsigned int loc_hash(xcb_window_t win)
+{
+	return (uint32_t)(win * 2654435769u) >> (32 - loc_bits);
+}
+
+/**
+ * @brief Find the slot holding a window.
+ *
+ * @param win The window to search for.
+ *
+ * @return The slot that holds win, or NULL if it isn't in the index.
+ */
+static struct loc_entry *loc_find(xcb_window_t win)
+{
+	unsigned int mask = (1u << loc_bits) - 1;
+	unsigned int i;
+
+	if (!loc_table || win == XCB_NONE)
+		return NULL;
+
+	for (i = loc_hash(win); loc_table[i].win != XCB_NONE; i = (i + 1) & mask)
+		if (loc_table[i].win == win)
+			return &loc_table[i];
+	return NULL;
+}
+
+/**
+ * @brief Double the size of the window index and rehash every entry.
+ */
+static void loc_index_grow(void)
+{
+	struct loc_entry *old = loc_table;
+	unsigned int old_size = old ? 1u << loc_bits : 0;
+	unsigned int i;
+
+	loc_bits = old ? loc_bits + 1 : LOC_INDEX_MIN_BITS;
+	loc_table = calloc(1u << loc_bits, sizeof(struct loc_entry));
+	if (!loc_table) {
+		log_err("Can't allocate memory for the window index.");
+		exit(EXIT_FAILURE);
+	}
+
+	loc_cnt = 0;
+	for (i = 0; i < old_size; i++)
+		if (old[i].win != XCB_NONE)
+			loc_index_add(old[i].loc.mon, old[i].loc.ws, old[i].loc.c);
+	free(old);
+}
+
+/**
+ * @brief Record where a client lives in the window index.
+ *
+ * If the client's window is already indexed, its location is updated. This
+ * must be called whenever a client is inserted into a workspace's client
+ * list, including when it is moved from one workspace to another.
+ *
+ * @param m The monitor that the client is on.
+ * @param ws The workspace that the client is on.
+ * @param c The client to be indexed.
+ */
+void loc_index_add(monitor_t *m, workspace_t *ws, client_t *c)
+{
+	struct loc_entry *e = loc_find(c->win);
+	unsigned int mask, i;
+
+	if (e) {
+		e->loc = (location_t) { m, ws, c };
+		return;
+	}
+
+	/* Keep the load factor below a half so that probes stay short. */
+	if (!loc_table || (loc_cnt + 1) * 2 > (1u << loc_bits))
+		loc_index_grow();
+
+	mask = (1u << loc_bits) - 1;
+	for (i = loc_hash(c->win); loc_table[i].win != XCB_NONE; i = (i + 1) & mask)
+		;
+	loc_table[i].win = c->win;
+	loc_table[i].loc = (location_t) { m, ws, c };
+	loc_cnt++;
+}
+
+/**
+ * @brief Remove a window from the window index.
+ *
+ * This must be called whenever a client is taken out of a workspace's client
+ * list, such as when it is freed, cut or sent to the scratchpad.
+ *
+ * @param win The window to be removed.
+ */
+void loc_index_remove(xcb_window_t win)
+{
+	struct loc_entry *e = loc_find(win);
+	unsigned int mask = (1u << loc_bits) - 1;
+	unsigned int hole, i, home;
+
+	if (!e)
+		return;
+
+	/* Shift any later entries in the probe sequence back into the hole so
+	 * that lookups never need tombstones. */
+	hole = e - loc_table;
+	for (i = (hole + 1) & mask; loc_table[i].win != XCB_NONE; i = (i + 1) & mask) {
+		home = loc_hash(loc_table[i].win);
+		if (((i - home) & mask) >= ((i - hole) & mask)) {
+			loc_table[hole] = loc_table[i];
+			hole = i;
+		}
+	}
+	memset(&loc_table[hole], 0, sizeof(struct loc_entry));
+	loc_cnt--;
+}
+
+/**
+ * @brief Free the window index.
+ */
+void loc_index_free(void)
+{
+	free(loc_table);
+	loc_table = NULL;
+	loc_bits = loc_cnt = 0;
+}
+
+#ifndef NDEBUG
+/**
+ * @brief Check that the window index agrees with the client lists.
+ *
+ * Every client on every workspace must be indexed with the correct location
+ * and nothing else may be in the index. Any differences are logged.
+ *
+ * @return True if the index and the client lists agree.
+ */
+bool loc_index_check(void)
 {
 	monitor_t *m;
 	workspace_t *ws;
 	client_t *c;
+	struct loc_entry *e;
+	unsigned int n = 0;
+	bool ok = true;
 
 	for (m = mon_head; m; m = m->next)
 		for (ws = m->ws_head; ws; ws = ws->next)
-			for (c = ws->head; c; c = c->next)
-				if (win == c->win) {
-					r_loc->mon = m;
-					r_loc->ws = ws;
-					r_loc->c = c;
-					return true;
+			for (c = ws->head; c; c = c->next, n++) {
+				e = loc_find(c->win);
+				if (!e) {
+					log_err("Window <0x%x> of client <%p> is missing from the index", c->win, c);
+					ok = false;
+				} else if (e->loc.mon != m || e->loc.ws != ws || e->loc.c != c) {
+					log_err("Window <0x%x> is indexed as <%p, %p, %p> but is at <%p, %p, %p>",
+							c->win, e->loc.mon, e->loc.ws, e->loc.c, m, ws, c);
+					ok = false;
 				}
-	return false;
+			}
+
+	if (n != loc_cnt) {
+		log_err("The index holds %u windows, but there are %u clients", loc_cnt, n);
+		ok = false;
+	}
+	return ok;
+}
+#endif
+
+/**
+ * @brief Look up a window in the window index, populating r_loc upon
+ * success.
+ *
+ * @param r_loc Will be populated upon finding the window.
+ * @param win A valid XCB window that is used when searching all clients.
+ * across all desktops.
+ *
+ * @return True upon finding the window, False otherwise.
+ */
+bool loc_win(location_t *r_loc, xcb_window_t win)
+{
+	struct loc_entry *e = loc_find(win);
+
+	if (!e)
+		return false;
+	*r_loc = e->loc;
+	return true;
 }
 
 /**
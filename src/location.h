@@ -1,6 +1,7 @@
 #ifndef LOCATION_H
 #define LOCATION_H
 
+#include <stdbool.h>
 #include <xcb/xcb.h>
 
 #include "types.h"
@@ -17,5 +18,11 @@
 
 bool loc_win(location_t *loc, xcb_window_t w);
 bool loc_client(location_t *loc, client_t *c);
+void loc_index_add(monitor_t *m, workspace_t *ws, client_t *c);
+void loc_index_remove(xcb_window_t win);
+void loc_index_free(void);
+#ifndef NDEBUG
+bool loc_index_check(void);
+#endif
 
 #endif
@@ -0,0 +1,385 @@
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "helper.h"
+#include "log.h"
+
+/**
+ * @file log.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief A ring buffer that records log messages without formatting them.
+ *
+ * Formatting a message costs far more than recording it, so each entry only
+ * holds the message's site and a copy of its args. Entries are formatted when
+ * the ring buffer is dumped, which happens when it is queried over IPC or
+ * when howm crashes.
+ *
+ * The writer fills the slot after the newest entry and only then publishes
+ * it. A dump skips that slot, so a crash that interrupts the writer doesn't
+ * dump the entry that it was part way through, nor the oldest entry that it
+ * was overwriting.
+ *
+ * Dumping on a crash is best-effort: entries are formatted with snprintf,
+ * which isn't async-signal-safe, so a crash inside the C library's own
+ * formatting or locale code may not produce a dump.
+ */
+
+/** How many entries the ring buffer holds. Must be a power of two. */
+#define LOG_RING_SIZE 1024
+/** The room in an entry for the values of its args. */
+#define LOG_ARGS_SIZE 47
+/** The longest formatted message in a dump. */
+#define LOG_LINE_SIZE 512
+
+/** The types of arg that a message can record. */
+enum log_arg { LOG_ARG_INT, LOG_ARG_LONG, LOG_ARG_DOUBLE, LOG_ARG_PTR,
+	LOG_ARG_STR };
+
+/**
+ * @brief A message in the ring buffer. Its args are packed one after the
+ * other, with strings stored inline and null terminated.
+ */
+struct log_entry {
+	const struct log_site *site;
+	uint64_t time; /**< CLOCK_MONOTONIC, in nanoseconds. */
+	uint8_t argc; /**< How many args fitted in args. */
+	char args[LOG_ARGS_SIZE];
+};
+
+uint16_t log_level = LOG_WARN;
+uint16_t log_ring_level = LOG_DEBUG;
+
+static struct log_entry ring[LOG_RING_SIZE];
+/** The number of entries that have ever been written. */
+static uint64_t ring_head;
+
+static const char *level_names[] = {"", "DEBUG", "INFO", "WARN", "ERROR"};
+static const int crash_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+static void log_parse(struct log_site *site);
+static size_t log_format(const struct log_entry *e, char *buf, size_t size);
+static void log_crash(int sig);
+static void log_crash_sink(const char *buf, size_t len, void *data);
+
+/**
+ * @brief Dump the ring buffer to stderr if howm crashes.
+ */
+void log_init(void)
+{
+	struct sigaction sa;
+	unsigned int i;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = log_crash;
+	sa.sa_flags = SA_RESETHAND;
+	sigemptyset(&sa.sa_mask);
+	for (i = 0; i < LENGTH(crash_signals); i++)
+		sigaction(crash_signals[i], &sa, NULL);
+}
+
+/**
+ * @brief Record a message in the ring buffer, without formatting it.
+ *
+ * This should only be called through the log macros.
+ *
+ * @param site Where the message was logged from.
+ */
+void log_record(struct log_site *site, ...)
+{
+	struct log_entry *e = &ring[ring_head & (LOG_RING_SIZE - 1)];
+	struct timespec ts;
+	size_t off = 0, n;
+	const char *s;
+	va_list ap;
+	int i_val;
+	long l_val;
+	double d_val;
+	void *p_val;
+
+	if (!site->parsed)
+		log_parse(site);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	e->site = site;
+	e->time = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+	va_start(ap, site);
+	for (e->argc = 0; e->argc < site->argc; e->argc++) {
+		switch (site->types[e->argc]) {
+		case LOG_ARG_INT:
+			i_val = va_arg(ap, int);
+			if (off + sizeof(i_val) > sizeof(e->args))
+				goto full;
+			memcpy(e->args + off, &i_val, sizeof(i_val));
+			off += sizeof(i_val);
+			break;
+		case LOG_ARG_LONG:
+			l_val = va_arg(ap, long);
+			if (off + sizeof(l_val) > sizeof(e->args))
+				goto full;
+			memcpy(e->args + off, &l_val, sizeof(l_val));
+			off += sizeof(l_val);
+			break;
+		case LOG_ARG_DOUBLE:
+			d_val = va_arg(ap, double);
+			if (off + sizeof(d_val) > sizeof(e->args))
+				goto full;
+			memcpy(e->args + off, &d_val, sizeof(d_val));
+			off += sizeof(d_val);
+			break;
+		case LOG_ARG_PTR:
+			p_val = va_arg(ap, void *);
+			if (off + sizeof(p_val) > sizeof(e->args))
+				goto full;
+			memcpy(e->args + off, &p_val, sizeof(p_val));
+			off += sizeof(p_val);
+			break;
+		case LOG_ARG_STR:
+			s = va_arg(ap, const char *);
+			if (!s)
+				s = "(null)";
+			if (off == sizeof(e->args))
+				goto full;
+			/* Strings are truncated to fit, rather than dropped. */
+			n = strnlen(s, sizeof(e->args) - off - 1);
+			memcpy(e->args + off, s, n);
+			e->args[off + n] = '\0';
+			off += n + 1;
+			break;
+		}
+	}
+full:
+	va_end(ap);
+
+	__atomic_store_n(&ring_head, ring_head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Format every message in the ring buffer, oldest first.
+ *
+ * Once the ring buffer has wrapped, the oldest slot is the one that
+ * log_record writes next, so it is skipped in case a write is in progress.
+ *
+ * @param sink Called with each formatted line.
+ * @param data Passed to sink.
+ */
+void log_dump(log_sink sink, void *data)
+{
+	uint64_t from = 0;
+
+	log_dump_range(&from, log_count(), LOG_RING_SIZE, sink, data);
+}
+
+/**
+ * @brief Format some of the messages in the ring buffer, oldest first, so
+ * that it can be dumped a part at a time.
+ *
+ * Messages that have been overwritten since from was set are skipped, as is
+ * the slot that log_record writes next.
+ *
+ * @param from The first message to format, which is advanced past the
+ * messages that were formatted.
+ * @param to The message after the last one to format.
+ * @param max The most messages to format.
+ * @param sink Called with each formatted line.
+ * @param data Passed to sink.
+ */
+void log_dump_range(uint64_t *from, uint64_t to, unsigned int max,
+		log_sink sink, void *data)
+{
+	uint64_t head = log_count();
+	char line[LOG_LINE_SIZE];
+	size_t len;
+
+	if (head >= LOG_RING_SIZE && *from < head - LOG_RING_SIZE + 1)
+		*from = head - LOG_RING_SIZE + 1;
+	for (; *from < to && max > 0; (*from)++, max--) {
+		len = log_format(&ring[*from & (LOG_RING_SIZE - 1)], line,
+				sizeof(line));
+		sink(line, len, data);
+	}
+}
+
+/**
+ * @brief Get the number of messages that have ever been recorded.
+ *
+ * @return The number of messages, which is one more than the newest
+ * message's position for log_dump_range.
+ */
+uint64_t log_count(void)
+{
+	return __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Work out the number and types of a site's args from its format.
+ *
+ * Parsing stops at a conversion that isn't understood, so the args after it
+ * aren't recorded.
+ *
+ * @param site The site to parse.
+ */
+static void log_parse(struct log_site *site)
+{
+	const char *f = site->fmt;
+	bool is_long;
+
+	site->parsed = true;
+	site->argc = 0;
+
+	while ((f = strchr(f, '%')) && site->argc < LOG_MAX_ARGS) {
+		f++;
+		if (*f == '%') {
+			f++;
+			continue;
+		}
+		f += strspn(f, "-+ #0123456789.");
+		is_long = *f == 'l' || *f == 'z';
+		f += strspn(f, "hlzj");
+
+		switch (*f) {
+		case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+			site->types[site->argc++] = is_long ? LOG_ARG_LONG : LOG_ARG_INT;
+			break;
+		case 'f': case 'g': case 'e':
+			site->types[site->argc++] = LOG_ARG_DOUBLE;
+			break;
+		case 'p':
+			site->types[site->argc++] = LOG_ARG_PTR;
+			break;
+		case 's':
+			site->types[site->argc++] = LOG_ARG_STR;
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Format an entry of the ring buffer as a line of text.
+ *
+ * The format is split at each conversion, so that every arg can be passed to
+ * snprintf with its recorded type.
+ *
+ * @param e The entry to format.
+ * @param buf Where the line is written.
+ * @param size The size of buf.
+ *
+ * @return The length of the line, including its newline.
+ */
+static size_t log_format(const struct log_entry *e, char *buf, size_t size)
+{
+	const struct log_site *site = e->site;
+	const char *f = site->fmt, *next;
+	char part[LOG_LINE_SIZE];
+	size_t len, off = 0;
+	unsigned int i;
+	int i_val;
+	long l_val;
+	double d_val;
+	void *p_val;
+
+	len = snprintf(buf, size, "[%s] %lu.%06lu (%s:%d) ",
+			level_names[site->level],
+			(unsigned long)(e->time / 1000000000),
+			(unsigned long)(e->time % 1000000000 / 1000),
+			site->file, site->line);
+
+	for (i = 0; i < e->argc && len < size; i++) {
+		/* Copy up to the end of the next conversion. */
+		next = f;
+		while ((next = strchr(next, '%')) && next[1] == '%')
+			next += 2;
+		next += 1 + strspn(next + 1, "-+ #0123456789.hlzj") + 1;
+		snprintf(part, sizeof(part), "%.*s", (int)(next - f), f);
+		f = next;
+
+		switch (site->types[i]) {
+		case LOG_ARG_INT:
+			memcpy(&i_val, e->args + off, sizeof(i_val));
+			off += sizeof(i_val);
+			len += snprintf(buf + len, size - len, part, i_val);
+			break;
+		case LOG_ARG_LONG:
+			memcpy(&l_val, e->args + off, sizeof(l_val));
+			off += sizeof(l_val);
+			len += snprintf(buf + len, size - len, part, l_val);
+			break;
+		case LOG_ARG_DOUBLE:
+			memcpy(&d_val, e->args + off, sizeof(d_val));
+			off += sizeof(d_val);
+			len += snprintf(buf + len, size - len, part, d_val);
+			break;
+		case LOG_ARG_PTR:
+			memcpy(&p_val, e->args + off, sizeof(p_val));
+			off += sizeof(p_val);
+			len += snprintf(buf + len, size - len, part, p_val);
+			break;
+		case LOG_ARG_STR:
+			len += snprintf(buf + len, size - len, part, e->args + off);
+			off += strlen(e->args + off) + 1;
+			break;
+		}
+	}
+
+	/* Anything left over, including conversions whose args didn't fit, is
+	 * copied as it is, apart from escaped percent signs. */
+	for (; *f && len < size - 2; f++, len++) {
+		buf[len] = *f;
+		if (f[0] == '%' && f[1] == '%')
+			f++;
+	}
+	if (len > size - 2)
+		len = size - 2;
+	buf[len++] = '\n';
+	buf[len] = '\0';
+	return len;
+}
+
+/**
+ * @brief Dump the ring buffer to stderr when howm crashes, then let the
+ * signal kill howm as it normally would.
+ *
+ * This is best-effort, as log_format uses snprintf. The handler is reset
+ * before it runs, so a second crash while dumping just kills howm.
+ *
+ * @param sig The signal that howm received.
+ */
+static void log_crash(int sig)
+{
+	static const char msg[] = "howm crashed, recent log messages:\n";
+
+	if (write(STDERR_FILENO, msg, sizeof(msg) - 1) == -1)
+		_exit(EXIT_FAILURE);
+	log_dump(log_crash_sink, NULL);
+	raise(sig);
+}
+
+/**
+ * @brief Write a line of the ring buffer to stderr.
+ *
+ * @param buf The line.
+ * @param len The length of buf.
+ * @param data Unused.
+ */
+static void log_crash_sink(const char *buf, size_t len, void *data)
+{
+	UNUSED(data);
+
+	if (write(STDERR_FILENO, buf, len) == -1)
+		return;
+}
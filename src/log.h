@@ -0,0 +1,116 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @file log.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** The most detail that can be logged. A LOG_LEVEL of INFO will compile in
+ * almost everything, LOG_WARN will compile in warnings and errors and LOG_ERR
+ * will compile in only errors.
+ *
+ * LOG_NONE means nothing will be logged.
+ *
+ * LOG_DEBUG should be used by developers. How much of what is compiled in
+ * actually gets logged is chosen at runtime with log_level and
+ * log_ring_level.
+ */
+#define LOG_LEVEL LOG_DEBUG
+
+#define LOG_DEBUG 1
+#define LOG_INFO 2
+#define LOG_WARN 3
+#define LOG_ERR 4
+#define LOG_NONE 5
+
+/** The most args that a log message can record in the ring buffer. */
+#define LOG_MAX_ARGS 8
+
+/**
+ * @brief A place in the code that logs a message.
+ *
+ * Each call to one of the log macros has its own site, which identifies the
+ * message in the ring buffer. The types of its args are worked out from the
+ * format string the first time that it is recorded.
+ */
+struct log_site {
+	int level; /**< LOG_DEBUG, LOG_INFO, LOG_WARN or LOG_ERR. */
+	const char *fmt; /**< The printf style format of the message. */
+	const char *file;
+	int line;
+	bool parsed; /**< Have argc and types been worked out yet? */
+	uint8_t argc; /**< How many args the message takes. */
+	uint8_t types[LOG_MAX_ARGS]; /**< The type of each arg. */
+};
+
+/**
+ * @brief Called with each part of the ring buffer as it is formatted.
+ *
+ * @param buf The text, which isn't null terminated.
+ * @param len The length of buf.
+ * @param data The data that was passed to log_dump.
+ */
+typedef void (*log_sink)(const char *buf, size_t len, void *data);
+
+extern uint16_t log_level;
+extern uint16_t log_ring_level;
+
+void log_init(void);
+void log_record(struct log_site *site, ...);
+void log_dump(log_sink sink, void *data);
+void log_dump_range(uint64_t *from, uint64_t to, unsigned int max,
+		log_sink sink, void *data);
+uint64_t log_count(void);
+
+/* Add comments so that splint ignores this as it doesn't support variadic
+ * macros.
+ */
+/*@ignore@*/
+
+/* Messages at log_ring_level or above are recorded unformatted in the ring
+ * buffer, and those at log_level or above are also printed to stderr. */
+#define log_write(L, P, M, ...) do { \
+	static struct log_site log_site_ = { L, M, __FILE__, __LINE__, false, 0, {0} }; \
+	if (L >= log_ring_level) \
+		log_record(&log_site_, ##__VA_ARGS__); \
+	if (L >= log_level) \
+		fprintf(stderr, "[" P "] (%s:%d) " M "\n", __FILE__, __LINE__, ##__VA_ARGS__); \
+} while (0)
+
+#if LOG_LEVEL == LOG_DEBUG
+#define log_debug(M, ...) log_write(LOG_DEBUG, "DEBUG", M, ##__VA_ARGS__)
+#else
+#define log_debug(x, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_INFO
+#define log_info(M, ...) log_write(LOG_INFO, "INFO", M, ##__VA_ARGS__)
+#else
+#define log_info(x, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_WARN
+#define log_warn(M, ...) log_write(LOG_WARN, "WARN", M, ##__VA_ARGS__)
+#else
+#define log_warn(x, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_ERR
+#define log_err(M, ...) log_write(LOG_ERR, "ERROR", M, ##__VA_ARGS__)
+#else
+#define log_err(x, ...) do {} while (0)
+#endif
+/*@end@*/
+
+#endif
@@ -4,6 +4,7 @@
 #include "monitor.h"
 #include "helper.h"
 #include "howm.h"
+#include "stats.h"
 #include "workspace.h"
 #include "xcb_help.h"
 
@@ -47,6 +48,7 @@ monitor_t *create_monitor(xcb_rectangle_t rect)
 			m->rect.width, m->rect.height);
 
 	mon_cnt++;
+	howm_info();
 
 	return m;
 }
@@ -82,6 +84,7 @@ void remove_monitor(monitor_t *m)
 	/* TODO: Maybe we'll need to refocus? */
 
 	free(m);
+	howm_info();
 }
 
 /**
@@ -101,10 +104,10 @@ void focus_monitor(monitor_t *m)
 	center_pointer(m->rect);
 
 	if (mon->ws && mon->ws->c)
-		xcb_set_input_focus(dpy, XCB_INPUT_FOCUS_POINTER_ROOT, mon->ws->c->win,
-			    XCB_CURRENT_TIME);
+		set_input_focus(mon->ws->c->win);
 
 	ewmh_set_current_workspace();
+	howm_info();
 }
 
 /**
@@ -178,6 +181,9 @@ static bool scan_xrandr_monitors(void)
 	for (i = 0; i < nr_outputs; i++)
 		cookies[i] = xcb_randr_get_output_info(dpy, outputs[i], XCB_CURRENT_TIME);
 
+	/* Only the first reply is waited for, the rest were pipelined. */
+	if (nr_outputs)
+		stats_round_trips++;
 	for (i = 0; i < nr_outputs; i++) {
 		oir = xcb_randr_get_output_info_reply(dpy, cookies[i], NULL);
 		if (!oir || oir->crtc == XCB_NONE) {
@@ -5,10 +5,12 @@
 #include "client.h"
 #include "helper.h"
 #include "howm.h"
+#include "location.h"
 #include "op.h"
 #include "scratchpad.h"
 #include "types.h"
 #include "workspace.h"
+#include "xcb_help.h"
 
 /**
  * @file op.c
@@ -190,10 +192,9 @@ static void change_gaps(const unsigned int type, unsigned int cnt, int size)
  */
 void op_cut(const unsigned int type, unsigned int cnt)
 {
-	client_t *tail = mon->ws->c;
 	client_t *head = mon->ws->c;
 	client_t *head_prev = prev_client(mon->ws->c, mon->ws);
-	bool wrap = false;
+	client_t *c, *n, *tail = NULL;
 
 	if (!head)
 		return;
@@ -208,35 +209,22 @@ void op_cut(const unsigned int type, unsigned int cnt)
 		return;
 
 	} else if (type == CLIENT) {
-		xcb_unmap_window(dpy, head->win);
-		mon->ws->client_cnt--;
-		while (cnt > 1) {
-			if (!tail->next && next_client(tail)) {
-				wrap = true;
-				/* Join the list into a circular linked list,
-				 * just for now so that we don't miss any
-				 * clients. */
-				tail->next = next_client(tail);
-			}
-			if (tail == mon->ws->prev_foc)
+		/* Walk forwards from the focused client, wrapping around the end
+		 * of the list, and move each client onto a list of its own. */
+		for (c = head; cnt > 0; c = n, cnt--) {
+			n = next_client(c);
+			detach_client(mon->ws, c);
+			unmap_window(c->win);
+			loc_index_remove(c->win);
+			if (c == mon->ws->prev_foc)
 				mon->ws->prev_foc = NULL;
-			tail = next_client(tail);
-			xcb_unmap_window(dpy, tail->win);
-			cnt--;
-			mon->ws->client_cnt--;
-		}
-
-		if (head == mon->ws->head) {
-			mon->ws->head = head == next_client(tail) ? NULL : next_client(tail);
-		} else if (wrap) {
-			mon->ws->head = tail->next;
-			head_prev->next = NULL;
-		} else if (tail->next != head_prev) {
-			head_prev->next = wrap ? NULL : tail->next;
+			c->prev = tail;
+			if (tail)
+				tail->next = c;
+			tail = c;
 		}
 
 		mon->ws->c = head_prev;
-		tail->next = NULL;
 		update_focused_client(head_prev);
 		stack_push(&del_reg, head);
 	}
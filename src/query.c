@@ -0,0 +1,450 @@
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "client.h"
+#include "helper.h"
+#include "howm.h"
+#include "layout.h"
+#include "monitor.h"
+#include "query.h"
+#include "stats.h"
+#include "trace.h"
+#include "types.h"
+
+/**
+ * @file query.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Serialise howm's monitors, workspaces, clients, stats and trace as
+ * JSON, or its recent log messages as text.
+ *
+ * Documents are written in chunks of at most QUERY_CHUNK_SIZE bytes, so that
+ * the whole document never has to be held in memory, however many clients
+ * there are. A cursor records where the document continues from, so that
+ * the next chunk is only written once the previous one has been sent.
+ */
+
+/** The most that a single call to query_printf can write. */
+#define QUERY_ITEM_SIZE 256
+
+struct query_out {
+	char buf[QUERY_CHUNK_SIZE];
+	size_t len;
+	query_sink sink;
+	void *data;
+	unsigned int flushes; /**< How many chunks have been passed to sink. */
+	struct query_cursor *q; /**< The cursor of the document. */
+};
+
+static const char *query_names[] = {"tree", "workspaces", "focused", "log",
+	"stats", "trace"};
+
+static void query_tree_next(struct query_cursor *q, struct query_out *out);
+static void query_printf(struct query_out *out, const char *fmt, ...);
+static void query_flush(struct query_out *out);
+static void query_log_line(const char *buf, size_t len, void *data);
+static void query_rect(struct query_out *out, const xcb_rectangle_t *r);
+static void query_monitor(struct query_out *out, const monitor_t *m,
+		unsigned int idx);
+static void query_workspace(struct query_out *out, const monitor_t *m,
+		const workspace_t *ws, unsigned int idx);
+static void query_client(struct query_out *out, const workspace_t *ws,
+		const client_t *c);
+static void query_trace_span(const struct trace_span *span, void *data);
+static void query_stats(struct query_out *out);
+static void query_hists(struct query_out *out, struct stats_hist **hists,
+		unsigned int n);
+
+/**
+ * @brief Find the type of query with the given name.
+ *
+ * @param name The name of the query, such as "tree".
+ *
+ * @return A value from enum query_type, or -1 if there is no such query.
+ */
+int query_from_name(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < LENGTH(query_names); i++)
+		if (strcmp(name, query_names[i]) == 0)
+			return i;
+	return -1;
+}
+
+/**
+ * @brief Start writing part of howm's state as a JSON document.
+ *
+ * QUERY_TREE is every monitor with its workspaces and their clients.
+ * QUERY_WORKSPACES is the same, without the clients. QUERY_FOCUSED is the
+ * focused client, or null. QUERY_LOG is the log's ring buffer, one message
+ * per line. QUERY_STATS is the latency histograms and X request counters.
+ * QUERY_TRACE is the recorded spans, in Chrome's trace event format.
+ *
+ * The log and trace end with the newest message or span at the time that the
+ * query starts, so that a document never grows as it is written.
+ *
+ * @param q The cursor to start, which is passed to query_next.
+ * @param type The document to write.
+ */
+void query_start(struct query_cursor *q, enum query_type type)
+{
+	memset(q, 0, sizeof(*q));
+	q->type = type;
+	q->stage = QUERY_STAGE_START;
+	q->first = true;
+	if (type == QUERY_LOG)
+		q->end = log_count();
+	else if (type == QUERY_TRACE)
+		q->end = trace_count();
+}
+
+/**
+ * @brief Write the next chunk of a document.
+ *
+ * Items are written until a chunk has been passed to the sink, so each call
+ * writes about QUERY_CHUNK_SIZE bytes, however large the document is. If
+ * howm's state changes between calls, the document describes a mix of the
+ * old and new state, but it is always valid JSON.
+ *
+ * @param q The cursor, from query_start.
+ * @param sink Called with each chunk of the document, in order.
+ * @param data Passed to sink.
+ *
+ * @return True once the whole document has been written.
+ */
+bool query_next(struct query_cursor *q, query_sink sink, void *data)
+{
+	struct query_out out = { .len = 0, .sink = sink, .data = data,
+		.flushes = 0, .q = q };
+
+	if (q->type == QUERY_TREE || q->type == QUERY_WORKSPACES) {
+		query_tree_next(q, &out);
+	} else if (q->type == QUERY_LOG) {
+		while (q->seq < q->end && out.flushes == 0)
+			log_dump_range(&q->seq, q->end, 1, query_log_line, &out);
+		q->stage = q->seq < q->end ? QUERY_STAGE_ENTRIES : QUERY_STAGE_DONE;
+	} else if (q->type == QUERY_TRACE) {
+		if (q->stage == QUERY_STAGE_START)
+			query_printf(&out, "{\"traceEvents\":[");
+		while (q->seq < q->end && out.flushes == 0)
+			trace_dump(&q->seq, q->end, 1, query_trace_span, &out);
+		q->stage = QUERY_STAGE_ENTRIES;
+		if (q->seq >= q->end) {
+			query_printf(&out, "]}");
+			q->stage = QUERY_STAGE_DONE;
+		}
+	} else if (q->type == QUERY_STATS) {
+		query_stats(&out);
+		q->stage = QUERY_STAGE_DONE;
+	} else {
+		if (mon && mon->ws && mon->ws->c)
+			query_client(&out, mon->ws, mon->ws->c);
+		else
+			query_printf(&out, "null");
+		q->stage = QUERY_STAGE_DONE;
+	}
+	query_flush(&out);
+	return q->stage == QUERY_STAGE_DONE;
+}
+
+/**
+ * @brief Write the next chunk of a tree or workspaces document.
+ *
+ * The monitor, workspace and client that the cursor is at are looked up
+ * once, then followed from item to item. A monitor, workspace or client that
+ * has been removed since the last chunk ends its array early.
+ *
+ * @param q The cursor.
+ * @param out The document being written.
+ */
+static void query_tree_next(struct query_cursor *q, struct query_out *out)
+{
+	const monitor_t *m;
+	const workspace_t *ws = NULL;
+	const client_t *c = NULL;
+	uint32_t i;
+
+	for (m = mon_head, i = 0; m && i < q->mon; i++)
+		m = m->next;
+	if (m)
+		for (ws = m->ws_head, i = 0; ws && i < q->ws; i++)
+			ws = ws->next;
+	if (ws)
+		for (c = ws->head, i = 0; c && i < q->client; i++)
+			c = c->next;
+
+	while (q->stage != QUERY_STAGE_DONE && out->flushes == 0) {
+		switch (q->stage) {
+		case QUERY_STAGE_START:
+			query_printf(out, "{\"focused_monitor\":%u,\"monitors\":[",
+					mon ? monitor_to_index(mon) : 0);
+			q->stage = QUERY_STAGE_MONITOR;
+			break;
+		case QUERY_STAGE_MONITOR:
+			if (!m) {
+				query_printf(out, "]}");
+				q->stage = QUERY_STAGE_DONE;
+				break;
+			}
+			if (q->mon)
+				query_printf(out, ",");
+			query_monitor(out, m, q->mon);
+			ws = m->ws_head;
+			q->ws = 0;
+			q->stage = QUERY_STAGE_WORKSPACE;
+			break;
+		case QUERY_STAGE_WORKSPACE:
+			if (!ws) {
+				query_printf(out, "]}");
+				m = m ? m->next : NULL;
+				q->mon++;
+				q->stage = QUERY_STAGE_MONITOR;
+				break;
+			}
+			if (q->ws)
+				query_printf(out, ",");
+			query_workspace(out, m, ws, q->ws + 1);
+			if (q->type == QUERY_TREE) {
+				query_printf(out, ",\"clients\":[");
+				c = ws->head;
+				q->client = 0;
+				q->stage = QUERY_STAGE_CLIENT;
+				break;
+			}
+			query_printf(out, "}");
+			ws = ws->next;
+			q->ws++;
+			break;
+		case QUERY_STAGE_CLIENT:
+			if (!c) {
+				query_printf(out, "]}");
+				ws = ws ? ws->next : NULL;
+				q->ws++;
+				q->stage = QUERY_STAGE_WORKSPACE;
+				break;
+			}
+			if (q->client)
+				query_printf(out, ",");
+			query_client(out, ws, c);
+			c = c->next;
+			q->client++;
+			break;
+		default:
+			q->stage = QUERY_STAGE_DONE;
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Append formatted text to a document, passing the buffered chunk to
+ * the sink first if the text may not fit.
+ *
+ * The formatted text must be shorter than QUERY_ITEM_SIZE.
+ *
+ * @param out The document being written.
+ * @param fmt A printf style format string.
+ */
+static void query_printf(struct query_out *out, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	if (sizeof(out->buf) - out->len < QUERY_ITEM_SIZE)
+		query_flush(out);
+
+	va_start(ap, fmt);
+	n = vsnprintf(out->buf + out->len, QUERY_ITEM_SIZE, fmt, ap);
+	va_end(ap);
+	if (n >= QUERY_ITEM_SIZE)
+		log_warn("Truncated an item of a query");
+	out->len += n < QUERY_ITEM_SIZE ? n : QUERY_ITEM_SIZE - 1;
+}
+
+/**
+ * @brief Pass the buffered part of a document to the sink.
+ *
+ * @param out The document being written.
+ */
+static void query_flush(struct query_out *out)
+{
+	if (out->len == 0)
+		return;
+	out->sink(out->buf, out->len, out->data);
+	out->len = 0;
+	out->flushes++;
+}
+
+/**
+ * @brief Append a line of the log to a document.
+ *
+ * @param buf The line, which is shorter than QUERY_CHUNK_SIZE.
+ * @param len The length of buf.
+ * @param data The document being written.
+ */
+static void query_log_line(const char *buf, size_t len, void *data)
+{
+	struct query_out *out = data;
+
+	if (sizeof(out->buf) - out->len < len)
+		query_flush(out);
+	memcpy(out->buf + out->len, buf, len);
+	out->len += len;
+}
+
+/**
+ * @brief Write a rectangle as a JSON object.
+ *
+ * @param out The document being written.
+ * @param r The rectangle to write.
+ */
+static void query_rect(struct query_out *out, const xcb_rectangle_t *r)
+{
+	query_printf(out, "{\"x\":%d,\"y\":%d,\"width\":%u,\"height\":%u}",
+			r->x, r->y, r->width, r->height);
+}
+
+/**
+ * @brief Write the start of a monitor's JSON object, up to the opening of
+ * its array of workspaces.
+ *
+ * @param out The document being written.
+ * @param m The monitor to write.
+ * @param idx The index of the monitor.
+ */
+static void query_monitor(struct query_out *out, const monitor_t *m,
+		unsigned int idx)
+{
+	query_printf(out, "{\"index\":%u,\"focused\":%s,\"output\":%u,\"rect\":",
+			idx, m == mon ? "true" : "false", m->output);
+	query_rect(out, &m->rect);
+	query_printf(out, ",\"workspaces\":[");
+}
+
+/**
+ * @brief Write the start of a workspace's JSON object, leaving it open so
+ * that its clients can follow.
+ *
+ * @param out The document being written.
+ * @param m The monitor that the workspace is on.
+ * @param ws The workspace to write.
+ * @param idx The index of the workspace, starting at 1.
+ */
+static void query_workspace(struct query_out *out, const monitor_t *m,
+		const workspace_t *ws, unsigned int idx)
+{
+	query_printf(out, "{\"index\":%u,\"focused\":%s,\"layout\":\"%s\","
+			"\"gap\":%u,\"master_ratio\":%.2f,\"bar_height\":%u,"
+			"\"client_cnt\":%u", idx, ws == m->ws ? "true" : "false",
+			ws->layout >= 0 && ws->layout < END_LAYOUT
+				? layout_names[ws->layout] : "unknown",
+			ws->gap, ws->master_ratio, ws->bar_height, ws->client_cnt);
+}
+
+/**
+ * @brief Write a client as a JSON object.
+ *
+ * @param out The document being written.
+ * @param ws The workspace that the client is on.
+ * @param c The client to write.
+ */
+static void query_client(struct query_out *out, const workspace_t *ws,
+		const client_t *c)
+{
+	query_printf(out, "{\"window\":%u,\"focused\":%s,\"floating\":%s,"
+			"\"fullscreen\":%s,\"transient\":%s,\"urgent\":%s,"
+			"\"gap\":%u,\"rect\":", c->win,
+			c == ws->c ? "true" : "false",
+			c->is_floating ? "true" : "false",
+			c->is_fullscreen ? "true" : "false",
+			c->is_transient ? "true" : "false",
+			c->is_urgent ? "true" : "false", c->gap);
+	query_rect(out, &c->rect);
+	query_printf(out, "}");
+}
+
+/**
+ * @brief Write a span as a complete event in Chrome's trace event format.
+ *
+ * Times are in microseconds, with nanosecond precision.
+ *
+ * @param span The span.
+ * @param data The document being written.
+ */
+static void query_trace_span(const struct trace_span *span, void *data)
+{
+	struct query_out *out = data;
+
+	query_printf(out, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+			"\"ts\":%llu.%03u,\"dur\":%llu.%03u,\"pid\":1,\"tid\":1}",
+			out->q->first ? "" : ",", span->name, span->cat,
+			(unsigned long long)(span->start / 1000),
+			(unsigned int)(span->start % 1000),
+			(unsigned long long)(span->dur / 1000),
+			(unsigned int)(span->dur % 1000));
+	out->q->first = false;
+}
+
+/**
+ * @brief Write the stats as a JSON object.
+ *
+ * @param out The document being written.
+ */
+static void query_stats(struct query_out *out)
+{
+	unsigned int i;
+
+	query_printf(out, "{\"since_ns\":%llu,\"x_requests\":{",
+			(unsigned long long)stats_since());
+	for (i = 0; i < END_XREQ; i++)
+		query_printf(out, "%s\"%s\":%lu", i ? "," : "",
+				stats_xreq_names[i], stats_xreqs[i]);
+	query_printf(out, "},\"configures_skipped\":%lu,\"round_trips\":%lu,"
+			"\"events\":{", configures_skipped, stats_round_trips);
+	query_hists(out, stats_events, STATS_MAX_EVENTS);
+	query_printf(out, "},\"ipc\":{");
+	query_hists(out, stats_cmds, STATS_MAX_CMDS);
+	query_printf(out, "}}");
+}
+
+/**
+ * @brief Write the members of a JSON object for each histogram that has been
+ * allocated, keyed by the histogram's name.
+ *
+ * @param out The document being written.
+ * @param hists The histograms, indexed by event type or command id.
+ * @param n The length of hists.
+ */
+static void query_hists(struct query_out *out, struct stats_hist **hists,
+		unsigned int n)
+{
+	const struct stats_hist *h;
+	bool first = true;
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		h = hists[i];
+		if (!h)
+			continue;
+		if (h->name)
+			query_printf(out, "%s\"%s\":", first ? "" : ",", h->name);
+		else
+			query_printf(out, "%s\"event_%u\":", first ? "" : ",", i);
+		query_printf(out, "{\"count\":%llu,\"mean_ns\":%llu,\"p50_ns\":%llu,"
+				"\"p90_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu}",
+				(unsigned long long)h->count,
+				(unsigned long long)(h->sum / h->count),
+				(unsigned long long)stats_percentile(h, 50),
+				(unsigned long long)stats_percentile(h, 90),
+				(unsigned long long)stats_percentile(h, 99),
+				(unsigned long long)h->max);
+		first = false;
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file query.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** The largest chunk of a document that is passed to a query_sink. */
+#define QUERY_CHUNK_SIZE 4096
+
+/** The documents that can be queried. */
+enum query_type { QUERY_TREE, QUERY_WORKSPACES, QUERY_FOCUSED, QUERY_LOG,
+	QUERY_STATS, QUERY_TRACE, END_QUERY };
+
+/** How far through its document a query is. */
+enum query_stage { QUERY_STAGE_START, QUERY_STAGE_MONITOR,
+	QUERY_STAGE_WORKSPACE, QUERY_STAGE_CLIENT, QUERY_STAGE_ENTRIES,
+	QUERY_STAGE_DONE };
+
+/**
+ * @brief Where a query's document continues from, so that it can be written
+ * a chunk at a time.
+ *
+ * Positions are kept as indexes rather than pointers, as howm's state can
+ * change between chunks.
+ */
+struct query_cursor {
+	enum query_type type;
+	enum query_stage stage;
+	uint32_t mon; /**< The index of the current monitor. */
+	uint32_t ws; /**< The index of the current workspace on its monitor. */
+	uint32_t client; /**< The index of the next client on its workspace. */
+	uint64_t seq; /**< The next log message or trace span. */
+	uint64_t end; /**< The log message or trace span after the last. */
+	bool first; /**< Is the next trace span the first in the document? */
+};
+
+/**
+ * @brief Called with each chunk of a document as it is serialised.
+ *
+ * @param buf The chunk, which isn't null terminated.
+ * @param len The length of buf, which is never 0.
+ * @param data The data that was passed to query_next.
+ */
+typedef void (*query_sink)(const char *buf, size_t len, void *data);
+
+int query_from_name(const char *name);
+void query_start(struct query_cursor *q, enum query_type type);
+bool query_next(struct query_cursor *q, query_sink sink, void *data);
+
+#endif
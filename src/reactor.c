@@ -0,0 +1,253 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "helper.h"
+#include "reactor.h"
+
+/**
+ * @file reactor.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief The reactor that drives howm's main loop. File descriptors (such as
+ * the X connection, IPC sockets, signals and timers) are registered along
+ * with a callback that is called whenever they become ready.
+ */
+
+/** The most events that are dispatched per call to epoll_wait. */
+#define REACTOR_MAX_EVENTS 32
+
+/**
+ * @brief A file descriptor that is being watched by the reactor.
+ */
+struct handler {
+	int fd; /**< The file descriptor being watched. -1 once it has been
+		  removed, but not yet freed. */
+	reactor_cb cb; /**< Called when fd becomes ready. */
+	void *data; /**< Passed to cb. */
+	struct handler *next; /**< Handlers are stored in a linked list. */
+};
+
+static int epoll_fd = -1;
+static struct handler *handlers;
+static bool dispatching;
+
+static struct handler *find_handler(int fd);
+static void free_removed_handlers(void);
+
+/**
+ * @brief Create the epoll instance that the reactor waits on.
+ */
+void reactor_init(void)
+{
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1) {
+		log_err("Couldn't create the epoll instance. errno: %d", errno);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/**
+ * @brief Stop watching every file descriptor and close the epoll instance.
+ *
+ * The file descriptors themselves aren't closed.
+ */
+void reactor_cleanup(void)
+{
+	struct handler *h;
+
+	for (h = handlers; h; h = h->next)
+		h->fd = -1;
+	free_removed_handlers();
+	if (epoll_fd != -1)
+		close(epoll_fd);
+	epoll_fd = -1;
+}
+
+/**
+ * @brief Find the handler for a file descriptor.
+ *
+ * @param fd The file descriptor to search for.
+ *
+ * @return The handler for fd, or NULL if fd isn't being watched.
+ */
+static struct handler *find_handler(int fd)
+{
+	struct handler *h;
+
+	for (h = handlers; h; h = h->next)
+		if (h->fd == fd)
+			return h;
+	return NULL;
+}
+
+/**
+ * @brief Free the handlers that have been removed.
+ *
+ * Handlers aren't freed as soon as they are removed, as an event for them
+ * could still be waiting to be dispatched.
+ */
+static void free_removed_handlers(void)
+{
+	struct handler **h = &handlers;
+	struct handler *dead;
+
+	while (*h) {
+		if ((*h)->fd == -1) {
+			dead = *h;
+			*h = dead->next;
+			free(dead);
+		} else {
+			h = &(*h)->next;
+		}
+	}
+}
+
+/**
+ * @brief Start watching a file descriptor.
+ *
+ * @param fd The file descriptor to watch.
+ * @param events The epoll events to watch for, such as EPOLLIN.
+ * @param cb The function to call when fd becomes ready.
+ * @param data Passed to cb.
+ */
+void reactor_add(int fd, uint32_t events, reactor_cb cb, void *data)
+{
+	struct handler *h = calloc(1, sizeof(struct handler));
+	struct epoll_event ev;
+
+	if (!h) {
+		log_err("Can't allocate memory for reactor handler.");
+		exit(EXIT_FAILURE);
+	}
+	h->fd = fd;
+	h->cb = cb;
+	h->data = data;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.ptr = h;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+		log_err("Couldn't watch fd %d. errno: %d", fd, errno);
+		free(h);
+		return;
+	}
+	h->next = handlers;
+	handlers = h;
+}
+
+/**
+ * @brief Change the events that are being watched for on a file descriptor.
+ *
+ * @param fd A file descriptor that is being watched.
+ * @param events The epoll events to watch for.
+ */
+void reactor_modify(int fd, uint32_t events)
+{
+	struct handler *h = find_handler(fd);
+	struct epoll_event ev;
+
+	if (!h)
+		return;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.ptr = h;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) == -1)
+		log_err("Couldn't modify fd %d. errno: %d", fd, errno);
+}
+
+/**
+ * @brief Stop watching a file descriptor. The file descriptor isn't closed.
+ *
+ * @param fd The file descriptor that should no longer be watched.
+ */
+void reactor_remove(int fd)
+{
+	struct handler *h = find_handler(fd);
+
+	if (!h)
+		return;
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+	h->fd = -1;
+	if (!dispatching)
+		free_removed_handlers();
+}
+
+/**
+ * @brief Create a timer and start watching it.
+ *
+ * The timer is disarmed until reactor_arm_timer() is called. The callback is
+ * responsible for reading the expiration count from the timer.
+ *
+ * @param cb The function to call when the timer expires.
+ * @param data Passed to cb.
+ *
+ * @return The timer's file descriptor, or -1 on failure.
+ */
+int reactor_add_timer(reactor_cb cb, void *data)
+{
+	int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+	if (fd == -1) {
+		log_err("Couldn't create a timer. errno: %d", errno);
+		return -1;
+	}
+	reactor_add(fd, EPOLLIN, cb, data);
+	return fd;
+}
+
+/**
+ * @brief Arm a timer so that it expires once, after a delay.
+ *
+ * @param fd A timer that was created by reactor_add_timer().
+ * @param ms How many milliseconds until the timer should expire. 0 disarms
+ * the timer.
+ */
+void reactor_arm_timer(int fd, unsigned int ms)
+{
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = ms / 1000;
+	its.it_value.tv_nsec = (ms % 1000) * 1000000L;
+	if (timerfd_settime(fd, 0, &its, NULL) == -1)
+		log_err("Couldn't arm timer %d. errno: %d", fd, errno);
+}
+
+/**
+ * @brief Wait for file descriptors to become ready and call their handlers.
+ *
+ * @param timeout The most milliseconds to wait for. -1 waits forever.
+ */
+void reactor_poll(int timeout)
+{
+	struct epoll_event events[REACTOR_MAX_EVENTS];
+	struct handler *h;
+	int i, n;
+
+	n = epoll_wait(epoll_fd, events, REACTOR_MAX_EVENTS, timeout);
+	if (n == -1) {
+		if (errno != EINTR)
+			log_err("epoll_wait failed. errno: %d", errno);
+		return;
+	}
+
+	dispatching = true;
+	for (i = 0; i < n; i++) {
+		h = events[i].data.ptr;
+		if (h->fd != -1)
+			h->cb(h->fd, events[i].events, h->data);
+	}
+	dispatching = false;
+	free_removed_handlers();
+}
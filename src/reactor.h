@@ -0,0 +1,29 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+/**
+ * @file reactor.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** A function that is called when a file descriptor becomes ready. */
+typedef void (*reactor_cb)(int fd, uint32_t events, void *data);
+
+void reactor_init(void);
+void reactor_cleanup(void);
+void reactor_add(int fd, uint32_t events, reactor_cb cb, void *data);
+void reactor_modify(int fd, uint32_t events);
+void reactor_remove(int fd);
+int reactor_add_timer(reactor_cb cb, void *data);
+void reactor_arm_timer(int fd, unsigned int ms);
+void reactor_poll(int timeout);
+
+#endif
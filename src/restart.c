@@ -0,0 +1,581 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+
+#include "client.h"
+#include "helper.h"
+#include "howm.h"
+#include "journal.h"
+#include "layout.h"
+#include "location.h"
+#include "monitor.h"
+#include "restart.h"
+#include "scratchpad.h"
+#include "types.h"
+#include "workspace.h"
+#include "xcb_help.h"
+
+/**
+ * @file restart.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Restart howm in place, such as after it has been upgraded, without
+ * losing track of any windows.
+ *
+ * howm's monitors, workspaces and clients are written to a memfd, which is
+ * inherited by the new process when howm execs itself. The new process reads
+ * them back instead of asking the X server about each window. What was last
+ * sent to the X server is handed off too, so that nothing is sent again
+ * unless it has changed.
+ */
+
+/**
+ * @brief A handoff that is being written.
+ */
+struct restart_buf {
+	char *data;
+	size_t len;
+	size_t cap;
+};
+
+/**
+ * @brief A handoff that is being read.
+ */
+struct restart_reader {
+	const char *p; /**< The next byte to be read. */
+	size_t left; /**< How many bytes are left. */
+};
+
+static bool restart_pending;
+
+static bool restart_put(struct restart_buf *b, const void *data, size_t len);
+static bool restart_put_client(struct restart_buf *b, const client_t *c);
+static bool restart_get(struct restart_reader *r, void *data, size_t len);
+static client_t *restart_get_client(struct restart_reader *r);
+static bool restart_load_monitor(struct restart_reader *r, uint32_t index,
+		uint32_t *client_cnt);
+static bool restart_load_register(struct restart_reader *r, uint32_t *client_cnt);
+
+/**
+ * @brief Restart howm, keeping every window where it is.
+ *
+ * The restart happens once the main loop has finished its deferred work, so
+ * that nothing is left half done.
+ *
+ * @ingroup commands
+ */
+void restart(void)
+{
+	log_warn("Restarting");
+	restart_pending = true;
+}
+
+/**
+ * @brief If a restart has been requested, hand howm's state off to a new
+ * instance of howm and exec it.
+ *
+ * The new instance is found in the same way as this one was, so an upgraded
+ * binary is used. If the state can't be written, the new instance adopts the
+ * windows that are mapped instead. If the exec fails, howm carries on.
+ *
+ * Signals that arrive whilst restarting stay pending, as the new instance
+ * blocks and handles the same signals.
+ *
+ * @param argv The arguments that howm was started with.
+ */
+void restart_handoff(char *argv[])
+{
+	char fd_str[16];
+	int fd;
+
+	if (!restart_pending)
+		return;
+	restart_pending = false;
+
+	fd = restart_save();
+	if (fd != -1 && fcntl(fd, F_SETFD, 0) == -1) {
+		log_err("Couldn't pass the handoff on. errno: %d", errno);
+		close(fd);
+		fd = -1;
+	}
+	if (fd != -1) {
+		snprintf(fd_str, sizeof(fd_str), "%d", fd);
+		setenv(ENV_RESTART_VAR, fd_str, 1);
+	}
+
+	if (!xcb_flush(dpy))
+		log_err("Failed to flush X connection");
+	/* Tell the new instance that it can carry on with the journal. */
+	if (journal_enabled)
+		setenv(ENV_JOURNAL_VAR, "1", 1);
+	journal_close();
+	execvp(argv[0], argv);
+
+	log_err("Couldn't restart as %s. errno: %d", argv[0], errno);
+	unsetenv(ENV_RESTART_VAR);
+	unsetenv(ENV_JOURNAL_VAR);
+	if (fd != -1)
+		close(fd);
+}
+
+/**
+ * @brief Write howm's state to a memfd.
+ *
+ * @return The memfd, which has close-on-exec set, or -1 on failure.
+ */
+int restart_save(void)
+{
+	struct restart_buf b = { NULL, 0, 0 };
+	struct restart_header h = { .magic = RESTART_MAGIC,
+		.version = RESTART_VERSION, .scratchpad = scratchpad != NULL,
+		.reg_cnt = del_reg.size };
+	struct restart_monitor rm;
+	struct restart_workspace rw;
+	monitor_t *m;
+	workspace_t *ws;
+	client_t *c;
+	uint32_t i, cnt;
+	bool ok;
+	size_t off;
+	ssize_t n;
+	int fd;
+
+	for (m = mon_head; m; m = m->next, h.mon_cnt++)
+		if (m == mon)
+			h.mon_focused = h.mon_cnt;
+	ok = restart_put(&b, &h, sizeof(h));
+
+	for (m = mon_head; m && ok; m = m->next) {
+		rm.ws_cnt = m->workspace_cnt;
+		rm.ws_focused = rm.ws_last = 0;
+		for (ws = m->ws_head, i = 0; ws; ws = ws->next, i++) {
+			if (ws == m->ws)
+				rm.ws_focused = i;
+			if (ws == m->last_ws)
+				rm.ws_last = i;
+		}
+		ok = restart_put(&b, &rm, sizeof(rm));
+
+		for (ws = m->ws_head; ws && ok; ws = ws->next) {
+			memset(&rw, 0, sizeof(rw));
+			rw.layout = ws->layout;
+			rw.last_layout = ws->last_layout;
+			rw.master_ratio = ws->master_ratio;
+			rw.gap = ws->gap;
+			rw.bar_height = ws->bar_height;
+			rw.client_cnt = ws->client_cnt;
+			for (c = ws->head, i = 1; c; c = c->next, i++) {
+				if (c == ws->c)
+					rw.focused = i;
+				if (c == ws->prev_foc)
+					rw.prev_foc = i;
+			}
+			ok = restart_put(&b, &rw, sizeof(rw));
+			for (c = ws->head; c && ok; c = c->next)
+				ok = restart_put_client(&b, c);
+		}
+	}
+
+	if (ok && scratchpad)
+		ok = restart_put_client(&b, scratchpad);
+	for (i = 1; i <= del_reg.size && ok; i++) {
+		for (cnt = 0, c = del_reg.contents[i]; c; c = c->next)
+			cnt++;
+		ok = restart_put(&b, &cnt, sizeof(cnt));
+		for (c = del_reg.contents[i]; c && ok; c = c->next)
+			ok = restart_put_client(&b, c);
+	}
+
+	if (!ok) {
+		log_err("Can't allocate memory for the handoff.");
+		free(b.data);
+		return -1;
+	}
+	((struct restart_header *)b.data)->size = b.len;
+
+	fd = memfd_create("howm-restart", MFD_CLOEXEC);
+	if (fd == -1) {
+		log_err("Couldn't create the handoff. errno: %d", errno);
+		free(b.data);
+		return -1;
+	}
+	for (off = 0; off < b.len; off += n) {
+		n = write(fd, b.data + off, b.len - off);
+		if (n == -1 && errno == EINTR) {
+			n = 0;
+			continue;
+		}
+		if (n == -1) {
+			log_err("Couldn't write the handoff. errno: %d", errno);
+			close(fd);
+			fd = -1;
+			break;
+		}
+	}
+	if (fd != -1)
+		log_info("Wrote a handoff of %zu bytes", b.len);
+	free(b.data);
+	return fd;
+}
+
+/**
+ * @brief Rebuild howm's state from a handoff, without asking the X server
+ * about any of the windows.
+ *
+ * The handoff's monitors are matched to the current ones by index. If there
+ * are now fewer monitors, the workspaces of those that are missing are merged
+ * into the last monitor's. Workspaces are added as needed.
+ *
+ * @param fd A memfd that was written by restart_save().
+ *
+ * @return False if the handoff isn't valid. Anything before the point at
+ * which it stopped being valid is still restored.
+ */
+bool restart_load(int fd)
+{
+	struct restart_header h;
+	struct restart_reader r;
+	struct stat st;
+	client_t *c;
+	uint32_t i, client_cnt = 0;
+	bool ok = false;
+	void *p;
+
+	if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(h)) {
+		log_err("The handoff is too small.");
+		return false;
+	}
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED) {
+		log_err("Couldn't map the handoff. errno: %d", errno);
+		return false;
+	}
+	r.p = p;
+	r.left = st.st_size;
+
+	restart_get(&r, &h, sizeof(h));
+	if (h.magic != RESTART_MAGIC || h.version != RESTART_VERSION
+			|| h.size < sizeof(h) || h.size > (size_t)st.st_size) {
+		log_err("The handoff isn't a version %d handoff.", RESTART_VERSION);
+		munmap(p, st.st_size);
+		return false;
+	}
+	r.left = h.size - sizeof(h);
+
+	for (i = 0; i < h.mon_cnt; i++)
+		if (!restart_load_monitor(&r, i, &client_cnt))
+			goto out;
+
+	if (h.scratchpad) {
+		c = restart_get_client(&r);
+		if (!c)
+			goto out;
+		scratchpad = c;
+		client_cnt++;
+	}
+	for (i = 0; i < h.reg_cnt; i++)
+		if (!restart_load_register(&r, &client_cnt))
+			goto out;
+	ok = true;
+
+out:
+	if (!ok)
+		log_err("The handoff is corrupt, so it was only partly restored.");
+	if (h.mon_focused < mon_cnt)
+		mon = index_to_monitor(h.mon_focused);
+	for (i = 0; i < mon_cnt; i++)
+		arrange_windows(index_to_monitor(i));
+	update_focused_client(mon->ws->c);
+	ewmh_set_current_workspace();
+	howm_info();
+	log_info("Restored %u clients from the handoff", client_cnt);
+	munmap(p, st.st_size);
+	return ok;
+}
+
+/**
+ * @brief Restore howm's state if it has been restarted.
+ *
+ * @return True if howm's state was restored.
+ */
+bool restart_restore(void)
+{
+	char *s = getenv(ENV_RESTART_VAR);
+	char *end;
+	bool ok;
+	long fd;
+
+	if (!s)
+		return false;
+	errno = 0;
+	fd = strtol(s, &end, 10);
+	unsetenv(ENV_RESTART_VAR);
+	if (errno || *end != '\0' || fd < 0 || fd > INT32_MAX) {
+		log_err("%s isn't a valid handoff.", ENV_RESTART_VAR);
+		return false;
+	}
+
+	ok = restart_load(fd);
+	close(fd);
+	return ok;
+}
+
+/**
+ * @brief Append some data to a handoff, growing it if needed.
+ *
+ * @param b The handoff.
+ * @param data The data.
+ * @param len The length of data.
+ *
+ * @return False if the handoff couldn't be grown.
+ */
+static bool restart_put(struct restart_buf *b, const void *data, size_t len)
+{
+	size_t cap = b->cap ? b->cap : 4096;
+	char *d;
+
+	while (b->len + len > cap)
+		cap *= 2;
+	if (cap != b->cap) {
+		d = realloc(b->data, cap);
+		if (!d)
+			return false;
+		b->data = d;
+		b->cap = cap;
+	}
+	memcpy(b->data + b->len, data, len);
+	b->len += len;
+	return true;
+}
+
+/**
+ * @brief Append a client to a handoff.
+ *
+ * @param b The handoff.
+ * @param c The client.
+ *
+ * @return False if the handoff couldn't be grown.
+ */
+static bool restart_put_client(struct restart_buf *b, const client_t *c)
+{
+	struct restart_client rc = {
+		.win = c->win,
+		.rect = c->rect,
+		.drawn_rect = c->drawn_rect,
+		.gap = c->gap,
+		.drawn_border = c->drawn_border,
+		.border_colour = c->border_colour,
+		.stack_pos = c->stack_pos,
+	};
+
+	rc.flags = (c->is_floating ? RESTART_FLOATING : 0)
+		| (c->is_fullscreen ? RESTART_FULLSCREEN : 0)
+		| (c->is_transient ? RESTART_TRANSIENT : 0)
+		| (c->is_urgent ? RESTART_URGENT : 0)
+		| (c->can_delete ? RESTART_CAN_DELETE : 0)
+		| (c->is_drawn ? RESTART_DRAWN : 0)
+		| (c->is_coloured ? RESTART_COLOURED : 0);
+	return restart_put(b, &rc, sizeof(rc));
+}
+
+/**
+ * @brief Read some data from a handoff.
+ *
+ * @param r The handoff.
+ * @param data Where the data is copied to.
+ * @param len The length of data.
+ *
+ * @return False if the handoff is too short.
+ */
+static bool restart_get(struct restart_reader *r, void *data, size_t len)
+{
+	if (r->left < len)
+		return false;
+	memcpy(data, r->p, len);
+	r->p += len;
+	r->left -= len;
+	return true;
+}
+
+/**
+ * @brief Read a client from a handoff and take over its window.
+ *
+ * The events that howm selected on the window and its button grabs belonged
+ * to the old connection to the X server, so they are sent again. Nothing is
+ * waited on.
+ *
+ * @param r The handoff.
+ *
+ * @return A client that isn't in any list, or NULL if the handoff is too
+ * short.
+ */
+static client_t *restart_get_client(struct restart_reader *r)
+{
+	struct restart_client rc;
+	uint32_t vals[1] = { XCB_EVENT_MASK_PROPERTY_CHANGE
+				| XCB_EVENT_MASK_ENTER_WINDOW };
+	client_t *c;
+
+	if (!restart_get(r, &rc, sizeof(rc)))
+		return NULL;
+	c = calloc(1, sizeof(client_t));
+	if (!c) {
+		log_err("Can't allocate memory for client.");
+		exit(EXIT_FAILURE);
+	}
+	c->win = rc.win;
+	c->rect = rc.rect;
+	c->drawn_rect = rc.drawn_rect;
+	c->gap = rc.gap;
+	c->drawn_border = rc.drawn_border;
+	c->border_colour = rc.border_colour;
+	c->stack_pos = rc.stack_pos;
+	c->is_floating = rc.flags & RESTART_FLOATING;
+	c->is_fullscreen = rc.flags & RESTART_FULLSCREEN;
+	c->is_transient = rc.flags & RESTART_TRANSIENT;
+	c->is_urgent = rc.flags & RESTART_URGENT;
+	c->can_delete = rc.flags & RESTART_CAN_DELETE;
+	c->is_drawn = rc.flags & RESTART_DRAWN;
+	c->is_coloured = rc.flags & RESTART_COLOURED;
+
+	change_window_attributes(c->win, XCB_CW_EVENT_MASK, vals);
+	grab_buttons(c);
+	return c;
+}
+
+/**
+ * @brief Read a monitor, its workspaces and their clients from a handoff.
+ *
+ * @param r The handoff.
+ * @param index The index of the monitor in the handoff.
+ * @param client_cnt Incremented for each client that is restored.
+ *
+ * @return False if the handoff is too short.
+ */
+static bool restart_load_monitor(struct restart_reader *r, uint32_t index,
+		uint32_t *client_cnt)
+{
+	struct restart_monitor rm;
+	struct restart_workspace rw;
+	bool merged = index >= mon_cnt;
+	monitor_t *m = merged ? mon_tail : index_to_monitor(index);
+	workspace_t *ws;
+	client_t *c;
+	uint32_t i, j;
+
+	if (!restart_get(r, &rm, sizeof(rm)))
+		return false;
+
+	for (i = 0; i < rm.ws_cnt; i++) {
+		if (!restart_get(r, &rw, sizeof(rw)))
+			return false;
+		while (m->workspace_cnt <= i)
+			add_ws(m);
+		ws = index_to_workspace(m, i);
+		if (!merged) {
+			ws->layout = rw.layout >= 0 && rw.layout < END_LAYOUT
+				? rw.layout : WS_DEF_LAYOUT;
+			ws->last_layout = rw.last_layout < END_LAYOUT
+				? rw.last_layout : WS_DEF_LAYOUT;
+			ws->master_ratio = rw.master_ratio;
+			ws->gap = rw.gap;
+			ws->bar_height = rw.bar_height;
+		}
+
+		for (j = 1; j <= rw.client_cnt; j++) {
+			c = restart_get_client(r);
+			if (!c)
+				return false;
+			attach_client(ws, ws->tail, c);
+			loc_index_add(m, ws, c);
+			(*client_cnt)++;
+
+			/* A merged client's window was shown or hidden along
+			 * with its old monitor's workspace. */
+			if (merged) {
+				c->is_drawn = false;
+				if (ws == m->ws)
+					map_window(c->win);
+				else
+					unmap_window(c->win);
+				if (!ws->c)
+					ws->c = c;
+				continue;
+			}
+			if (j == rw.focused)
+				ws->c = c;
+			if (j == rw.prev_foc)
+				ws->prev_foc = c;
+		}
+	}
+
+	if (!merged) {
+		if (rm.ws_focused < m->workspace_cnt)
+			m->ws = index_to_workspace(m, rm.ws_focused);
+		if (rm.ws_last < m->workspace_cnt)
+			m->last_ws = index_to_workspace(m, rm.ws_last);
+	}
+	m->dirty |= DIRTY_STACK;
+	return true;
+}
+
+/**
+ * @brief Read an entry of the delete register from a handoff and push it onto
+ * the delete register.
+ *
+ * If the delete register is full, the clients are pasted onto the focused
+ * workspace instead, so that their windows aren't lost.
+ *
+ * @param r The handoff.
+ * @param client_cnt Incremented for each client that is restored.
+ *
+ * @return False if the handoff is too short.
+ */
+static bool restart_load_register(struct restart_reader *r, uint32_t *client_cnt)
+{
+	client_t *head = NULL, *tail = NULL, *c;
+	uint32_t i, cnt;
+	bool full = del_reg.size >= conf.delete_register_size;
+
+	if (!restart_get(r, &cnt, sizeof(cnt)))
+		return false;
+
+	for (i = 0; i < cnt; i++) {
+		c = restart_get_client(r);
+		if (!c)
+			break;
+		(*client_cnt)++;
+		if (full) {
+			attach_client(mon->ws, mon->ws->tail, c);
+			c->stack_pos = 0;
+			map_window(c->win);
+			loc_index_add(mon, mon->ws, c);
+			continue;
+		}
+		c->prev = tail;
+		if (tail)
+			tail->next = c;
+		else
+			head = c;
+		tail = c;
+	}
+
+	if (full)
+		log_warn("The delete register is full, so %u clients were pasted.", cnt);
+	else
+		stack_push(&del_reg, head);
+	return i == cnt;
+}
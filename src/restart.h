@@ -0,0 +1,93 @@
+#ifndef RESTART_H
+#define RESTART_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <xcb/xproto.h>
+
+/**
+ * @file restart.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** The first four bytes of a handoff, "howr" in ASCII. */
+#define RESTART_MAGIC 0x72776f68
+/** Incremented whenever the layout of a handoff changes. */
+#define RESTART_VERSION 1
+
+/** Flags that describe a client in a handoff. */
+enum restart_client_flags { RESTART_FLOATING = 1 << 0,
+	RESTART_FULLSCREEN = 1 << 1, RESTART_TRANSIENT = 1 << 2,
+	RESTART_URGENT = 1 << 3, RESTART_CAN_DELETE = 1 << 4,
+	RESTART_DRAWN = 1 << 5, RESTART_COLOURED = 1 << 6 };
+
+/**
+ * @brief The start of a handoff. Everything is native endian, as a handoff is
+ * only ever read by the process that howm execs.
+ *
+ * The header is followed by mon_cnt monitors. Each monitor is followed by its
+ * workspaces, and each workspace by its clients, in order. Then comes the
+ * scratchpad's client, if there is one, and then each entry of the delete
+ * register from the bottom of the stack up, as a uint32_t count followed by
+ * that many clients.
+ */
+struct restart_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size; /**< The size of the whole handoff. */
+	uint32_t mon_cnt;
+	uint32_t mon_focused; /**< The index of the focused monitor. */
+	uint32_t scratchpad; /**< Is there a client in the scratchpad? */
+	uint32_t reg_cnt; /**< How many entries the delete register has. */
+};
+
+/**
+ * @brief A monitor in a handoff.
+ */
+struct restart_monitor {
+	uint32_t ws_cnt;
+	uint32_t ws_focused; /**< The index of the focused workspace. */
+	uint32_t ws_last; /**< The index of the last focused workspace. */
+};
+
+/**
+ * @brief A workspace in a handoff.
+ */
+struct restart_workspace {
+	int32_t layout;
+	uint32_t last_layout;
+	float master_ratio;
+	uint16_t gap;
+	uint16_t bar_height;
+	uint32_t client_cnt;
+	uint32_t focused; /**< The index of the focused client, plus one. */
+	uint32_t prev_foc; /**< The index of the last focused client, plus one. */
+};
+
+/**
+ * @brief A client in a handoff, including what was last sent to the X server
+ * for it so that nothing has to be sent again.
+ */
+struct restart_client {
+	uint32_t win;
+	xcb_rectangle_t rect;
+	xcb_rectangle_t drawn_rect;
+	uint16_t gap;
+	uint16_t drawn_border;
+	uint32_t border_colour;
+	uint32_t stack_pos;
+	uint32_t flags; /**< A mask of enum restart_client_flags. */
+};
+
+void restart(void);
+void restart_handoff(char *argv[]);
+int restart_save(void);
+bool restart_load(int fd);
+bool restart_restore(void);
+
+#endif
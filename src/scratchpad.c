@@ -6,6 +6,8 @@
 #include "client.h"
 #include "helper.h"
 #include "howm.h"
+#include "location.h"
+#include "xcb_help.h"
 
 /**
  * @file scratchpad.c
@@ -19,7 +21,8 @@
  */
 
 struct stack del_reg;
-static client_t *scratchpad;
+/** The client that has been sent to the scratchpad, or NULL. */
+client_t *scratchpad;
 
 /**
  * @brief Dynamically allocate space for the contents of the stack.
@@ -99,21 +102,14 @@ void send_to_scratchpad(void)
 		return;
 
 	log_info("Sending client <%p> to scratchpad", c);
-	if (prev_client(c, mon->ws))
-		prev_client(c, mon->ws)->next = c->next;
+	detach_client(mon->ws, c);
 
-	/* TODO: This should be in a reusable function. */
 	if (c == mon->ws->prev_foc)
-		mon->ws->prev_foc = prev_client(mon->ws->c, mon->ws);
-	if (c == mon->ws->c || !mon->ws->head->next)
-		mon->ws->c = mon->ws->prev_foc ? mon->ws->prev_foc : mon->ws->head;
-	if (c == mon->ws->head) {
-		mon->ws->head = c->next;
-		mon->ws->c = c->next;
-	}
+		mon->ws->prev_foc = NULL;
+	mon->ws->c = mon->ws->prev_foc ? mon->ws->prev_foc : mon->ws->head;
 
-	xcb_unmap_window(dpy, c->win);
-	mon->ws->client_cnt--;
+	unmap_window(c->win);
+	loc_index_remove(c->win);
 	update_focused_client(mon->ws->c);
 	scratchpad = c;
 }
@@ -128,19 +124,14 @@ void get_from_scratchpad(void)
 {
 	if (!scratchpad)
 		return;
-	/* TODO: This should be in a reusable function. */
-	if (!mon->ws->head)
-		mon->ws->head = scratchpad;
-	else if (!mon->ws->head->next)
-		mon->ws->head->next = scratchpad;
-	else
-		prev_client(mon->ws->head, mon->ws)->next = scratchpad;
+	attach_client(mon->ws, mon->ws->tail, scratchpad);
+	scratchpad->stack_pos = 0;
 
 	mon->ws->prev_foc = mon->ws->c;
 	mon->ws->c = scratchpad;
 
 	scratchpad = NULL;
-	mon->ws->client_cnt++;
+	loc_index_add(mon, mon->ws, mon->ws->c);
 
 	mon->ws->c->is_floating = true;
 	mon->ws->c->rect.width = conf.scratchpad_width;
@@ -148,6 +139,6 @@ void get_from_scratchpad(void)
 	mon->ws->c->rect.x = (mon->rect.width / 2) - (mon->ws->c->rect.width / 2);
 	mon->ws->c->rect.y = (mon->rect.height - mon->ws->bar_height - mon->ws->c->rect.height) / 2;
 
-	xcb_map_window(dpy, mon->ws->c->win);
+	map_window(mon->ws->c->win);
 	update_focused_client(mon->ws->c);
 }
@@ -35,6 +35,7 @@ struct stack {
 };
 
 extern struct stack del_reg;
+extern client_t *scratchpad;
 
 void stack_push(struct stack *s, client_t *c);
 client_t *stack_pop(struct stack *s);
@@ -0,0 +1,247 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "helper.h"
+#include "howm.h"
+#include "snapshot.h"
+#include "types.h"
+
+/**
+ * @file snapshot.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Publish a snapshot of howm's state in shared memory, so that bars and
+ * pagers can read it without any requests to howm.
+ *
+ * The snapshot lives in a memfd that is created the first time that a client
+ * asks for it over IPC. After that, it is rewritten whenever the state that it
+ * describes changes, protected by a seqlock. The memfd grows to fit however
+ * many monitors, workspaces and clients there are, but never shrinks.
+ */
+
+static int snap_fd = -1;
+static struct snapshot *snap;
+/** The size of the memfd, and of its mapping. */
+static size_t snap_size;
+
+static bool snapshot_create(void);
+static bool snapshot_grow(size_t size);
+static void snapshot_build(struct snapshot *s);
+
+/**
+ * @brief Publish howm's state, if the snapshot exists.
+ *
+ * This should only be called when the state has changed, which howm_info
+ * keeps track of.
+ */
+void snapshot_update(void)
+{
+	const monitor_t *m;
+	const workspace_t *ws;
+	const client_t *c;
+	size_t size = sizeof(*snap);
+	uint32_t seq;
+
+	if (!snap)
+		return;
+
+	for (m = mon_head; m; m = m->next) {
+		size += sizeof(struct snapshot_monitor);
+		for (ws = m->ws_head; ws; ws = ws->next) {
+			size += sizeof(struct snapshot_workspace);
+			for (c = ws->head; c; c = c->next)
+				size += sizeof(struct snapshot_client);
+		}
+	}
+	if (size > snap_size && !snapshot_grow(size))
+		return;
+
+	seq = snap->seq;
+	__atomic_store_n(&snap->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	snapshot_build(snap);
+	__atomic_store_n(&snap->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Get a read-only file descriptor for the snapshot, creating the
+ * snapshot if it doesn't exist yet.
+ *
+ * @return A file descriptor that the caller must close, or -1 on failure.
+ */
+int snapshot_get_fd(void)
+{
+	char path[64];
+	int fd;
+
+	if (!snap && !snapshot_create())
+		return -1;
+
+	snprintf(path, sizeof(path), "/proc/self/fd/%d", snap_fd);
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		log_err("Couldn't reopen the snapshot read-only. errno: %d", errno);
+	return fd;
+}
+
+/**
+ * @brief Unmap and close the snapshot.
+ */
+void snapshot_cleanup(void)
+{
+	if (snap)
+		munmap(snap, snap_size);
+	snap = NULL;
+	snap_size = 0;
+	if (snap_fd != -1)
+		close(snap_fd);
+	snap_fd = -1;
+}
+
+/**
+ * @brief Create the memfd that holds the snapshot, map it and publish the
+ * current state into it.
+ *
+ * The memfd is sealed so that readers can't shrink it. It can still grow, as
+ * readers only have it open read-only.
+ *
+ * @return False if the snapshot couldn't be created.
+ */
+static bool snapshot_create(void)
+{
+	snap_fd = memfd_create("howm-snapshot", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (snap_fd == -1) {
+		log_err("Couldn't create the snapshot memfd. errno: %d", errno);
+		return false;
+	}
+	if (fcntl(snap_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL) == -1) {
+		log_err("Couldn't seal the snapshot memfd. errno: %d", errno);
+		snapshot_cleanup();
+		return false;
+	}
+	if (!snapshot_grow(sizeof(*snap))) {
+		snapshot_cleanup();
+		return false;
+	}
+	snap->magic = SNAPSHOT_MAGIC;
+	snap->version = SNAPSHOT_VERSION;
+	snapshot_update();
+	return true;
+}
+
+/**
+ * @brief Grow the memfd and its mapping so that it can hold at least size
+ * bytes.
+ *
+ * The memfd at least doubles in size each time, so that adding clients one
+ * at a time doesn't grow it each time.
+ *
+ * @param size The smallest size that the memfd must be.
+ *
+ * @return False if the memfd couldn't be grown, in which case it is left as
+ * it was.
+ */
+static bool snapshot_grow(size_t size)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	void *p;
+
+	if (size < snap_size * 2)
+		size = snap_size * 2;
+	size = (size + page - 1) / page * page;
+
+	if (ftruncate(snap_fd, size) == -1) {
+		log_err("Couldn't grow the snapshot memfd to %zu bytes. errno: %d",
+				size, errno);
+		return false;
+	}
+	if (snap)
+		p = mremap(snap, snap_size, size, MREMAP_MAYMOVE);
+	else
+		p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, snap_fd, 0);
+	if (p == MAP_FAILED) {
+		log_err("Couldn't map the snapshot. errno: %d", errno);
+		return false;
+	}
+	log_info("Grew the snapshot from %zu to %zu bytes", snap_size, size);
+	snap = p;
+	snap_size = size;
+	return true;
+}
+
+/**
+ * @brief Write howm's current state into a snapshot, which must be large
+ * enough to hold it.
+ *
+ * @param s The snapshot. Its magic, version and seq are left alone.
+ */
+static void snapshot_build(struct snapshot *s)
+{
+	struct snapshot_monitor *sm, *mons = (struct snapshot_monitor *)(s + 1);
+	struct snapshot_workspace *sw, *wss;
+	struct snapshot_client *sc, *clients;
+	const monitor_t *m;
+	const workspace_t *ws;
+	const client_t *c;
+
+	s->mon_cnt = s->ws_cnt = s->client_cnt = s->mon_focused = 0;
+	for (m = mon_head; m; m = m->next) {
+		s->mon_cnt++;
+		for (ws = m->ws_head; ws; ws = ws->next)
+			s->ws_cnt++;
+	}
+	wss = (struct snapshot_workspace *)(mons + s->mon_cnt);
+	clients = (struct snapshot_client *)(wss + s->ws_cnt);
+	s->mon_cnt = s->ws_cnt = 0;
+
+	for (m = mon_head; m; m = m->next) {
+		if (m == mon)
+			s->mon_focused = s->mon_cnt;
+		sm = &mons[s->mon_cnt++];
+		memset(sm, 0, sizeof(*sm));
+		sm->x = m->rect.x;
+		sm->y = m->rect.y;
+		sm->width = m->rect.width;
+		sm->height = m->rect.height;
+		sm->ws_first = s->ws_cnt;
+
+		for (ws = m->ws_head; ws; ws = ws->next) {
+			if (ws == m->ws)
+				sm->ws_focused = s->ws_cnt;
+			sw = &wss[s->ws_cnt++];
+			memset(sw, 0, sizeof(*sw));
+			sm->ws_cnt++;
+			sw->layout = ws->layout;
+			sw->client_first = s->client_cnt;
+			sw->focused_win = ws->c ? ws->c->win : XCB_WINDOW_NONE;
+
+			for (c = ws->head; c; c = c->next) {
+				sc = &clients[s->client_cnt++];
+				sw->client_cnt++;
+				sc->win = c->win;
+				sc->x = c->rect.x;
+				sc->y = c->rect.y;
+				sc->width = c->rect.width;
+				sc->height = c->rect.height;
+				sc->flags = (c->is_floating ? SNAP_FLOATING : 0)
+					| (c->is_fullscreen ? SNAP_FULLSCREEN : 0)
+					| (c->is_transient ? SNAP_TRANSIENT : 0)
+					| (c->is_urgent ? SNAP_URGENT : 0)
+					| (c == ws->c ? SNAP_FOCUSED : 0);
+				if (c->is_urgent)
+					sw->urgent_cnt++;
+			}
+		}
+	}
+	s->size = (char *)(clients + s->client_cnt) - (char *)s;
+}
@@ -0,0 +1,95 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+
+/**
+ * @file snapshot.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** The first four bytes of a snapshot, "howm" in ASCII. */
+#define SNAPSHOT_MAGIC 0x6d776f68
+/** Incremented whenever the layout of a snapshot changes. */
+#define SNAPSHOT_VERSION 2
+
+/** Flags that describe a client in a snapshot. */
+enum snapshot_client_flags { SNAP_FLOATING = 1 << 0, SNAP_FULLSCREEN = 1 << 1,
+	SNAP_TRANSIENT = 1 << 2, SNAP_URGENT = 1 << 3, SNAP_FOCUSED = 1 << 4 };
+
+/**
+ * @brief A monitor in a snapshot. Its workspaces are stored contiguously.
+ */
+struct snapshot_monitor {
+	int16_t x;
+	int16_t y;
+	uint16_t width;
+	uint16_t height;
+	uint32_t ws_first; /**< The index of the monitor's first workspace. */
+	uint32_t ws_cnt; /**< How many workspaces the monitor has. */
+	uint32_t ws_focused; /**< The index of the focused workspace. */
+};
+
+/**
+ * @brief A workspace in a snapshot. Its clients are stored contiguously.
+ */
+struct snapshot_workspace {
+	uint32_t layout;
+	uint32_t client_first; /**< The index of the workspace's first client. */
+	uint32_t client_cnt; /**< How many clients the workspace has. */
+	uint32_t urgent_cnt; /**< How many of those clients are urgent. */
+	uint32_t focused_win; /**< The focused window, or 0. */
+};
+
+/**
+ * @brief A client in a snapshot.
+ */
+struct snapshot_client {
+	uint32_t win;
+	int16_t x;
+	int16_t y;
+	uint16_t width;
+	uint16_t height;
+	uint32_t flags; /**< A mask of enum snapshot_client_flags. */
+};
+
+/**
+ * @brief The state of howm, as published in shared memory.
+ *
+ * The header is followed by mon_cnt monitors, then ws_cnt workspaces, then
+ * client_cnt clients, which can be found with the SNAPSHOT_* macros.
+ *
+ * seq is odd while howm is writing the snapshot. A reader should load seq
+ * (with acquire semantics), retry if it is odd, copy what it needs, then load
+ * seq again and retry if it has changed. The file only ever grows, so if size
+ * is larger than what the reader has mapped, it should map the file again
+ * before retrying.
+ */
+struct snapshot {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seq;
+	uint32_t size; /**< The size of the header and the arrays that follow. */
+	uint32_t mon_cnt;
+	uint32_t ws_cnt;
+	uint32_t client_cnt;
+	uint32_t mon_focused; /**< The index of the focused monitor. */
+};
+
+#define SNAPSHOT_MONITORS(s) ((const struct snapshot_monitor *) \
+		((const char *)(s) + sizeof(struct snapshot)))
+#define SNAPSHOT_WORKSPACES(s) ((const struct snapshot_workspace *) \
+		(SNAPSHOT_MONITORS(s) + (s)->mon_cnt))
+#define SNAPSHOT_CLIENTS(s) ((const struct snapshot_client *) \
+		(SNAPSHOT_WORKSPACES(s) + (s)->ws_cnt))
+
+void snapshot_update(void);
+int snapshot_get_fd(void);
+void snapshot_cleanup(void);
+
+#endif
@@ -0,0 +1,262 @@
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/xproto.h>
+
+#include "client.h"
+#include "helper.h"
+#include "stats.h"
+
+/**
+ * @file stats.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Measure how long howm takes to handle each type of X event and each
+ * IPC command, and count the X requests that it sends.
+ *
+ * A histogram is only allocated once something has been recorded in it, so
+ * the event types and commands that are never seen cost nothing.
+ */
+
+unsigned long stats_xreqs[END_XREQ];
+/** How many times howm has waited on a reply from the X server. */
+unsigned long stats_round_trips;
+const char *stats_xreq_names[END_XREQ] = {"configure", "map", "attributes",
+	"property", "focus"};
+struct stats_hist *stats_events[STATS_MAX_EVENTS];
+struct stats_hist *stats_cmds[STATS_MAX_CMDS];
+
+/** When the stats were last reset. */
+static uint64_t stats_start;
+
+static const char *event_names[STATS_MAX_EVENTS] = {
+	[XCB_KEY_PRESS] = "key_press",
+	[XCB_KEY_RELEASE] = "key_release",
+	[XCB_BUTTON_PRESS] = "button_press",
+	[XCB_BUTTON_RELEASE] = "button_release",
+	[XCB_MOTION_NOTIFY] = "motion_notify",
+	[XCB_ENTER_NOTIFY] = "enter_notify",
+	[XCB_LEAVE_NOTIFY] = "leave_notify",
+	[XCB_FOCUS_IN] = "focus_in",
+	[XCB_FOCUS_OUT] = "focus_out",
+	[XCB_KEYMAP_NOTIFY] = "keymap_notify",
+	[XCB_EXPOSE] = "expose",
+	[XCB_GRAPHICS_EXPOSURE] = "graphics_exposure",
+	[XCB_NO_EXPOSURE] = "no_exposure",
+	[XCB_VISIBILITY_NOTIFY] = "visibility_notify",
+	[XCB_CREATE_NOTIFY] = "create_notify",
+	[XCB_DESTROY_NOTIFY] = "destroy_notify",
+	[XCB_UNMAP_NOTIFY] = "unmap_notify",
+	[XCB_MAP_NOTIFY] = "map_notify",
+	[XCB_MAP_REQUEST] = "map_request",
+	[XCB_REPARENT_NOTIFY] = "reparent_notify",
+	[XCB_CONFIGURE_NOTIFY] = "configure_notify",
+	[XCB_CONFIGURE_REQUEST] = "configure_request",
+	[XCB_GRAVITY_NOTIFY] = "gravity_notify",
+	[XCB_RESIZE_REQUEST] = "resize_request",
+	[XCB_CIRCULATE_NOTIFY] = "circulate_notify",
+	[XCB_CIRCULATE_REQUEST] = "circulate_request",
+	[XCB_PROPERTY_NOTIFY] = "property_notify",
+	[XCB_SELECTION_CLEAR] = "selection_clear",
+	[XCB_SELECTION_REQUEST] = "selection_request",
+	[XCB_SELECTION_NOTIFY] = "selection_notify",
+	[XCB_COLORMAP_NOTIFY] = "colormap_notify",
+	[XCB_CLIENT_MESSAGE] = "client_message",
+	[XCB_MAPPING_NOTIFY] = "mapping_notify",
+};
+
+static void stats_record(struct stats_hist **h, const char *name, uint64_t start);
+static unsigned int stats_bucket(uint64_t v);
+static uint64_t stats_bucket_max(unsigned int b);
+
+/**
+ * @brief Start collecting stats.
+ */
+void stats_init(void)
+{
+	stats_start = stats_now();
+}
+
+/**
+ * @brief Read the monotonic clock.
+ *
+ * @return The current time, in nanoseconds.
+ */
+uint64_t stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Record how long an X event took to handle.
+ *
+ * @param type The type of the event, without the send_event bit.
+ * @param start When howm started to handle the event, from stats_now().
+ */
+void stats_event(uint8_t type, uint64_t start)
+{
+	if (type < STATS_MAX_EVENTS)
+		stats_record(&stats_events[type], event_names[type], start);
+}
+
+/**
+ * @brief Find the name of a type of X event.
+ *
+ * @param type The type of the event, without the send_event bit.
+ *
+ * @return The name, such as "map_request", or NULL if the type isn't a core
+ * event.
+ */
+const char *stats_event_name(uint8_t type)
+{
+	return type < STATS_MAX_EVENTS ? event_names[type] : NULL;
+}
+
+/**
+ * @brief Record how long an IPC command took to run.
+ *
+ * @param id The command's id in the binary protocol.
+ * @param name The command's name, which must outlive the stats.
+ * @param start When howm started to run the command, from stats_now().
+ */
+void stats_cmd(unsigned int id, const char *name, uint64_t start)
+{
+	if (id < STATS_MAX_CMDS)
+		stats_record(&stats_cmds[id], name, start);
+}
+
+/**
+ * @brief Find a percentile of a histogram.
+ *
+ * @param h The histogram.
+ * @param pct The percentile, from 0 to 100.
+ *
+ * @return The highest latency that falls in the same bucket as the
+ * percentile, in nanoseconds.
+ */
+uint64_t stats_percentile(const struct stats_hist *h, unsigned int pct)
+{
+	uint64_t target = (h->count * pct + 99) / 100, seen = 0, v;
+	unsigned int b;
+
+	if (target == 0)
+		target = 1;
+	for (b = 0; b < STATS_BUCKETS; b++) {
+		seen += h->buckets[b];
+		if (seen >= target)
+			break;
+	}
+	v = stats_bucket_max(b < STATS_BUCKETS ? b : STATS_BUCKETS - 1);
+	return v < h->max ? v : h->max;
+}
+
+/**
+ * @brief Find how long the stats have been collected for.
+ *
+ * @return The time since howm started or the stats were last reset, in
+ * nanoseconds.
+ */
+uint64_t stats_since(void)
+{
+	return stats_now() - stats_start;
+}
+
+/**
+ * @brief Forget every histogram and counter.
+ */
+void stats_reset(void)
+{
+	stats_cleanup();
+	memset(stats_xreqs, 0, sizeof(stats_xreqs));
+	stats_round_trips = 0;
+	configures_skipped = 0;
+	stats_start = stats_now();
+}
+
+/**
+ * @brief Free every histogram.
+ */
+void stats_cleanup(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < STATS_MAX_EVENTS; i++) {
+		free(stats_events[i]);
+		stats_events[i] = NULL;
+	}
+	for (i = 0; i < STATS_MAX_CMDS; i++) {
+		free(stats_cmds[i]);
+		stats_cmds[i] = NULL;
+	}
+}
+
+/**
+ * @brief Record a latency in a histogram, allocating the histogram if it
+ * doesn't exist yet.
+ *
+ * @param h The histogram.
+ * @param name The name to give the histogram if it is allocated, or NULL.
+ * @param start When the measurement started, from stats_now().
+ */
+static void stats_record(struct stats_hist **h, const char *name, uint64_t start)
+{
+	uint64_t v = stats_now() - start;
+
+	if (!*h) {
+		*h = calloc(1, sizeof(**h));
+		if (!*h)
+			return;
+		(*h)->name = name;
+	}
+	(*h)->count++;
+	(*h)->sum += v;
+	if (v > (*h)->max)
+		(*h)->max = v;
+	(*h)->buckets[stats_bucket(v)]++;
+}
+
+/**
+ * @brief Find the bucket that a latency belongs in.
+ *
+ * @param v The latency, in nanoseconds.
+ *
+ * @return The index of the bucket.
+ */
+static unsigned int stats_bucket(uint64_t v)
+{
+	unsigned int msb;
+
+	if (v < (1 << STATS_SUB_BITS))
+		return v;
+	msb = 63 - __builtin_clzll(v);
+	if (msb >= STATS_MAX_BITS)
+		return STATS_BUCKETS - 1;
+	return ((msb - STATS_SUB_BITS + 1) << STATS_SUB_BITS)
+		+ ((v >> (msb - STATS_SUB_BITS)) & ((1 << STATS_SUB_BITS) - 1));
+}
+
+/**
+ * @brief Find the highest latency that belongs in a bucket.
+ *
+ * @param b The index of the bucket.
+ *
+ * @return The latency, in nanoseconds.
+ */
+static uint64_t stats_bucket_max(unsigned int b)
+{
+	unsigned int sub = 1 << STATS_SUB_BITS;
+
+	b++;
+	if (b < sub)
+		return b - 1;
+	return ((uint64_t)(sub + b % sub) << (b / sub - 1)) - 1;
+}
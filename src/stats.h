@@ -0,0 +1,61 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+/**
+ * @file stats.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** How many sub-buckets each power of two is split into, as a power of two.
+ * This bounds the error of a recorded latency to 1 / 2^STATS_SUB_BITS. */
+#define STATS_SUB_BITS 3
+/** Latencies of 2^STATS_MAX_BITS nanoseconds (about a minute) and over are
+ * counted in the last bucket. */
+#define STATS_MAX_BITS 36
+#define STATS_BUCKETS ((STATS_MAX_BITS - STATS_SUB_BITS + 1) << STATS_SUB_BITS)
+/** Event types are 7 bits, once the send_event bit is removed. */
+#define STATS_MAX_EVENTS 128
+#define STATS_MAX_CMDS 128
+
+/** The categories of X request that are counted. */
+enum stats_xreq { XREQ_CONFIGURE, XREQ_MAP, XREQ_ATTRIBUTES, XREQ_PROPERTY,
+	XREQ_FOCUS, END_XREQ };
+
+/**
+ * @brief A histogram of latencies, in nanoseconds.
+ *
+ * Each power of two is split into 2^STATS_SUB_BITS linear buckets, so that
+ * the buckets are as precise relative to their values as each other.
+ */
+struct stats_hist {
+	const char *name;
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint32_t buckets[STATS_BUCKETS];
+};
+
+extern unsigned long stats_xreqs[END_XREQ];
+extern unsigned long stats_round_trips;
+extern const char *stats_xreq_names[END_XREQ];
+extern struct stats_hist *stats_events[STATS_MAX_EVENTS];
+extern struct stats_hist *stats_cmds[STATS_MAX_CMDS];
+
+void stats_init(void);
+uint64_t stats_now(void);
+void stats_event(uint8_t type, uint64_t start);
+const char *stats_event_name(uint8_t type);
+void stats_cmd(unsigned int id, const char *name, uint64_t start);
+uint64_t stats_percentile(const struct stats_hist *h, unsigned int pct);
+uint64_t stats_since(void);
+void stats_reset(void);
+void stats_cleanup(void);
+
+#endif
@@ -0,0 +1,323 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "helper.h"
+#include "howm.h"
+#include "monitor.h"
+#include "reactor.h"
+#include "status.h"
+#include "types.h"
+#include "workspace.h"
+
+/**
+ * @file status.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Output howm's status to stdout, so that it can be parsed by scripts
+ * that pipe it into a status bar.
+ *
+ * A status is only output when it differs from the last one, no more often
+ * than conf.status_interval allows. If stdout is a pipe or socket, it is
+ * written to without blocking: statuses are queued while the reader isn't
+ * keeping up, dropping the oldest once the queue is full, so that a stalled
+ * bar can't stall howm.
+ *
+ * O_NONBLOCK is never set on stdout itself, as its open file description is
+ * shared with the reader and with every program that howm spawns. A pipe is
+ * reopened to get a description of howm's own, and a socket is written to
+ * with MSG_DONTWAIT.
+ */
+
+/** How many statuses can be queued while the reader isn't keeping up. */
+#define STATUS_QUEUE_LEN 8
+/** The longest status, which may contain a line for each workspace. */
+#define STATUS_MAX 1024
+
+static char queue[STATUS_QUEUE_LEN][STATUS_MAX];
+static size_t queue_len[STATUS_QUEUE_LEN];
+static unsigned int queue_head;
+static unsigned int queue_cnt;
+/** How much of the status at the head of the queue has been written. */
+static size_t head_off;
+
+static char last[STATUS_MAX];
+static size_t last_len;
+static struct timespec last_emit;
+
+static bool nonblocking;
+static bool is_socket;
+/** Where statuses are written, which is stdout or a private description of
+ * it. */
+static int status_fd = STDOUT_FILENO;
+static bool watching;
+static int timer_fd = -1;
+static bool timer_armed;
+
+static size_t status_format(char *buf, size_t size);
+static unsigned int ms_since(const struct timespec *t);
+static void status_enqueue(const char *buf, size_t len);
+static ssize_t status_write(const char *buf, size_t len);
+static void status_flush(void);
+static void status_writable(int fd, uint32_t events, void *data);
+static void status_timer(int fd, uint32_t events, void *data);
+
+/**
+ * @brief Prepare stdout and the timer that delays statuses.
+ */
+void status_init(void)
+{
+	struct stat st;
+	int fd;
+
+	if (fstat(STDOUT_FILENO, &st) == 0 && S_ISSOCK(st.st_mode)) {
+		is_socket = nonblocking = true;
+	} else if (fstat(STDOUT_FILENO, &st) == 0 && S_ISFIFO(st.st_mode)) {
+		fd = open("/proc/self/fd/1", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+		if (fd != -1) {
+			status_fd = fd;
+			nonblocking = true;
+		} else {
+			log_warn("Couldn't reopen stdout, so writing the status may "
+					"block. errno: %d", errno);
+		}
+	}
+	timer_fd = reactor_add_timer(status_timer, NULL);
+}
+
+/**
+ * @brief Stop watching stdout and close the timer.
+ */
+void status_cleanup(void)
+{
+	if (watching)
+		reactor_remove(status_fd);
+	watching = false;
+	if (status_fd != STDOUT_FILENO)
+		close(status_fd);
+	status_fd = STDOUT_FILENO;
+	if (timer_fd != -1) {
+		reactor_remove(timer_fd);
+		close(timer_fd);
+	}
+	timer_fd = -1;
+}
+
+/**
+ * @brief Output howm's status, if it has changed since it was last output.
+ *
+ * If the last status was output less than conf.status_interval milliseconds
+ * ago, the status is output once the interval has passed instead.
+ */
+void status_update(void)
+{
+	char buf[STATUS_MAX];
+	size_t len = status_format(buf, sizeof(buf));
+	unsigned int elapsed;
+
+	if (len == last_len && memcmp(buf, last, len) == 0)
+		return;
+
+	elapsed = ms_since(&last_emit);
+	if (conf.status_interval && elapsed < conf.status_interval) {
+		if (!timer_armed && timer_fd != -1) {
+			reactor_arm_timer(timer_fd, conf.status_interval - elapsed);
+			timer_armed = true;
+		}
+		return;
+	}
+
+	memcpy(last, buf, len);
+	last_len = len;
+	clock_gettime(CLOCK_MONOTONIC, &last_emit);
+	status_enqueue(buf, len);
+	status_flush();
+}
+
+/**
+ * @brief Print howm's status into a buffer.
+ *
+ * @param buf Where the status is printed.
+ * @param size The size of buf.
+ *
+ * @return The length of the status, excluding the null terminator.
+ */
+static size_t status_format(char *buf, size_t size)
+{
+	int n;
+
+#if DEBUG_ENABLE
+	const workspace_t *ws;
+	size_t len = 0;
+
+	for (ws = mon->ws_head; ws != NULL && len < size; ws = ws->next) {
+		n = snprintf(buf + len, size - len, "%d:%u:%d:%u:%u\n",  ws->layout,
+			workspace_to_index(ws), cur_state,
+			ws->client_cnt, monitor_to_index(mon));
+		if (n < 0)
+			break;
+		len += n;
+	}
+	return len < size ? len : size - 1;
+#else
+	n = snprintf(buf, size, "%d:%d:%d:%u:%u\n",  mon->ws->layout,
+		workspace_to_index(mon->ws), cur_state,
+		mon->ws->client_cnt, monitor_to_index(mon));
+	if (n < 0)
+		return 0;
+	return (size_t)n < size ? (size_t)n : size - 1;
+#endif
+}
+
+/**
+ * @brief Calculate how many milliseconds have passed since a point in time.
+ *
+ * @param t A point in time, from CLOCK_MONOTONIC.
+ *
+ * @return The amount of milliseconds since t, saturating at UINT16_MAX, as
+ * that is larger than any interval.
+ */
+static unsigned int ms_since(const struct timespec *t)
+{
+	struct timespec now;
+	long long ms;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = (now.tv_sec - t->tv_sec) * 1000LL
+		+ (now.tv_nsec - t->tv_nsec) / 1000000;
+	return ms > UINT16_MAX ? UINT16_MAX : ms;
+}
+
+/**
+ * @brief Add a status to the end of the queue.
+ *
+ * If the queue is full, the oldest status that hasn't started being written is
+ * dropped.
+ *
+ * @param buf The status.
+ * @param len The length of the status.
+ */
+static void status_enqueue(const char *buf, size_t len)
+{
+	unsigned int drop, i, next;
+
+	if (queue_cnt == STATUS_QUEUE_LEN) {
+		drop = head_off ? 1 : 0;
+		log_debug("Status reader isn't keeping up, dropping a status");
+		for (i = drop; i < queue_cnt - 1; i++) {
+			next = (queue_head + i + 1) % STATUS_QUEUE_LEN;
+			memcpy(queue[(queue_head + i) % STATUS_QUEUE_LEN],
+				queue[next], queue_len[next]);
+			queue_len[(queue_head + i) % STATUS_QUEUE_LEN] = queue_len[next];
+		}
+		queue_cnt--;
+	}
+
+	i = (queue_head + queue_cnt) % STATUS_QUEUE_LEN;
+	memcpy(queue[i], buf, len);
+	queue_len[i] = len;
+	queue_cnt++;
+}
+
+/**
+ * @brief Write as many queued statuses to stdout as it will take.
+ *
+ * If stdout would block, it is watched until it becomes writable.
+ */
+static void status_flush(void)
+{
+	ssize_t n;
+
+	while (queue_cnt) {
+		n = status_write(queue[queue_head] + head_off,
+				queue_len[queue_head] - head_off);
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN && nonblocking) {
+				if (!watching)
+					reactor_add(status_fd, EPOLLOUT, status_writable, NULL);
+				watching = true;
+				return;
+			}
+			log_err("Couldn't write status. errno: %d", errno);
+			queue_cnt = 0;
+			head_off = 0;
+			break;
+		}
+		head_off += n;
+		if (head_off == queue_len[queue_head]) {
+			queue_head = (queue_head + 1) % STATUS_QUEUE_LEN;
+			queue_cnt--;
+			head_off = 0;
+		}
+	}
+
+	if (watching)
+		reactor_remove(status_fd);
+	watching = false;
+}
+
+/**
+ * @brief Write part of a status without blocking, if stdout allows it.
+ *
+ * @param buf The data to write.
+ * @param len The length of buf.
+ *
+ * @return The number of bytes written, or -1 with errno set.
+ */
+static ssize_t status_write(const char *buf, size_t len)
+{
+	if (is_socket)
+		return send(status_fd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+	return write(status_fd, buf, len);
+}
+
+/**
+ * @brief Called when stdout becomes writable after a write would have blocked.
+ *
+ * @param fd stdout.
+ * @param events The epoll events that occurred.
+ * @param data Unused.
+ */
+static void status_writable(int fd, uint32_t events, void *data)
+{
+	UNUSED(fd);
+	UNUSED(events);
+	UNUSED(data);
+
+	status_flush();
+}
+
+/**
+ * @brief Called when the interval since the last status has passed, so that a
+ * status that was delayed can be output.
+ *
+ * @param fd The timer.
+ * @param events The epoll events that occurred.
+ * @param data Unused.
+ */
+static void status_timer(int fd, uint32_t events, void *data)
+{
+	uint64_t expirations;
+
+	UNUSED(events);
+	UNUSED(data);
+
+	if (read(fd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN)
+		log_err("Couldn't read status timer. errno: %d", errno);
+	timer_armed = false;
+	status_update();
+}
@@ -0,0 +1,18 @@
+#ifndef STATUS_H
+#define STATUS_H
+
+/**
+ * @file status.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+void status_init(void);
+void status_cleanup(void);
+void status_update(void);
+
+#endif
@@ -0,0 +1,87 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stats.h"
+#include "trace.h"
+
+/**
+ * @file trace.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Record spans of the time spent in the main loop, event handlers,
+ * layouts and IPC commands, so that they can be viewed as a timeline.
+ *
+ * Spans are written to a fixed size ring buffer, so recording one never
+ * allocates and the oldest spans are overwritten once it is full. The trace
+ * is turned on and off with the trace config option, and read with the trace
+ * query.
+ */
+
+/** How many spans the ring buffer holds. Must be a power of two. */
+#define TRACE_RING_SIZE 16384
+
+bool trace_enabled;
+
+static struct trace_span ring[TRACE_RING_SIZE];
+/** The number of spans that have ever been recorded. */
+static uint64_t ring_head;
+
+/**
+ * @brief Record a span that has just finished.
+ *
+ * This should only be called through trace_end.
+ *
+ * @param name What the span was spent doing.
+ * @param cat The category of the span.
+ * @param start When the span started, from trace_begin.
+ *
+ * @return When the span finished.
+ */
+uint64_t trace_record(const char *name, const char *cat, uint64_t start)
+{
+	struct trace_span *s = &ring[ring_head++ & (TRACE_RING_SIZE - 1)];
+	uint64_t now = stats_now();
+
+	s->name = name ? name : "unknown";
+	s->cat = cat;
+	s->start = start;
+	s->dur = now - start;
+	return now;
+}
+
+/**
+ * @brief Pass some of the spans in the ring buffer to a sink, oldest first,
+ * so that the trace can be read a part at a time.
+ *
+ * Spans are recorded when they finish, so a span that encloses others comes
+ * after them. Spans that have been overwritten since from was set are
+ * skipped.
+ *
+ * @param from The first span to pass, which is advanced past the spans that
+ * were passed.
+ * @param to The span after the last one to pass, such as trace_count().
+ * @param max The most spans to pass.
+ * @param sink Called with each span.
+ * @param data Passed to sink.
+ */
+void trace_dump(uint64_t *from, uint64_t to, unsigned int max,
+		trace_sink sink, void *data)
+{
+	if (ring_head > TRACE_RING_SIZE && *from < ring_head - TRACE_RING_SIZE)
+		*from = ring_head - TRACE_RING_SIZE;
+	for (; *from < to && max > 0; (*from)++, max--)
+		sink(&ring[*from & (TRACE_RING_SIZE - 1)], data);
+}
+
+/**
+ * @brief Get the number of spans that have ever been recorded.
+ *
+ * @return The number of spans.
+ */
+uint64_t trace_count(void)
+{
+	return ring_head;
+}
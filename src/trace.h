@@ -0,0 +1,55 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stats.h"
+
+/**
+ * @file trace.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/**
+ * @brief A span of time that howm spent doing something, such as handling an
+ * event or running a layout.
+ */
+struct trace_span {
+	const char *name; /**< Must outlive the trace. */
+	const char *cat; /**< The category, such as "event" or "layout". */
+	uint64_t start; /**< CLOCK_MONOTONIC, in nanoseconds. */
+	uint64_t dur; /**< In nanoseconds. */
+};
+
+/**
+ * @brief Called with each span in the trace, oldest first.
+ *
+ * @param span The span.
+ * @param data The data that was passed to trace_dump.
+ */
+typedef void (*trace_sink)(const struct trace_span *span, void *data);
+
+extern bool trace_enabled;
+
+uint64_t trace_record(const char *name, const char *cat, uint64_t start);
+void trace_dump(uint64_t *from, uint64_t to, unsigned int max,
+		trace_sink sink, void *data);
+uint64_t trace_count(void);
+
+/* A span is started by taking the time with trace_begin and finished by
+ * passing that time to trace_end. Whilst tracing is disabled, these cost a
+ * single branch and nothing is recorded.
+ *
+ * trace_end returns the time that the span ended, so that the stages of a
+ * loop can be traced back to back without reading the clock twice. A span
+ * that started before tracing was enabled isn't recorded. */
+#define trace_begin() (trace_enabled ? stats_now() : 0)
+#define trace_end(N, C, S) (trace_enabled && (S) ? trace_record(N, C, S) : 0)
+
+#endif
@@ -25,15 +25,30 @@ typedef struct client_t client_t;
 struct client_t {
 	client_t *next; /**< Clients are stored in a linked list-
 					* this represents the client after this one. */
+	client_t *prev; /**< The client before this one in the linked list. */
 	bool is_fullscreen; /**< Is the client fullscreen? */
 	bool is_floating; /**< Is the client floating? */
 	bool is_transient; /**< Is the client transient?
 					* Defined at: http://standards.freedesktop.org/wm-spec/wm-spec-latest.html*/
 	bool is_urgent; /**< This is set by a client that wants focus for some reason. */
+	bool can_delete; /**< Does the client support WM_DELETE_WINDOW? This is
+			  cached from WM_PROTOCOLS so that killing a client
+			  never has to wait on the X server. */
 	xcb_window_t win; /**< The window that this client represents. */
 	xcb_rectangle_t rect; /**< The size and location of the client. */
 	uint16_t gap; /**< The size of the useless gap between this client and
 			the others. */
+	bool is_drawn; /**< Do drawn_rect and drawn_border reflect the state of
+			the window on the X server? */
+	xcb_rectangle_t drawn_rect; /**< The geometry last sent to the X server. */
+	uint16_t drawn_border; /**< The border width last sent to the X server. */
+	bool is_coloured; /**< Does border_colour reflect the state of the window
+			   on the X server? */
+	uint32_t border_colour; /**< The border colour last sent to the X server. */
+	unsigned int stack_pos; /**< The position of the window in the stacking
+				 order that was last sent for its workspace,
+				 counting from the bottom and starting at 1.
+				 0 means that the position isn't known. */
 };
 
 /**
@@ -49,12 +64,14 @@ struct workspace_t {
 	int layout; /**< The current layout of the WS, as defined in the
 				* layout enum. */
 	unsigned int client_cnt; /**< The amount of clients on this workspace. */
+	unsigned int urgent_cnt; /**< How many of those clients are urgent. */
 	uint16_t gap; /**< The size of the useless gap between windows for this workspace. */
 	float master_ratio; /**< The ratio of the size of the master window
 				 compared to the screen's size. */
 	uint16_t bar_height; /**< The height of the space left for a bar. Stored
 			      here so it can be toggled per ws. */
 	client_t *head; /**< The start of the linked list. */
+	client_t *tail; /**< The end of the linked list. */
 	client_t *prev_foc; /**< The last focused client. This is seperate to
 				* the linked list structure. */
 	client_t *c; /**< The client that is currently in focus. */
@@ -80,6 +97,8 @@ struct monitor_t {
 	monitor_t *prev; /**< The previous monitor. */
 	xcb_rectangle_t rect; /**< The size and location of the monitor. */
 	xcb_randr_output_t output; /**< The ID of the randr output. */
+	unsigned int dirty; /**< Work that has been deferred until the event
+			     queue has been drained, as a mask of the dirty enum. */
 };
 
 typedef struct {
@@ -32,7 +32,7 @@ void kill_ws(monitor_t *m, workspace_t *ws)
 		return;
 
 	while (ws->head)
-		kill_client(m, ws, m->ws->head);
+		kill_client(m, ws, ws->head);
 
 	log_info("Killed off workspace <%d>", workspace_to_index(ws));
 }
@@ -139,18 +139,16 @@ void change_ws(const workspace_t *ws)
 							workspace_to_index(ws));
 
 	for (; c; c = c->next)
-		xcb_map_window(dpy, c->win);
+		map_window(c->win);
 	for (c = mon->last_ws->head; c; c = c->next)
-		xcb_unmap_window(dpy, c->win);
+		unmap_window(c->win);
 
 	mon->ws = ws;
 
 	update_focused_client(mon->ws->c);
 
-	xcb_ewmh_set_current_desktop(ewmh, 0, workspace_to_index(ws));
-	xcb_ewmh_geometry_t workarea[] = { { 0, conf.bar_bottom ? 0 : ws->bar_height,
-				mon->rect.width, mon->rect.height - ws->bar_height } };
-	xcb_ewmh_set_workarea(ewmh, 0, LENGTH(workarea), workarea);
+	ewmh_set_current_workspace();
+	ewmh_set_workarea();
 
 	howm_info();
 }
@@ -225,7 +223,8 @@ void add_ws(monitor_t *m)
 			monitor_to_index(m));
 
 	m->workspace_cnt++;
-	xcb_ewmh_set_number_of_desktops(ewmh, 0, m->workspace_cnt);
+	ewmh_set_number_of_desktops(m->workspace_cnt);
+	howm_info();
 }
 
 /**
@@ -253,7 +252,7 @@ void remove_ws(monitor_t *m, workspace_t *ws)
 	if (m->ws_tail == ws)
 		m->ws_tail = ws->prev;
 
-	ws->head = ws->prev_foc = ws->c = NULL;
+	ws->head = ws->tail = ws->prev_foc = ws->c = NULL;
 	ws->next = ws->prev = NULL;
 
 	/* It seems reasonable to fall back to the first workspace */
@@ -262,7 +261,8 @@ void remove_ws(monitor_t *m, workspace_t *ws)
 
 	m->workspace_cnt--;
 	ewmh_set_current_workspace();
-	xcb_ewmh_set_number_of_desktops(ewmh, 0, m->workspace_cnt);
+	ewmh_set_number_of_desktops(m->workspace_cnt);
+	howm_info();
 
 	free(ws);
 }
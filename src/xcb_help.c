@@ -8,6 +8,7 @@
 #include "helper.h"
 #include "howm.h"
 #include "location.h"
+#include "stats.h"
 #include "workspace.h"
 #include "xcb_help.h"
 
@@ -40,6 +41,8 @@ void check_other_wm(void)
 
 	e = xcb_request_check(dpy, xcb_change_window_attributes_checked(dpy,
 			      screen->root, XCB_CW_EVENT_MASK, values));
+	stats_xreqs[XREQ_ATTRIBUTES]++;
+	stats_round_trips++;
 	if (e != NULL) {
 		xcb_disconnect(dpy);
 		log_err("Couldn't register as WM. Perhaps another WM is running? XCB returned error_code: %d", e->error_code);
@@ -48,6 +51,67 @@ void check_other_wm(void)
 	free(e);
 }
 
+/**
+ * @brief Map a window.
+ *
+ * @param win The window to be mapped.
+ */
+void map_window(xcb_window_t win)
+{
+	xcb_map_window(dpy, win);
+	stats_xreqs[XREQ_MAP]++;
+}
+
+/**
+ * @brief Unmap a window.
+ *
+ * @param win The window to be unmapped.
+ */
+void unmap_window(xcb_window_t win)
+{
+	xcb_unmap_window(dpy, win);
+	stats_xreqs[XREQ_MAP]++;
+}
+
+/**
+ * @brief Change any of a window's geometry, border width and stacking.
+ *
+ * @param win The window to be configured.
+ * @param mask Which values are being changed.
+ * @param vals The new values, in the order of the bits in mask.
+ */
+void configure_window(xcb_window_t win, uint16_t mask, const uint32_t *vals)
+{
+	xcb_configure_window(dpy, win, mask, vals);
+	stats_xreqs[XREQ_CONFIGURE]++;
+}
+
+/**
+ * @brief Change any of a window's attributes, such as its border colour.
+ *
+ * @param win The window to be changed.
+ * @param mask Which attributes are being changed.
+ * @param vals The new values, in the order of the bits in mask.
+ */
+void change_window_attributes(xcb_window_t win, uint32_t mask,
+		const uint32_t *vals)
+{
+	xcb_change_window_attributes(dpy, win, mask, vals);
+	stats_xreqs[XREQ_ATTRIBUTES]++;
+}
+
+/**
+ * @brief Give a window the input focus.
+ *
+ * @param win The window to be focused.
+ */
+void set_input_focus(xcb_window_t win)
+{
+	xcb_set_input_focus(dpy, XCB_INPUT_FOCUS_POINTER_ROOT, win,
+			XCB_CURRENT_TIME);
+	stats_xreqs[XREQ_FOCUS]++;
+}
+
 /**
  * @brief Change the dimensions and location of a window (win).
  *
@@ -62,7 +126,7 @@ void move_resize(xcb_window_t win,
 {
 	uint32_t position[] = { x, y, w, h };
 
-	xcb_configure_window(dpy, win, MOVE_RESIZE_MASK, position);
+	configure_window(win, MOVE_RESIZE_MASK, position);
 }
 
 /**
@@ -89,7 +153,7 @@ void set_border_width(xcb_window_t win, uint16_t w)
 {
 	uint32_t width[1] = { w };
 
-	xcb_configure_window(dpy, win, XCB_CONFIG_WINDOW_BORDER_WIDTH, width);
+	configure_window(win, XCB_CONFIG_WINDOW_BORDER_WIDTH, width);
 }
 
 /**
@@ -102,7 +166,7 @@ void elevate_window(xcb_window_t win)
 	uint32_t stack_mode[1] = { XCB_STACK_MODE_ABOVE };
 
 	log_info("Moving window <0x%x> to the front", win);
-	xcb_configure_window(dpy, win, XCB_CONFIG_WINDOW_STACK_MODE, stack_mode);
+	configure_window(win, XCB_CONFIG_WINDOW_STACK_MODE, stack_mode);
 }
 
 /**
@@ -121,6 +185,8 @@ void get_atoms(const char **names, xcb_atom_t *atoms)
 		cookies[i] = xcb_intern_atom(dpy, 0, strlen(names[i]), names[i]);
 		log_debug("Requesting atom %s", names[i]);
 	}
+	/* Only the first reply is waited for, the rest were pipelined. */
+	stats_round_trips++;
 	for (i = 0; i < LENGTH(atoms); i++) {
 		reply = xcb_intern_atom_reply(dpy, cookies[i], NULL);
 		if (reply) {
@@ -170,6 +236,36 @@ void delete_win(xcb_window_t win)
 	xcb_send_event(dpy, 0, win, XCB_EVENT_MASK_NO_EVENT, (char *)&ev);
 }
 
+/**
+ * @brief Tell a client the geometry that its window already has, instead of
+ * acting on its request to change it.
+ *
+ * This is the synthetic ConfigureNotify that ICCCM 4.1.5 asks for when a
+ * window manager refuses a ConfigureRequest.
+ *
+ * @param c The client whose request was refused.
+ */
+void send_configure_notify(client_t *c)
+{
+	xcb_configure_notify_event_t ev;
+	xcb_rectangle_t r = c->is_drawn ? c->drawn_rect : c->rect;
+
+	log_info("Refusing to reconfigure window <0x%x>", c->win);
+	memset(&ev, 0, sizeof(ev));
+	ev.response_type = XCB_CONFIGURE_NOTIFY;
+	ev.event = c->win;
+	ev.window = c->win;
+	ev.above_sibling = XCB_WINDOW_NONE;
+	ev.x = r.x;
+	ev.y = r.y;
+	ev.width = r.width;
+	ev.height = r.height;
+	ev.border_width = c->is_drawn ? c->drawn_border : conf.border_px;
+	ev.override_redirect = 0;
+	xcb_send_event(dpy, 0, c->win, XCB_EVENT_MASK_STRUCTURE_NOTIFY,
+			(char *)&ev);
+}
+
 /**
  * @brief Handle client messages that are related to WM_STATE.
  *
@@ -228,6 +324,7 @@ void setup_ewmh(void)
 	xcb_ewmh_set_supported(ewmh, 0, LENGTH(ewmh_net_atoms), ewmh_net_atoms);
 	xcb_ewmh_set_supporting_wm_check(ewmh, 0, screen->root);
 	xcb_ewmh_set_wm_name(ewmh, 0, strlen("howm"), "howm");
+	stats_xreqs[XREQ_PROPERTY] += 3;
 }
 
 void setup_ewmh_geom(void)
@@ -240,11 +337,76 @@ void setup_ewmh_geom(void)
 	xcb_ewmh_set_desktop_viewport(ewmh, 0, LENGTH(viewport), viewport);
 	xcb_ewmh_set_workarea(ewmh, 0, LENGTH(workarea), workarea);
 	xcb_ewmh_set_desktop_geometry(ewmh, 0, mon->rect.width, mon->rect.height);
+	stats_xreqs[XREQ_PROPERTY] += 3;
 }
 
 void ewmh_set_current_workspace(void)
 {
 	xcb_ewmh_set_current_desktop(ewmh, 0, workspace_to_index(mon->ws));
+	stats_xreqs[XREQ_PROPERTY]++;
+}
+
+/**
+ * @brief Set _NET_WORKAREA to the part of the focused monitor that isn't
+ * reserved for the focused workspace's bar.
+ */
+void ewmh_set_workarea(void)
+{
+	xcb_ewmh_geometry_t workarea[] = { { 0, conf.bar_bottom ? 0
+				: mon->ws->bar_height, mon->rect.width,
+				mon->rect.height - mon->ws->bar_height } };
+
+	xcb_ewmh_set_workarea(ewmh, 0, LENGTH(workarea), workarea);
+	stats_xreqs[XREQ_PROPERTY]++;
+}
+
+/**
+ * @brief Set _NET_NUMBER_OF_DESKTOPS.
+ *
+ * @param n The number of workspaces.
+ */
+void ewmh_set_number_of_desktops(uint32_t n)
+{
+	xcb_ewmh_set_number_of_desktops(ewmh, 0, n);
+	stats_xreqs[XREQ_PROPERTY]++;
+}
+
+/**
+ * @brief Set _NET_ACTIVE_WINDOW.
+ *
+ * @param win The focused window, or XCB_NONE.
+ */
+void ewmh_set_active_window(xcb_window_t win)
+{
+	xcb_ewmh_set_active_window(ewmh, 0, win);
+	stats_xreqs[XREQ_PROPERTY]++;
+}
+
+/**
+ * @brief Set a window's _NET_FRAME_EXTENTS to the same size on every side.
+ *
+ * @param win The window.
+ * @param space The size of the gap and border around the window.
+ */
+void ewmh_set_frame_extents(xcb_window_t win, uint32_t space)
+{
+	xcb_ewmh_set_frame_extents(ewmh, win, space, space, space, space);
+	stats_xreqs[XREQ_PROPERTY]++;
+}
+
+/**
+ * @brief Add or remove _NET_WM_STATE_FULLSCREEN from a window's _NET_WM_STATE.
+ *
+ * @param win The window.
+ * @param fscr Whether the window is fullscreen.
+ */
+void ewmh_set_fullscreen(xcb_window_t win, bool fscr)
+{
+	long data[] = {fscr ? ewmh->_NET_WM_STATE_FULLSCREEN : XCB_NONE };
+
+	xcb_change_property(dpy, XCB_PROP_MODE_REPLACE, win, ewmh->_NET_WM_STATE,
+			XCB_ATOM_ATOM, 32, fscr, data);
+	stats_xreqs[XREQ_PROPERTY]++;
 }
 
 xcb_randr_output_t *randr_get_outputs(unsigned int *nr_outputs)
@@ -260,6 +422,7 @@ xcb_randr_output_t *randr_get_outputs(unsigned int *nr_outputs)
 
 	sresc = xcb_randr_get_screen_resources(dpy, screen->root);
 	sresr = xcb_randr_get_screen_resources_reply(dpy, sresc, NULL);
+	stats_round_trips++;
 	*nr_outputs = xcb_randr_get_screen_resources_outputs_length(sresr);
 
 	if (!sresr || *nr_outputs < 1)
@@ -285,6 +448,7 @@ xcb_rectangle_t output_reply_to_rect(xcb_randr_get_output_info_reply_t *output)
 
 	cinfoc = xcb_randr_get_crtc_info(dpy, output->crtc, XCB_CURRENT_TIME);
 	cinfor = xcb_randr_get_crtc_info_reply(dpy, cinfoc, NULL);
+	stats_round_trips++;
 
 	if (cinfor)
 		rect = (xcb_rectangle_t){cinfor->x, cinfor->y,
@@ -302,6 +466,7 @@ xcb_randr_output_t randr_get_primary_output(void)
 
 	gopc = xcb_randr_get_output_primary(dpy, screen->root);
 	gopr = xcb_randr_get_output_primary_reply(dpy, gopc, NULL);
+	stats_round_trips++;
 
 	if (gopr)
 		out = gopr->output;
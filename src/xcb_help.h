@@ -1,6 +1,7 @@
 #ifndef XCB_HELP_H
 #define XCB_HELP_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <xcb/randr.h>
 #include <xcb/xproto.h>
@@ -21,6 +22,12 @@ enum net_atom_enum { NET_WM_STATE_FULLSCREEN, NET_SUPPORTED, NET_WM_STATE,
 	NET_ACTIVE_WINDOW };
 enum wm_atom_enum { WM_DELETE_WINDOW, WM_PROTOCOLS };
 
+void map_window(xcb_window_t win);
+void unmap_window(xcb_window_t win);
+void configure_window(xcb_window_t win, uint16_t mask, const uint32_t *vals);
+void change_window_attributes(xcb_window_t win, uint32_t mask,
+		const uint32_t *vals);
+void set_input_focus(xcb_window_t win);
 void elevate_window(xcb_window_t win);
 void move_resize(xcb_window_t win, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
 void set_border_width(xcb_window_t win, uint16_t w);
@@ -29,10 +36,16 @@ void check_other_wm(void);
 void focus_window(xcb_window_t win);
 void grab_buttons(client_t *c);
 void delete_win(xcb_window_t win);
+void send_configure_notify(client_t *c);
 void setup_ewmh(void);
 void setup_ewmh_geom(void);
 void ewmh_process_wm_state(client_t *c, xcb_atom_t a, int action);
 void ewmh_set_current_workspace(void);
+void ewmh_set_workarea(void);
+void ewmh_set_number_of_desktops(uint32_t n);
+void ewmh_set_active_window(xcb_window_t win);
+void ewmh_set_frame_extents(xcb_window_t win, uint32_t space);
+void ewmh_set_fullscreen(xcb_window_t win, bool fscr);
 xcb_randr_output_t *randr_get_outputs(unsigned int *nr_outputs);
 xcb_rectangle_t output_reply_to_rect(xcb_randr_get_output_info_reply_t *output);
 xcb_randr_output_t randr_get_primary_output(void);